@@ -1,4 +1,5 @@
 #include "cfs.h"
+#include "sched_trace.h"
 #include "../include/kernel.h"
 #include "../include/process.h"
 #include <stdlib.h>
@@ -38,15 +39,21 @@ static cfs_task_t *free_tasks = NULL;
 
 static cfs_stats_t stats;
 static scheduler_ops_t cfs_ops;
-static uint64_t system_clock = 0;
+
+/* Fast-path copies of the latency tunables */
+static uint32_t target_latency = CFS_TARGET_LATENCY;
+static uint32_t min_granularity = CFS_MIN_GRANULARITY;
 
 static cfs_task_t *alloc_task(void);
 static void free_task(cfs_task_t *task);
 static cfs_task_t *find_task(pid32 pid);
 static void insert_task(cfs_task_t *task);
 static void remove_task(cfs_task_t *task);
+static void update_clock(void);
 static void update_current(void);
 static uint64_t max64(uint64_t a, uint64_t b);
+static cfs_task_t *merge_timeline(cfs_task_t *a, cfs_task_t *b);
+static cfs_task_t *sort_timeline(cfs_task_t *list);
 
 static uint64_t max64(uint64_t a, uint64_t b)
 {
@@ -79,6 +86,10 @@ static void free_task(cfs_task_t *task)
 
 static cfs_task_t *find_task(pid32 pid)
 {
+    if (cfs_rq.curr != NULL && cfs_rq.curr->pid == pid) {
+        return cfs_rq.curr;
+    }
+    
     cfs_task_t *task = cfs_rq.tasks_timeline;
     
     while (task != NULL) {
@@ -157,6 +168,48 @@ static void remove_task(cfs_task_t *task)
     task->next = NULL;
 }
 
+/* Merge two vruntime-sorted chains linked through next (prev is fixed up by the caller) */
+static cfs_task_t *merge_timeline(cfs_task_t *a, cfs_task_t *b)
+{
+    cfs_task_t head;
+    cfs_task_t *tail = &head;
+    
+    while (a != NULL && b != NULL) {
+        if (a->vruntime <= b->vruntime) {
+            tail->next = a;
+            a = a->next;
+        } else {
+            tail->next = b;
+            b = b->next;
+        }
+        tail = tail->next;
+    }
+    
+    tail->next = (a != NULL) ? a : b;
+    
+    return head.next;
+}
+
+/* Stable merge sort by vruntime over a chain linked through next */
+static cfs_task_t *sort_timeline(cfs_task_t *list)
+{
+    if (list == NULL || list->next == NULL) {
+        return list;
+    }
+    
+    cfs_task_t *slow = list;
+    cfs_task_t *fast = list->next;
+    while (fast != NULL && fast->next != NULL) {
+        slow = slow->next;
+        fast = fast->next->next;
+    }
+    
+    cfs_task_t *half = slow->next;
+    slow->next = NULL;
+    
+    return merge_timeline(sort_timeline(list), sort_timeline(half));
+}
+
 /* Initialize the CFS scheduler */
 void cfs_init(void)
 {
@@ -172,8 +225,6 @@ void cfs_init(void)
     
     memset(&stats, 0, sizeof(stats));
     
-    system_clock = 0;
-    
     cfs_ops.init = cfs_init;
     cfs_ops.shutdown = cfs_shutdown;
     cfs_ops.schedule = cfs_schedule;
@@ -181,7 +232,12 @@ void cfs_init(void)
     cfs_ops.preempt = cfs_preempt;
     cfs_ops.enqueue = cfs_enqueue;
     cfs_ops.dequeue = cfs_dequeue;
+    cfs_ops.export_runnable = cfs_export;
+    cfs_ops.enqueue_batch = cfs_enqueue_batch;
     cfs_ops.tick = cfs_tick;
+    cfs_ops.next_event = cfs_next_event;
+    cfs_ops.check_preempt_wakeup = cfs_check_preempt_wakeup;
+    cfs_ops.catchup = cfs_catchup;
     cfs_ops.get_stats = (void (*)(void *))cfs_get_stats;
     cfs_ops.print_stats = cfs_print_stats;
     cfs_ops.type = SCHED_CFS;
@@ -315,7 +371,7 @@ void cfs_place_task(cfs_task_t *task, bool initial)
     if (initial) {
         /* New tasks start with penalty to prevent gaming the system */
         uint32_t latency = cfs_sched_latency();
-        vruntime += cfs_calc_delta(latency / 2, task->weight);
+        vruntime += cfs_calc_delta((uint64_t)latency * SCHED_TICK_NS / 2, task->weight);
     }
     
     task->vruntime = max64(task->vruntime, vruntime);
@@ -324,10 +380,10 @@ void cfs_place_task(cfs_task_t *task, bool initial)
 /* Calculate scheduling latency */
 uint32_t cfs_sched_latency(void)
 {
-    uint32_t latency = CFS_TARGET_LATENCY;
+    uint32_t latency = target_latency;
     
     if (cfs_rq.nr_running > 8) {
-        latency = CFS_MIN_GRANULARITY * cfs_rq.nr_running;
+        latency = min_granularity * cfs_rq.nr_running;
     }
     
     return latency;
@@ -337,23 +393,42 @@ uint32_t cfs_sched_latency(void)
 uint32_t cfs_timeslice(cfs_task_t *task)
 {
     if (cfs_rq.nr_running == 0 || task == NULL) {
-        return CFS_TARGET_LATENCY;
+        return target_latency;
     }
     
     uint32_t latency = cfs_sched_latency();
     
     uint32_t slice = (latency * task->weight) / cfs_rq.load_weight;
     
-    if (slice < CFS_MIN_GRANULARITY) {
-        slice = CFS_MIN_GRANULARITY;
+    if (slice < min_granularity) {
+        slice = min_granularity;
     }
     
     return slice;
 }
 
+void cfs_set_target_latency(uint32_t ticks)
+{
+    target_latency = ticks;
+}
+
+void cfs_set_min_granularity(uint32_t ticks)
+{
+    min_granularity = ticks;
+}
+
+/* Read the framework clock so runtime is charged up to the exact moment of the call */
+static void update_clock(void)
+{
+    cfs_rq.clock = sched_clock();
+    cfs_rq.clock_task = cfs_rq.clock;
+}
+
 static void update_current(void)
 {
     cfs_task_t *curr = cfs_rq.curr;
+    
+    update_clock();
     if (curr == NULL) {
         return;
     }
@@ -361,6 +436,12 @@ static void update_current(void)
     uint64_t now = cfs_rq.clock_task;
     uint64_t delta_exec = now - curr->exec_start;
     
+    /* A higher class ran in between; that time is not ours to charge */
+    if (curr->pid != currpid) {
+        curr->exec_start = now;
+        return;
+    }
+    
     if (delta_exec == 0) {
         return;
     }
@@ -389,11 +470,32 @@ bool cfs_check_preempt(void)
     }
     
     /* Preempt if vruntime difference exceeds granularity */
-    uint64_t gran = cfs_calc_delta(CFS_MIN_GRANULARITY, curr->weight);
+    uint64_t gran = cfs_calc_delta(min_granularity * SCHED_TICK_NS, curr->weight);
     
     return (next->vruntime + gran < curr->vruntime);
 }
 
+/* Check if a just-woken task is far enough behind the current one to preempt it */
+bool cfs_check_preempt_wakeup(pid32 pid)
+{
+    cfs_task_t *curr = cfs_rq.curr;
+    cfs_task_t *task = find_task(pid);
+    
+    if (curr == NULL || curr->pid != currpid) {
+        return true;
+    }
+    
+    if (task == NULL || !task->on_rq) {
+        return false;
+    }
+    
+    update_current();
+    
+    uint64_t gran = cfs_calc_delta(min_granularity * SCHED_TICK_NS, curr->weight);
+    
+    return task->vruntime + gran < curr->vruntime;
+}
+
 void cfs_put_prev_task(void)
 {
     cfs_task_t *prev = cfs_rq.curr;
@@ -403,10 +505,11 @@ void cfs_put_prev_task(void)
     
     update_current();
     
+    /* The running task is kept off the timeline; put it back in vruntime order */
     if (prev->on_rq) {
         remove_task(prev);
-        insert_task(prev);
     }
+    insert_task(prev);
     
     cfs_rq.curr = NULL;
 }
@@ -421,12 +524,9 @@ void cfs_set_curr_task(cfs_task_t *task)
 void cfs_schedule(void)
 {
     /* Update clocks */
-    cfs_rq.clock = system_clock;
-    cfs_rq.clock_task = system_clock;
+    update_current();
     
-    if (cfs_rq.curr != NULL) {
-        update_current();
-    }
+    pid32 old_pid = currpid;
     
     cfs_put_prev_task();
     
@@ -441,13 +541,10 @@ void cfs_schedule(void)
     
     cfs_set_curr_task(next);
     
-    pid32 old_pid = (cfs_rq.curr != NULL) ? cfs_rq.curr->pid : -1;
-    
     if (old_pid != next->pid) {
         stats.switches++;
         
-        extern void context_switch(pid32 old, pid32 new);
-        context_switch(old_pid, next->pid);
+        sched_switch(old_pid, next->pid);
     }
 }
 
@@ -491,7 +588,7 @@ void cfs_enqueue(pid32 pid)
         task->sum_exec = 0;
         
         cfs_place_task(task, true);
-    } else if (task->on_rq) {
+    } else if (task->on_rq || task == cfs_rq.curr) {
         return;
     } else {
         cfs_place_task(task, false);
@@ -501,8 +598,83 @@ void cfs_enqueue(pid32 pid)
     
     cfs_rq.nr_running++;
     cfs_rq.load_weight += task->weight;
+}
+
+/* Report runnable tasks (including the running one) with nice mapped to priority */
+uint32_t cfs_export(sched_hint_t *hints, uint32_t max)
+{
+    uint32_t count = 0;
+    
+    if (cfs_rq.curr != NULL && !cfs_rq.curr->on_rq && count < max) {
+        hints[count].pid = cfs_rq.curr->pid;
+        hints[count].priority = sched_nice_to_prio(cfs_rq.curr->nice);
+        count++;
+    }
     
-    if (cfs_check_preempt()) {
+    cfs_task_t *task = cfs_rq.tasks_timeline;
+    while (task != NULL && count < max) {
+        hints[count].pid = task->pid;
+        hints[count].priority = sched_nice_to_prio(task->nice);
+        count++;
+        task = task->next;
+    }
+    
+    return count;
+}
+
+/* Add many tasks at once: place each, sort the batch by vruntime, merge into the timeline */
+void cfs_enqueue_batch(const sched_hint_t *hints, uint32_t count)
+{
+    bool present[NPROC];
+    cfs_task_t *batch = NULL;
+    cfs_task_t **tail = &batch;
+    
+    memset(present, 0, sizeof(present));
+    if (cfs_rq.curr != NULL) {
+        present[cfs_rq.curr->pid] = true;
+    }
+    for (cfs_task_t *task = cfs_rq.tasks_timeline; task != NULL; task = task->next) {
+        present[task->pid] = true;
+    }
+    
+    for (uint32_t i = 0; i < count; i++) {
+        pid32 pid = hints[i].pid;
+        if (pid < 0 || pid >= NPROC || present[pid]) {
+            continue;
+        }
+        
+        cfs_task_t *task = alloc_task();
+        if (task == NULL) {
+            break;
+        }
+        
+        int nice = (hints[i].priority != SCHED_HINT_NONE) ?
+            sched_prio_to_nice(hints[i].priority) : CFS_NICE_DEFAULT;
+        
+        task->pid = pid;
+        task->nice = nice;
+        task->weight = cfs_nice_to_weight(nice);
+        task->vruntime = cfs_rq.min_vruntime;
+        
+        cfs_place_task(task, true);
+        
+        task->on_rq = true;
+        *tail = task;
+        tail = &task->next;
+        present[pid] = true;
+        
+        cfs_rq.nr_running++;
+        cfs_rq.load_weight += task->weight;
+    }
+    
+    cfs_rq.tasks_timeline = merge_timeline(cfs_rq.tasks_timeline, sort_timeline(batch));
+    cfs_rq.leftmost = cfs_rq.tasks_timeline;
+    
+    /* Rebuild back links in one pass */
+    cfs_task_t *prev = NULL;
+    for (cfs_task_t *task = cfs_rq.tasks_timeline; task != NULL; task = task->next) {
+        task->prev = prev;
+        prev = task;
     }
 }
 
@@ -517,9 +689,9 @@ void cfs_dequeue(pid32 pid)
     if (task == cfs_rq.curr) {
         update_current();
         cfs_rq.curr = NULL;
-    }
-    
-    if (task->on_rq) {
+        cfs_rq.nr_running--;
+        cfs_rq.load_weight -= task->weight;
+    } else if (task->on_rq) {
         remove_task(task);
         cfs_rq.nr_running--;
         cfs_rq.load_weight -= task->weight;
@@ -537,14 +709,14 @@ void cfs_sleep(pid32 pid)
         return;
     }
     
-    task->sleep_start = system_clock;
+    task->sleep_start = sched_clock();
     
     if (task == cfs_rq.curr) {
         update_current();
         cfs_rq.curr = NULL;
-    }
-    
-    if (task->on_rq) {
+        cfs_rq.nr_running--;
+        cfs_rq.load_weight -= task->weight;
+    } else if (task->on_rq) {
         remove_task(task);
         cfs_rq.nr_running--;
         cfs_rq.load_weight -= task->weight;
@@ -559,7 +731,7 @@ void cfs_wakeup(pid32 pid)
         return;
     }
     
-    uint64_t sleep_time = system_clock - task->sleep_start;
+    uint64_t sleep_time = sched_clock() - task->sleep_start;
     stats.sleep_time += sleep_time;
     
     /* Award vruntime credit to tasks that slept (favor interactive tasks) */
@@ -575,17 +747,14 @@ void cfs_wakeup(pid32 pid)
     insert_task(task);
     cfs_rq.nr_running++;
     cfs_rq.load_weight += task->weight;
-    
-    if (cfs_check_preempt()) {
-        /* Could trigger reschedule for interactive task */
-    }
 }
 
 /* Calculate vruntime credit for sleeping tasks (capped to prevent abuse) */
 uint64_t cfs_sleeper_credit(cfs_task_t *task, uint64_t sleep_time)
 {
     /* Cap credit at half the scheduling latency */
-    uint64_t max_credit = cfs_calc_delta(cfs_sched_latency() / 2, task->weight);
+    uint64_t max_credit = cfs_calc_delta((uint64_t)cfs_sched_latency() * SCHED_TICK_NS / 2,
+                                         task->weight);
     
     uint64_t credit = cfs_calc_delta(sleep_time, task->weight) / 2;
     
@@ -599,11 +768,6 @@ uint64_t cfs_sleeper_credit(cfs_task_t *task, uint64_t sleep_time)
 /* Timer tick: update runtime and check if current task exhausted timeslice */
 void cfs_tick(void)
 {
-    system_clock++;
-    
-    cfs_rq.clock = system_clock;
-    cfs_rq.clock_task = system_clock;
-    
     cfs_task_t *curr = cfs_rq.curr;
     if (curr == NULL) {
         return;
@@ -611,19 +775,48 @@ void cfs_tick(void)
     
     update_current();
     
-    uint64_t ideal_runtime = cfs_timeslice(curr);
+    uint32_t slice = cfs_timeslice(curr);
+    uint64_t ideal_runtime = (uint64_t)slice * SCHED_TICK_NS;
     uint64_t actual_runtime = curr->sum_exec - curr->prev_sum_exec;
     
     if (actual_runtime >= ideal_runtime) {
         /* Task exhausted its timeslice */
         if (cfs_rq.nr_running > 1) {
             /* Reschedule if other tasks waiting */
+            sched_trace_emit(TRACE_QUANTUM, curr->pid, slice);
             curr->prev_sum_exec = curr->sum_exec;
             cfs_schedule();
         }
     }
 }
 
+/* Ticks until the running task exhausts its slice; no event while it runs alone */
+uint64_t cfs_next_event(void)
+{
+    cfs_task_t *curr = cfs_rq.curr;
+    if (curr == NULL || cfs_rq.nr_running <= 1) {
+        return SCHED_NO_EVENT;
+    }
+    
+    uint64_t ideal_runtime = (uint64_t)cfs_timeslice(curr) * SCHED_TICK_NS;
+    uint64_t actual_runtime = curr->sum_exec - curr->prev_sum_exec +
+                              (sched_clock() - curr->exec_start);
+    
+    if (actual_runtime >= ideal_runtime) {
+        return 1;
+    }
+    
+    return (ideal_runtime - actual_runtime + SCHED_TICK_NS - 1) / SCHED_TICK_NS;
+}
+
+/* The framework clock already covers the skipped ticks; vruntime is charged in one step */
+void cfs_catchup(uint64_t ticks)
+{
+    (void)ticks;
+    
+    update_current();
+}
+
 void cfs_update_clock(uint64_t delta)
 {
     cfs_rq.clock += delta;
@@ -664,8 +857,8 @@ void cfs_print_stats(void)
 {
     kprintf("\n=== CFS Scheduler Statistics ===\n");
     kprintf("Context switches: %llu\n", stats.switches);
-    kprintf("Total runtime: %llu ticks\n", stats.total_runtime);
-    kprintf("Total sleep time: %llu ticks\n", stats.sleep_time);
+    kprintf("Total runtime: %llu ns\n", stats.total_runtime);
+    kprintf("Total sleep time: %llu ns\n", stats.sleep_time);
     kprintf("Tasks running: %u\n", cfs_rq.nr_running);
     kprintf("Total load weight: %u\n", cfs_rq.load_weight);
     kprintf("Min vruntime: %llu\n", cfs_rq.min_vruntime);
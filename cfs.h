@@ -36,9 +36,9 @@ typedef struct cfs_task {
     pid32       pid;
     int8_t      nice;               /* Priority: -20 to +19 */
     uint32_t    weight;             /* Scheduling weight from nice value */
-    uint64_t    vruntime;           /* Virtual runtime (fairness metric) */
-    uint64_t    exec_start;         /* Last time task started running */
-    uint64_t    sum_exec;           /* Total execution time */
+    uint64_t    vruntime;           /* Virtual runtime in ns (fairness metric) */
+    uint64_t    exec_start;         /* sched_clock() when task started running */
+    uint64_t    sum_exec;           /* Total execution time (ns) */
     uint64_t    prev_sum_exec;      /* Exec time at last timeslice start */
     uint64_t    sleep_start;        /* Time when task went to sleep */
     bool        on_rq;              /* True if task is on run queue */
@@ -58,7 +58,7 @@ typedef struct cfs_task {
 typedef struct cfs_rq {
     uint32_t    nr_running;         /* Number of runnable tasks */
     uint64_t    min_vruntime;       /* Minimum vruntime */
-    uint64_t    clock;              /* Clock */
+    uint64_t    clock;              /* Last sched_clock() reading */
     uint64_t    clock_task;         /* Task clock */
     uint32_t    load_weight;        /* Sum of all task weights */
     
@@ -89,10 +89,13 @@ void cfs_yield(void);
 void cfs_preempt(void);
 cfs_task_t *cfs_pick_next_task(void);
 bool cfs_check_preempt(void);
+bool cfs_check_preempt_wakeup(pid32 pid);
 
 /* Task queue management */
 void cfs_enqueue(pid32 pid);
 void cfs_dequeue(pid32 pid);
+uint32_t cfs_export(sched_hint_t *hints, uint32_t max);
+void cfs_enqueue_batch(const sched_hint_t *hints, uint32_t count);
 void cfs_put_prev_task(void);
 void cfs_set_curr_task(cfs_task_t *task);
 
@@ -111,9 +114,13 @@ uint32_t cfs_nice_to_wmult(int nice);
 /* Timeslice calculations */
 uint32_t cfs_timeslice(cfs_task_t *task);
 uint32_t cfs_sched_latency(void);
+void cfs_set_target_latency(uint32_t ticks);
+void cfs_set_min_granularity(uint32_t ticks);
 
 /* Clock and timer */
 void cfs_tick(void);
+uint64_t cfs_next_event(void);
+void cfs_catchup(uint64_t ticks);
 void cfs_update_clock(uint64_t delta);
 
 /* Sleep/wake operations */
@@ -1,4 +1,5 @@
 #include "lottery.h"
+#include "sched_trace.h"
 #include "../include/kernel.h"
 #include "../include/process.h"
 #include <stdlib.h>
@@ -11,6 +12,8 @@ static uint32_t participant_count = 0;
 static bool compensation_enabled = LOTTERY_COMPENSATION_ENABLED;
 static pid32 current_pid = -1;
 static uint32_t time_remaining = 0;
+static uint32_t lottery_quantum = DEFAULT_QUANTUM;
+static uint32_t default_tickets = LOTTERY_DEFAULT_TICKETS;
 static lottery_stats_t stats;
 static uint32_t random_state = 1;
 #define LOTTERY_MAX_ENTRIES 256
@@ -124,7 +127,14 @@ void lottery_init(void)
     lottery_ops.preempt = lottery_preempt;
     lottery_ops.enqueue = lottery_enqueue;
     lottery_ops.dequeue = lottery_dequeue;
+    lottery_ops.export_runnable = lottery_export;
+    lottery_ops.enqueue_batch = lottery_enqueue_batch;
     lottery_ops.tick = lottery_tick;
+    lottery_ops.next_event = lottery_next_event;
+    lottery_ops.check_preempt_wakeup = lottery_check_preempt_wakeup;
+    lottery_ops.set_quantum = lottery_set_quantum;
+    lottery_ops.get_quantum = lottery_get_quantum;
+    lottery_ops.catchup = lottery_catchup;
     lottery_ops.get_stats = (void (*)(void *))lottery_get_stats;
     lottery_ops.print_stats = lottery_print_stats;
     lottery_ops.type = SCHED_LOTTERY;
@@ -208,13 +218,12 @@ void lottery_schedule(void)
     if (winner != current_pid) {
         pid32 old_pid = current_pid;
         current_pid = winner;
-        time_remaining = DEFAULT_QUANTUM;
+        time_remaining = lottery_quantum;
         
-        extern void context_switch(pid32 old, pid32 new);
-        context_switch(old_pid, winner);
+        sched_switch(old_pid, winner);
     } else {
         /* Same task won again, reset quantum */
-        time_remaining = DEFAULT_QUANTUM;
+        time_remaining = lottery_quantum;
     }
 }
 
@@ -223,7 +232,7 @@ void lottery_yield(void)
 {
     if (current_pid >= 0 && compensation_enabled) {
         /* Calculate fraction of quantum used, award compensation */
-        float fraction = 1.0f - ((float)time_remaining / DEFAULT_QUANTUM);
+        float fraction = 1.0f - ((float)time_remaining / lottery_quantum);
         lottery_compensate(current_pid, fraction);
     }
     
@@ -231,6 +240,14 @@ void lottery_yield(void)
     lottery_schedule();
 }
 
+/* A wakeup never cuts the running quantum short; the woken task joins the next draw */
+bool lottery_check_preempt_wakeup(pid32 pid)
+{
+    (void)pid;
+    
+    return current_pid < 0 || current_pid != currpid || find_entry(current_pid) == NULL;
+}
+
 void lottery_preempt(void)
 {
     time_remaining = 0;
@@ -252,8 +269,8 @@ void lottery_enqueue(pid32 pid)
     
     /* Initialize with default ticket allocation */
     entry->pid = pid;
-    entry->base_tickets = LOTTERY_DEFAULT_TICKETS;
-    entry->current_tickets = LOTTERY_DEFAULT_TICKETS;
+    entry->base_tickets = default_tickets;
+    entry->current_tickets = default_tickets;
     entry->compensation = 0;
     entry->wins = 0;
     entry->total_tickets_held = 0;
@@ -267,6 +284,63 @@ void lottery_enqueue(pid32 pid)
     stats.participant_count = participant_count;
 }
 
+/* Report every participant with its base tickets mapped onto the priority scale */
+uint32_t lottery_export(sched_hint_t *hints, uint32_t max)
+{
+    uint32_t count = 0;
+    
+    lottery_entry_t *entry = lottery_pool;
+    while (entry != NULL && count < max) {
+        hints[count].pid = entry->pid;
+        hints[count].priority = sched_tickets_to_prio(entry->base_tickets);
+        count++;
+        entry = entry->next;
+    }
+    
+    return count;
+}
+
+/* Add many processes at once; duplicates are found with one pass over the pool */
+void lottery_enqueue_batch(const sched_hint_t *hints, uint32_t count)
+{
+    bool present[NPROC];
+    
+    memset(present, 0, sizeof(present));
+    for (lottery_entry_t *entry = lottery_pool; entry != NULL; entry = entry->next) {
+        present[entry->pid] = true;
+    }
+    
+    for (uint32_t i = 0; i < count; i++) {
+        pid32 pid = hints[i].pid;
+        if (pid < 0 || pid >= NPROC || present[pid]) {
+            continue;
+        }
+        
+        lottery_entry_t *entry = alloc_entry();
+        if (entry == NULL) {
+            break;
+        }
+        
+        /* Migrated processes keep their share; fresh ones get the default */
+        uint32_t tickets = (hints[i].priority != SCHED_HINT_NONE) ?
+            sched_prio_to_tickets(hints[i].priority) : default_tickets;
+        
+        entry->pid = pid;
+        entry->base_tickets = tickets;
+        entry->current_tickets = tickets;
+        
+        entry->next = lottery_pool;
+        lottery_pool = entry;
+        present[pid] = true;
+        
+        total_tickets += tickets;
+        participant_count++;
+    }
+    
+    stats.total_tickets = total_tickets;
+    stats.participant_count = participant_count;
+}
+
 /* Remove a process from the lottery pool permanently */
 void lottery_dequeue(pid32 pid)
 {
@@ -463,6 +537,22 @@ void lottery_compensation_enable(bool enable)
     }
 }
 
+void lottery_set_quantum(uint32_t quantum)
+{
+    lottery_quantum = quantum;
+}
+
+uint32_t lottery_get_quantum(void)
+{
+    return lottery_quantum;
+}
+
+/* Tickets given to a process that joins without a priority hint */
+void lottery_set_default_tickets(uint32_t tickets)
+{
+    default_tickets = tickets;
+}
+
 /* Convert local (process-specific) tickets to global tickets based on current share */
 uint32_t lottery_local_to_global(pid32 pid, uint32_t local_tickets)
 {
@@ -521,10 +611,36 @@ void lottery_tick(void)
     
     if (time_remaining == 0) {
         /* Quantum exhausted, hold new lottery */
+        sched_trace_emit(TRACE_QUANTUM, current_pid, lottery_quantum);
         lottery_schedule();
     }
 }
 
+/* Ticks until the current quantum ends; a lone participant always wins the redraw */
+uint64_t lottery_next_event(void)
+{
+    if (participant_count <= 1) {
+        return SCHED_NO_EVENT;
+    }
+    
+    return (time_remaining > 0) ? time_remaining : 1;
+}
+
+/* Account for ticks skipped while the periodic tick was stopped */
+void lottery_catchup(uint64_t ticks)
+{
+    uint64_t elapsed = (ticks < time_remaining) ? ticks : time_remaining;
+    
+    time_remaining -= (uint32_t)elapsed;
+    
+    if (current_pid >= 0 && elapsed > 0) {
+        lottery_entry_t *entry = find_entry(current_pid);
+        if (entry != NULL) {
+            entry->total_tickets_held += entry->current_tickets * elapsed;
+        }
+    }
+}
+
 void lottery_get_stats(lottery_stats_t *s)
 {
     if (s == NULL) {
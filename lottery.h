@@ -55,6 +55,10 @@ void lottery_enqueue(pid32 pid);
 
 void lottery_dequeue(pid32 pid);
 
+uint32_t lottery_export(sched_hint_t *hints, uint32_t max);
+
+void lottery_enqueue_batch(const sched_hint_t *hints, uint32_t count);
+
 bool lottery_is_participant(pid32 pid);
 
 uint32_t lottery_set_tickets(pid32 pid, uint32_t tickets);
@@ -71,12 +75,24 @@ void lottery_compensate(pid32 pid, float fraction_used);
 
 void lottery_compensation_enable(bool enable);
 
+void lottery_set_quantum(uint32_t quantum);
+
+uint32_t lottery_get_quantum(void);
+
+void lottery_set_default_tickets(uint32_t tickets);
+
 uint32_t lottery_local_to_global(pid32 pid, uint32_t local_tickets);
 
 void lottery_inflate(float factor);
 
 void lottery_tick(void);
 
+bool lottery_check_preempt_wakeup(pid32 pid);
+
+uint64_t lottery_next_event(void);
+
+void lottery_catchup(uint64_t ticks);
+
 void lottery_get_stats(lottery_stats_t *stats);
 
 void lottery_reset_stats(void);
@@ -3,6 +3,8 @@
 #include <stddef.h>
 #include "multilevel_queue.h"
 #include "scheduler.h"
+#include "sched_trace.h"
+#include "sched_timer.h"
 #include "../include/kernel.h"
 #include "../include/process.h"
 #include "../include/interrupts.h"
@@ -12,6 +14,8 @@ static mlfq_queue_t mlfq_queues[MLFQ_NUM_LEVELS];
 static mlfq_node_t mlfq_node_pool[NPROC];
 static mlfq_node_t *mlfq_free_nodes = NULL;
 
+static mlfq_node_t *mlfq_pid_nodes[NPROC];
+
 static uint32_t level_quantums[MLFQ_NUM_LEVELS] = {
     MLFQ_Q0_QUANTUM, MLFQ_Q1_QUANTUM, MLFQ_Q2_QUANTUM, MLFQ_Q3_QUANTUM,
     MLFQ_Q4_QUANTUM, MLFQ_Q5_QUANTUM, MLFQ_Q6_QUANTUM, MLFQ_Q7_QUANTUM
@@ -21,22 +25,20 @@ static uint32_t level_allotments[MLFQ_NUM_LEVELS];
 
 static bool boost_enabled = true;
 static uint32_t boost_interval = MLFQ_BOOST_INTERVAL;
-static uint32_t boost_counter = 0;
+static sched_timer_t boost_timer;
+static bool boost_active = false;
 
 static bool io_bonus_enabled = true;
 
 static mlfq_node_t *current_node = NULL;
-static uint32_t current_time_used = 0;
+static uint64_t slice_start = 0;
 
 static mlfq_stats_t mlfq_stats;
 
-static uint64_t mlfq_ticks = 0;
-
 static sid32 mlfq_lock;
 
 extern proc_t proctab[];
 extern pid32 currpid;
-extern void context_switch(pid32 oldpid, pid32 newpid);
 
 static scheduler_ops_t mlfq_ops = {
     .name = "Multi-Level Feedback Queue",
@@ -48,6 +50,9 @@ static scheduler_ops_t mlfq_ops = {
     .enqueue = mlfq_enqueue,
     .dequeue = mlfq_dequeue,
     .pick_next = mlfq_pick_next,
+    .check_preempt_wakeup = mlfq_check_preempt_wakeup,
+    .export_runnable = mlfq_export,
+    .enqueue_batch = mlfq_enqueue_batch,
     .set_priority = NULL,
     .get_priority = NULL,
     .boost_priority = mlfq_promote,
@@ -55,6 +60,8 @@ static scheduler_ops_t mlfq_ops = {
     .set_quantum = NULL,
     .get_quantum = NULL,
     .tick = mlfq_tick,
+    .next_event = mlfq_next_event,
+    .catchup = mlfq_catchup,
     .get_stats = NULL,
     .reset_stats = mlfq_reset_stats,
     .print_stats = mlfq_print_stats
@@ -70,6 +77,10 @@ static void mlfq_pool_init(void) {
         mlfq_node_pool[i].pid = -1;
     }
     mlfq_node_pool[NPROC - 1].next = NULL;
+    
+    for (i = 0; i < NPROC; i++) {
+        mlfq_pid_nodes[i] = NULL;
+    }
 }
 
 static mlfq_node_t *mlfq_node_alloc(void) {
@@ -104,22 +115,29 @@ static void mlfq_node_free(mlfq_node_t *node) {
 }
 
 static mlfq_node_t *mlfq_find_node(pid32 pid, uint32_t *out_level) {
-    int level;
     mlfq_node_t *node;
     
-    for (level = 0; level < MLFQ_NUM_LEVELS; level++) {
-        node = mlfq_queues[level].head;
-        while (node != NULL) {
-            if (node->pid == pid) {
-                if (out_level != NULL) {
-                }
-                return node;
-            }
-            node = node->next;
-        }
+    if (pid < 0 || pid >= NPROC) {
+        return NULL;
     }
     
-    return NULL;
+    node = mlfq_pid_nodes[pid];
+    if (node != NULL && out_level != NULL) {
+        *out_level = node->level;
+    }
+    
+    return node;
+}
+
+static uint32_t mlfq_start_level(pid32 pid) {
+    if (proctab[pid].pprio >= 75) {
+        return 0;
+    } else if (proctab[pid].pprio >= 50) {
+        return 2;
+    } else if (proctab[pid].pprio >= 25) {
+        return 4;
+    }
+    return 6;
 }
 
 static void mlfq_add_to_level(mlfq_node_t *node, uint32_t level) {
@@ -170,6 +188,22 @@ static void mlfq_remove_from_queue(mlfq_node_t *node) {
     node->prev = NULL;
 }
 
+static void mlfq_boost_arm(void) {
+    if (!boost_enabled || !boost_active) {
+        sched_timer_cancel(&boost_timer);
+        return;
+    }
+    
+    sched_timer_arm(&boost_timer, sched_get_time() + ((boost_interval > 0) ? boost_interval : 1));
+}
+
+static void mlfq_boost_expire(void *arg) {
+    (void)arg;
+    
+    mlfq_priority_boost();
+    mlfq_boost_arm();
+}
+
 void mlfq_init(void) {
     int i;
     intmask mask;
@@ -189,19 +223,20 @@ void mlfq_init(void) {
     
     boost_enabled = true;
     boost_interval = MLFQ_BOOST_INTERVAL;
-    boost_counter = 0;
+    boost_active = true;
+    sched_timer_cancel(&boost_timer);
+    sched_timer_setup(&boost_timer, mlfq_boost_expire, NULL);
+    mlfq_boost_arm();
     
     io_bonus_enabled = true;
     
     current_node = NULL;
-    current_time_used = 0;
+    slice_start = sched_clock();
     
     memset(&mlfq_stats, 0, sizeof(mlfq_stats));
     
     mlfq_lock = semcreate(1);
     
-    mlfq_ticks = 0;
-    
     restore(mask);
 }
 
@@ -217,8 +252,15 @@ void mlfq_shutdown(void) {
         mlfq_queues[i].count = 0;
     }
     
+    for (i = 0; i < NPROC; i++) {
+        mlfq_pid_nodes[i] = NULL;
+    }
+    
     current_node = NULL;
     
+    boost_active = false;
+    sched_timer_cancel(&boost_timer);
+    
     restore(mask);
 }
 
@@ -251,23 +293,74 @@ void mlfq_enqueue(pid32 pid) {
         return;
     }
     
-    if (proctab[pid].pprio >= 75) {
-        start_level = 0;
-    } else if (proctab[pid].pprio >= 50) {
-        start_level = 2;
-    } else if (proctab[pid].pprio >= 25) {
-        start_level = 4;
-    } else {
-        start_level = 6;
-    }
+    start_level = mlfq_start_level(pid);
     
     node->pid = pid;
     node->time_allotment = level_allotments[start_level];
     node->time_used = 0;
-    node->arrival_time = mlfq_ticks;
+    node->arrival_time = sched_clock();
     node->io_count = 0;
     
     mlfq_add_to_level(node, start_level);
+    mlfq_pid_nodes[pid] = node;
+    
+    signal(mlfq_lock);
+    restore(mask);
+}
+
+uint32_t mlfq_export(sched_hint_t *hints, uint32_t max) {
+    int level;
+    mlfq_node_t *node;
+    uint32_t count = 0;
+    intmask mask;
+    
+    mask = disable();
+    
+    for (level = 0; level < MLFQ_NUM_LEVELS; level++) {
+        node = mlfq_queues[level].head;
+        while (node != NULL && count < max) {
+            hints[count].pid = node->pid;
+            hints[count].priority = proctab[node->pid].pprio;
+            count++;
+            node = node->next;
+        }
+    }
+    
+    restore(mask);
+    
+    return count;
+}
+
+void mlfq_enqueue_batch(const sched_hint_t *hints, uint32_t count) {
+    mlfq_node_t *node;
+    uint32_t start_level;
+    pid32 pid;
+    uint32_t i;
+    intmask mask;
+    
+    mask = disable();
+    wait(mlfq_lock);
+    
+    for (i = 0; i < count; i++) {
+        pid = hints[i].pid;
+        if (pid < 0 || pid >= NPROC || mlfq_pid_nodes[pid] != NULL) {
+            continue;
+        }
+        
+        node = mlfq_node_alloc();
+        if (node == NULL) {
+            break;
+        }
+        
+        start_level = mlfq_start_level(pid);
+        
+        node->pid = pid;
+        node->time_allotment = level_allotments[start_level];
+        node->arrival_time = sched_clock();
+        
+        mlfq_add_to_level(node, start_level);
+        mlfq_pid_nodes[pid] = node;
+    }
     
     signal(mlfq_lock);
     restore(mask);
@@ -297,6 +390,7 @@ void mlfq_dequeue(pid32 pid) {
     }
     
     mlfq_remove_from_queue(node);
+    mlfq_pid_nodes[pid] = NULL;
     
     mlfq_node_free(node);
     
@@ -316,6 +410,21 @@ pid32 mlfq_pick_next(void) {
     return -1;
 }
 
+bool mlfq_check_preempt_wakeup(pid32 pid) {
+    uint32_t level, curr_level;
+    
+    if (currpid < 0 || currpid >= NPROC || proctab[currpid].pstate != PR_CURR ||
+        mlfq_find_node(currpid, &curr_level) == NULL) {
+        return true;
+    }
+    
+    if (mlfq_find_node(pid, &level) == NULL) {
+        return false;
+    }
+    
+    return level < curr_level;
+}
+
 void mlfq_move_to_level(pid32 pid, uint32_t level) {
     mlfq_node_t *node;
     uint32_t old_level;
@@ -337,7 +446,7 @@ void mlfq_move_to_level(pid32 pid, uint32_t level) {
     
     node->time_allotment = level_allotments[level];
     node->time_used = 0;
-    node->arrival_time = mlfq_ticks;
+    node->arrival_time = sched_clock();
     
     mlfq_add_to_level(node, level);
     
@@ -370,7 +479,7 @@ void mlfq_demote(pid32 pid) {
     level++;
     node->time_allotment = level_allotments[level];
     node->time_used = 0;
-    node->arrival_time = mlfq_ticks;
+    node->arrival_time = sched_clock();
     
     mlfq_add_to_level(node, level);
     
@@ -402,7 +511,7 @@ void mlfq_promote(pid32 pid) {
     level--;
     node->time_allotment = level_allotments[level];
     node->time_used = 0;
-    node->arrival_time = mlfq_ticks;
+    node->arrival_time = sched_clock();
     
     mlfq_add_to_level(node, level);
     
@@ -430,6 +539,10 @@ void mlfq_schedule(void) {
     }
     
     next_node = mlfq_find_node(next_pid, &level);
+    if (next_node == NULL) {
+        restore(mask);
+        return;
+    }
     
     if (next_pid != currpid) {
         old_pid = currpid;
@@ -442,12 +555,12 @@ void mlfq_schedule(void) {
         currpid = next_pid;
         
         current_node = next_node;
-        current_time_used = 0;
+        slice_start = sched_clock();
         
         mlfq_stats.context_switches++;
         mlfq_stats.per_level_time[level]++;
         
-        context_switch(old_pid, next_pid);
+        sched_switch(old_pid, next_pid);
     }
     
     restore(mask);
@@ -527,7 +640,7 @@ void mlfq_priority_boost(void) {
             
             node->time_allotment = level_allotments[0];
             node->time_used = 0;
-            node->arrival_time = mlfq_ticks;
+            node->arrival_time = sched_clock();
             
             mlfq_add_to_level(node, 0);
             
@@ -543,10 +656,12 @@ void mlfq_priority_boost(void) {
 
 void mlfq_set_boost_interval(uint32_t ticks) {
     boost_interval = ticks;
+    mlfq_boost_arm();
 }
 
 void mlfq_boost_enable(bool enable) {
     boost_enabled = enable;
+    mlfq_boost_arm();
 }
 
 uint32_t mlfq_get_quantum(uint32_t level) {
@@ -572,26 +687,39 @@ void mlfq_tick(void) {
     
     mask = disable();
     
-    mlfq_ticks++;
-    current_time_used++;
-    
     if (current_node != NULL) {
         mlfq_stats.per_level_time[current_node->level]++;
         
         uint32_t quantum = level_quantums[current_node->level];
-        if (current_time_used >= quantum) {
-
-            extern volatile bool need_resched;
-            need_resched = true;
+        if (sched_clock() - slice_start >= quantum * SCHED_TICK_NS) {
+            sched_trace_emit(TRACE_QUANTUM, current_node->pid, quantum);
+            sched_set_resched();
         }
     }
     
-    if (boost_enabled) {
-        boost_counter++;
-        if (boost_counter >= boost_interval) {
-            mlfq_priority_boost();
-            boost_counter = 0;
-        }
+    restore(mask);
+}
+
+uint64_t mlfq_next_event(void) {
+    uint64_t used, quantum;
+    
+    if (current_node == NULL) {
+        return SCHED_NO_EVENT;
+    }
+    
+    used = sched_clock() - slice_start;
+    quantum = level_quantums[current_node->level] * SCHED_TICK_NS;
+    
+    return (used < quantum) ? (quantum - used + SCHED_TICK_NS - 1) / SCHED_TICK_NS : 1;
+}
+
+void mlfq_catchup(uint64_t ticks) {
+    intmask mask;
+    
+    mask = disable();
+    
+    if (current_node != NULL) {
+        mlfq_stats.per_level_time[current_node->level] += ticks;
     }
     
     restore(mask);
@@ -761,6 +889,11 @@ bool mlfq_validate(void) {
                 valid = false;
             }
             
+            if (node->pid >= 0 && node->pid < NPROC && mlfq_pid_nodes[node->pid] != node) {
+                kprintf("MLFQ: PID %d not indexed at level %d\n", node->pid, level);
+                valid = false;
+            }
+            
             if (node->level != level) {
                 kprintf("MLFQ: Level mismatch: node says %u, queue is %d\n",
                         node->level, level);
@@ -61,6 +61,12 @@ void mlfq_dequeue(pid32 pid);
 
 pid32 mlfq_pick_next(void);
 
+bool mlfq_check_preempt_wakeup(pid32 pid);
+
+uint32_t mlfq_export(sched_hint_t *hints, uint32_t max);
+
+void mlfq_enqueue_batch(const sched_hint_t *hints, uint32_t count);
+
 void mlfq_move_to_level(pid32 pid, uint32_t level);
 
 void mlfq_demote(pid32 pid);
@@ -79,6 +85,10 @@ void mlfq_set_quantum(uint32_t level, uint32_t quantum);
 
 void mlfq_tick(void);
 
+uint64_t mlfq_next_event(void);
+
+void mlfq_catchup(uint64_t ticks);
+
 void mlfq_io_done(pid32 pid);
 
 void mlfq_io_bonus_enable(bool enable);
@@ -9,24 +9,27 @@
 
 static prio_node_t *prio_queue = NULL;
 
+static prio_node_t *prio_wait_head = NULL;
+static prio_node_t *prio_wait_tail = NULL;
+
 static prio_node_t prio_node_pool[NPROC];
 static prio_node_t *prio_free_nodes = NULL;
 
 static uint32_t prio_queue_count = 0;
 
+static pid32 prio_curr_pid = -1;
+static uint32_t prio_curr_prio = 0;
+
 static bool aging_enabled = PRIO_AGING_ENABLED;
 static uint32_t aging_interval = PRIO_AGING_INTERVAL;
 static uint32_t aging_counter = 0;
 
 static prio_stats_t prio_stats;
 
-static uint64_t prio_ticks = 0;
-
 static sid32 prio_lock;
 
 extern proc_t proctab[];
 extern pid32 currpid;
-extern void context_switch(pid32 oldpid, pid32 newpid);
 
 static scheduler_ops_t prio_ops = {
     .name = "Priority",
@@ -38,6 +41,9 @@ static scheduler_ops_t prio_ops = {
     .enqueue = priority_enqueue,
     .dequeue = priority_dequeue,
     .pick_next = priority_pick_next,
+    .check_preempt_wakeup = priority_check_preempt_wakeup,
+    .export_runnable = priority_export,
+    .enqueue_batch = priority_enqueue_batch,
     .set_priority = priority_set,
     .get_priority = priority_get,
     .boost_priority = priority_boost,
@@ -45,6 +51,8 @@ static scheduler_ops_t prio_ops = {
     .set_quantum = NULL,
     .get_quantum = NULL,
     .tick = priority_tick,
+    .next_event = priority_next_event,
+    .catchup = priority_catchup,
     .get_stats = NULL,
     .reset_stats = priority_reset_stats,
     .print_stats = priority_print_stats
@@ -72,10 +80,12 @@ static prio_node_t *prio_node_alloc(void) {
     prio_free_nodes = prio_free_nodes->next;
     
     node->next = NULL;
+    node->wait_next = NULL;
+    node->wait_prev = NULL;
     node->pid = -1;
     node->base_priority = PRIORITY_DEFAULT;
     node->current_priority = PRIORITY_DEFAULT;
-    node->wait_time = 0;
+    node->wait_start = sched_clock();
     node->last_run = 0;
     node->cpu_burst = 0;
     node->io_bound = false;
@@ -92,6 +102,32 @@ static void prio_node_free(prio_node_t *node) {
     prio_free_nodes = node;
 }
 
+static void prio_wait_push(prio_node_t *node) {
+    node->wait_next = NULL;
+    node->wait_prev = prio_wait_tail;
+    if (prio_wait_tail == NULL) {
+        prio_wait_head = node;
+    } else {
+        prio_wait_tail->wait_next = node;
+    }
+    prio_wait_tail = node;
+}
+
+static void prio_wait_remove(prio_node_t *node) {
+    if (node->wait_prev == NULL) {
+        prio_wait_head = node->wait_next;
+    } else {
+        node->wait_prev->wait_next = node->wait_next;
+    }
+    if (node->wait_next == NULL) {
+        prio_wait_tail = node->wait_prev;
+    } else {
+        node->wait_next->wait_prev = node->wait_prev;
+    }
+    node->wait_next = NULL;
+    node->wait_prev = NULL;
+}
+
 static prio_node_t *prio_find_node(pid32 pid) {
     prio_node_t *node = prio_queue;
     
@@ -105,6 +141,71 @@ static prio_node_t *prio_find_node(pid32 pid) {
     return NULL;
 }
 
+static void prio_reposition(prio_node_t *node) {
+    prio_node_t **link;
+    
+    for (link = &prio_queue; *link != NULL && *link != node; link = &(*link)->next) {
+    }
+    if (*link == NULL) {
+        return;
+    }
+    *link = node->next;
+    
+    for (link = &prio_queue; *link != NULL && (*link)->current_priority >= node->current_priority;
+         link = &(*link)->next) {
+    }
+    node->next = *link;
+    *link = node;
+}
+
+static uint32_t prio_effective(pid32 pid) {
+    if (pid == prio_curr_pid && prio_curr_prio > proctab[pid].pprio) {
+        return prio_curr_prio;
+    }
+    
+    return proctab[pid].pprio;
+}
+
+static prio_node_t *prio_merge(prio_node_t *a, prio_node_t *b) {
+    prio_node_t head;
+    prio_node_t *tail = &head;
+    
+    while (a != NULL && b != NULL) {
+        if (a->current_priority >= b->current_priority) {
+            tail->next = a;
+            a = a->next;
+        } else {
+            tail->next = b;
+            b = b->next;
+        }
+        tail = tail->next;
+    }
+    
+    tail->next = (a != NULL) ? a : b;
+    
+    return head.next;
+}
+
+static prio_node_t *prio_sort(prio_node_t *list) {
+    prio_node_t *slow, *fast, *half;
+    
+    if (list == NULL || list->next == NULL) {
+        return list;
+    }
+    
+    slow = list;
+    fast = list->next;
+    while (fast != NULL && fast->next != NULL) {
+        slow = slow->next;
+        fast = fast->next->next;
+    }
+    
+    half = slow->next;
+    slow->next = NULL;
+    
+    return prio_merge(prio_sort(list), prio_sort(half));
+}
+
 void priority_init(void) {
     intmask mask;
     
@@ -113,8 +214,13 @@ void priority_init(void) {
     prio_pool_init();
     
     prio_queue = NULL;
+    prio_wait_head = NULL;
+    prio_wait_tail = NULL;
     prio_queue_count = 0;
     
+    prio_curr_pid = -1;
+    prio_curr_prio = 0;
+    
     aging_enabled = PRIO_AGING_ENABLED;
     aging_interval = PRIO_AGING_INTERVAL;
     aging_counter = 0;
@@ -123,8 +229,6 @@ void priority_init(void) {
     
     prio_lock = semcreate(1);
     
-    prio_ticks = 0;
-    
     restore(mask);
 }
 
@@ -134,6 +238,8 @@ void priority_shutdown(void) {
     mask = disable();
     
     prio_queue = NULL;
+    prio_wait_head = NULL;
+    prio_wait_tail = NULL;
     prio_queue_count = 0;
     
     restore(mask);
@@ -155,8 +261,9 @@ void priority_insert_ordered(pid32 pid) {
     node->pid = pid;
     node->base_priority = proctab[pid].pprio;
     node->current_priority = proctab[pid].pprio;
-    node->wait_time = 0;
-    node->last_run = prio_ticks;
+    node->wait_start = sched_clock();
+    node->last_run = node->wait_start;
+    prio_wait_push(node);
     
     priority = node->current_priority;
     
@@ -201,6 +308,71 @@ void priority_enqueue(pid32 pid) {
     restore(mask);
 }
 
+uint32_t priority_export(sched_hint_t *hints, uint32_t max) {
+    prio_node_t *node;
+    uint32_t count = 0;
+    intmask mask;
+    
+    mask = disable();
+    
+    node = prio_queue;
+    while (node != NULL && count < max) {
+        hints[count].pid = node->pid;
+        hints[count].priority = node->base_priority;
+        count++;
+        node = node->next;
+    }
+    
+    restore(mask);
+    
+    return count;
+}
+
+void priority_enqueue_batch(const sched_hint_t *hints, uint32_t count) {
+    bool queued[NPROC];
+    prio_node_t *node, *batch = NULL, **tail = &batch;
+    pid32 pid;
+    uint32_t i;
+    intmask mask;
+    
+    mask = disable();
+    wait(prio_lock);
+    
+    memset(queued, 0, sizeof(queued));
+    for (node = prio_queue; node != NULL; node = node->next) {
+        queued[node->pid] = true;
+    }
+    
+    for (i = 0; i < count; i++) {
+        pid = hints[i].pid;
+        if (pid < 0 || pid >= NPROC || queued[pid]) {
+            continue;
+        }
+        
+        node = prio_node_alloc();
+        if (node == NULL) {
+            break;
+        }
+        
+        node->pid = pid;
+        node->base_priority = proctab[pid].pprio;
+        node->current_priority = proctab[pid].pprio;
+        node->last_run = sched_clock();
+        prio_wait_push(node);
+        *tail = node;
+        tail = &node->next;
+        queued[pid] = true;
+        
+        prio_queue_count++;
+    }
+    
+    prio_queue = prio_merge(prio_queue, prio_sort(batch));
+    prio_stats.current_queue_length = prio_queue_count;
+    
+    signal(prio_lock);
+    restore(mask);
+}
+
 void priority_dequeue(pid32 pid) {
     prio_node_t *prev, *curr;
     intmask mask;
@@ -235,6 +407,7 @@ void priority_dequeue(pid32 pid) {
     prio_queue_count--;
     prio_stats.current_queue_length = prio_queue_count;
     
+    prio_wait_remove(curr);
     prio_node_free(curr);
     
     signal(prio_lock);
@@ -249,6 +422,14 @@ pid32 priority_pick_next(void) {
     return prio_queue->pid;
 }
 
+bool priority_check_preempt_wakeup(pid32 pid) {
+    if (currpid < 0 || currpid >= NPROC || proctab[currpid].pstate != PR_CURR) {
+        return true;
+    }
+    
+    return proctab[pid].pprio > prio_effective(currpid);
+}
+
 void priority_schedule(void) {
     pid32 next_pid;
     pid32 old_pid;
@@ -270,27 +451,37 @@ void priority_schedule(void) {
         old_pid = currpid;
         
         if (proctab[old_pid].pstate == PR_CURR) {
+            if (prio_queue->current_priority <= prio_effective(old_pid)) {
+                restore(mask);
+                return;
+            }
+            
             proctab[old_pid].pstate = PR_READY;
+            priority_enqueue(old_pid);
         }
         
         proctab[next_pid].pstate = PR_CURR;
         currpid = next_pid;
         
         next_node = prio_find_node(next_pid);
+        prio_curr_pid = next_pid;
+        prio_curr_prio = proctab[next_pid].pprio;
         if (next_node != NULL) {
-
+            prio_curr_prio = next_node->current_priority;
+            next_node->last_run = sched_clock();
+            prio_stats.total_wait_time += next_node->last_run - next_node->wait_start;
+            prio_stats.wait_samples++;
             prio_stats.avg_wait_time = 
-                (prio_stats.avg_wait_time + next_node->wait_time) / 2;
+                prio_stats.total_wait_time / prio_stats.wait_samples;
             
-            next_node->wait_time = 0;
-            next_node->last_run = prio_ticks;
+            next_node->wait_start = next_node->last_run;
         }
         
         priority_dequeue(next_pid);
         
         prio_stats.context_switches++;
         
-        context_switch(old_pid, next_pid);
+        sched_switch(old_pid, next_pid);
     }
     
     restore(mask);
@@ -344,6 +535,9 @@ void priority_set(pid32 pid, uint32_t priority) {
     wait(prio_lock);
     
     proctab[pid].pprio = priority;
+    if (pid == prio_curr_pid) {
+        prio_curr_prio = priority;
+    }
     
     node = prio_find_node(pid);
     if (node != NULL) {
@@ -366,6 +560,7 @@ void priority_set(pid32 pid, uint32_t priority) {
             }
             prio_queue_count--;
             
+            prio_wait_remove(node);
             prio_node_free(node);
             priority_insert_ordered(pid);
         }
@@ -377,8 +572,7 @@ void priority_set(pid32 pid, uint32_t priority) {
     restore(mask);
     
     if (proctab[pid].pstate == PR_READY || pid == currpid) {
-        extern volatile bool need_resched;
-        need_resched = true;
+        sched_set_resched();
     }
 }
 
@@ -419,7 +613,7 @@ void priority_boost(pid32 pid) {
     if (node != NULL) {
         if (node->current_priority < PRIORITY_MAX) {
             node->current_priority++;
-            
+            prio_reposition(node);
         }
     } else {
         if (proctab[pid].pprio < PRIORITY_MAX) {
@@ -444,7 +638,10 @@ void priority_decay(pid32 pid) {
     if (node != NULL) {
         if (node->current_priority > node->base_priority) {
             node->current_priority--;
+            prio_reposition(node);
         }
+    } else if (pid == prio_curr_pid && prio_curr_prio > proctab[pid].pprio) {
+        prio_curr_prio--;
     }
     
     restore(mask);
@@ -462,14 +659,40 @@ void priority_reset(pid32 pid) {
     
     node = prio_find_node(pid);
     if (node != NULL) {
-        node->current_priority = node->base_priority;
+        if (node->current_priority != node->base_priority) {
+            node->current_priority = node->base_priority;
+            prio_reposition(node);
+        }
+    } else if (pid == prio_curr_pid) {
+        prio_curr_prio = proctab[pid].pprio;
     }
     
     restore(mask);
 }
 
-void priority_age_all(void) {
+static void prio_age(uint64_t rounds) {
     prio_node_t *node;
+    uint64_t needed;
+    uint32_t gap;
+    
+    for (node = prio_queue; node != NULL; node = node->next) {
+        if (node->current_priority >= PRIORITY_MAX) {
+            continue;
+        }
+        
+        gap = PRIORITY_MAX - node->current_priority;
+        needed = (gap + PRIO_AGING_AMOUNT - 1) / PRIO_AGING_AMOUNT;
+        if (rounds >= needed) {
+            node->current_priority = PRIORITY_MAX;
+            prio_stats.aging_boosts += (uint32_t)needed;
+        } else {
+            node->current_priority += (uint32_t)rounds * PRIO_AGING_AMOUNT;
+            prio_stats.aging_boosts += (uint32_t)rounds;
+        }
+    }
+}
+
+void priority_age_all(void) {
     intmask mask;
     
     if (!aging_enabled) {
@@ -477,41 +700,32 @@ void priority_age_all(void) {
     }
     
     mask = disable();
-    
-    node = prio_queue;
-    while (node != NULL) {
-
-        if (node->current_priority < PRIORITY_MAX) {
-            node->current_priority += PRIO_AGING_AMOUNT;
-            if (node->current_priority > PRIORITY_MAX) {
-                node->current_priority = PRIORITY_MAX;
-            }
-            prio_stats.aging_boosts++;
-        }
-        node = node->next;
-    }
-    
+    prio_age(1);
     restore(mask);
 }
 
 void priority_check_starvation(void) {
     prio_node_t *node;
+    uint64_t now;
     intmask mask;
     
     mask = disable();
     
-    node = prio_queue;
-    while (node != NULL) {
-        if (node->wait_time > PRIO_STARVATION_THRESHOLD) {
-
-            node->current_priority += PRIO_STARVATION_BOOST;
-            if (node->current_priority > PRIORITY_MAX) {
-                node->current_priority = PRIORITY_MAX;
-            }
-            prio_stats.starvation_boosts++;
-            node->wait_time = 0;
+    now = sched_clock();
+    while (prio_wait_head != NULL &&
+           now - prio_wait_head->wait_start > PRIO_STARVATION_THRESHOLD * SCHED_TICK_NS) {
+        node = prio_wait_head;
+        
+        node->current_priority += PRIO_STARVATION_BOOST;
+        if (node->current_priority > PRIORITY_MAX) {
+            node->current_priority = PRIORITY_MAX;
         }
-        node = node->next;
+        prio_stats.starvation_boosts++;
+        node->wait_start = now;
+        
+        prio_reposition(node);
+        prio_wait_remove(node);
+        prio_wait_push(node);
     }
     
     restore(mask);
@@ -526,19 +740,10 @@ void priority_set_aging_interval(uint32_t ticks) {
 }
 
 void priority_tick(void) {
-    prio_node_t *node;
     intmask mask;
     
     mask = disable();
     
-    prio_ticks++;
-    
-    node = prio_queue;
-    while (node != NULL) {
-        node->wait_time++;
-        node = node->next;
-    }
-    
     if (aging_enabled) {
         aging_counter++;
         if (aging_counter >= aging_interval) {
@@ -549,14 +754,56 @@ void priority_tick(void) {
     
     priority_check_starvation();
     
-    if (prio_queue != NULL && currpid >= 0) {
-        pid32 top_pid = prio_queue->pid;
-        if (proctab[top_pid].pprio > proctab[currpid].pprio) {
-            extern volatile bool need_resched;
-            need_resched = true;
+    if (prio_queue != NULL && currpid >= 0 && currpid < NPROC &&
+        prio_queue->current_priority > prio_effective(currpid)) {
+        sched_set_resched();
+    }
+    
+    restore(mask);
+}
+
+uint64_t priority_next_event(void) {
+    uint64_t next, due, now;
+    
+    if (prio_queue == NULL) {
+        return SCHED_NO_EVENT;
+    }
+    
+    next = SCHED_NO_EVENT;
+    
+    if (aging_enabled) {
+        next = (aging_counter < aging_interval) ?
+               aging_interval - aging_counter : 1;
+    }
+    
+    if (prio_wait_head != NULL) {
+        now = sched_clock();
+        due = prio_wait_head->wait_start + PRIO_STARVATION_THRESHOLD * SCHED_TICK_NS + 1;
+        due = (due > now) ? (due - now + SCHED_TICK_NS - 1) / SCHED_TICK_NS : 1;
+        if (due < next) {
+            next = due;
+        }
+    }
+    
+    return next;
+}
+
+void priority_catchup(uint64_t ticks) {
+    uint64_t rounds;
+    intmask mask;
+    
+    mask = disable();
+    
+    if (aging_enabled && aging_interval > 0) {
+        rounds = (aging_counter + ticks) / aging_interval;
+        aging_counter = (uint32_t)((aging_counter + ticks) % aging_interval);
+        if (rounds > 0) {
+            prio_age(rounds);
         }
     }
     
+    priority_check_starvation();
+    
     restore(mask);
 }
 
@@ -594,7 +841,7 @@ void priority_print_stats(void) {
     kprintf("Preemptions: %u\n", prio_stats.preemptions);
     kprintf("Aging Boosts: %u\n", prio_stats.aging_boosts);
     kprintf("Starvation Boosts: %u\n", prio_stats.starvation_boosts);
-    kprintf("Avg Wait Time: %u ticks\n", prio_stats.avg_wait_time);
+    kprintf("Avg Wait Time: %llu ns\n", prio_stats.avg_wait_time);
     kprintf("Aging: %s (interval: %u)\n", 
             aging_enabled ? "enabled" : "disabled", aging_interval);
     
@@ -609,14 +856,14 @@ void priority_print_queue(void) {
     
     kprintf("\n=== Priority Queue ===\n");
     kprintf("Count: %u\n", prio_queue_count);
-    kprintf("PID   BasePri  CurrPri  WaitTime  LastRun\n");
-    kprintf("----  -------  -------  --------  -------\n");
+    kprintf("PID   BasePri  CurrPri   WaitTime(ns)    LastRun(ns)\n");
+    kprintf("----  -------  -------  -------------  -------------\n");
     
     node = prio_queue;
     while (node != NULL) {
-        kprintf("%4d  %7u  %7u  %8llu  %7llu\n",
+        kprintf("%4d  %7u  %7u  %13llu  %13llu\n",
                 node->pid, node->base_priority, node->current_priority,
-                node->wait_time, node->last_run);
+                sched_clock() - node->wait_start, node->last_run);
         node = node->next;
     }
     
@@ -627,7 +874,7 @@ void priority_print_queue(void) {
 
 bool priority_validate(void) {
     prio_node_t *node, *prev;
-    int count = 0;
+    uint32_t count = 0;
     bool valid = true;
     intmask mask;
     
@@ -650,6 +897,12 @@ bool priority_validate(void) {
             valid = false;
         }
         
+        if (node->current_priority < node->base_priority) {
+            kprintf("PRIO: PID %d priority %u below base %u\n", node->pid,
+                    node->current_priority, node->base_priority);
+            valid = false;
+        }
+        
         prev = node;
         node = node->next;
         
@@ -661,7 +914,21 @@ bool priority_validate(void) {
     }
     
     if (count != prio_queue_count) {
-        kprintf("PRIO: Count mismatch: %d vs %u\n", count, prio_queue_count);
+        kprintf("PRIO: Count mismatch: %u vs %u\n", count, prio_queue_count);
+        valid = false;
+    }
+    
+    count = 0;
+    for (node = prio_wait_head; node != NULL && count <= NPROC; node = node->wait_next) {
+        count++;
+        if (node->wait_next != NULL && node->wait_next->wait_start < node->wait_start) {
+            kprintf("PRIO: Wait order violation at PID %d\n", node->pid);
+            valid = false;
+        }
+    }
+    
+    if (count != prio_queue_count) {
+        kprintf("PRIO: Wait list count mismatch: %u vs %u\n", count, prio_queue_count);
         valid = false;
     }
     
@@ -13,11 +13,13 @@ typedef struct prio_node {
     pid32   pid;
     uint32_t base_priority;
     uint32_t current_priority;
-    uint64_t wait_time;
+    uint64_t wait_start;
     uint64_t last_run;
     uint32_t cpu_burst;
     bool    io_bound;
     struct prio_node *next;
+    struct prio_node *wait_next;
+    struct prio_node *wait_prev;
 } prio_node_t;
 
 typedef struct prio_stats {
@@ -28,7 +30,9 @@ typedef struct prio_stats {
     uint32_t starvation_boosts;
     uint32_t preemptions;
     uint32_t current_queue_length;
-    uint32_t avg_wait_time;
+    uint64_t avg_wait_time;
+    uint64_t total_wait_time;
+    uint64_t wait_samples;
 } prio_stats_t;
 
 void priority_init(void);
@@ -49,8 +53,14 @@ void priority_dequeue(pid32 pid);
 
 pid32 priority_pick_next(void);
 
+bool priority_check_preempt_wakeup(pid32 pid);
+
 void priority_insert_ordered(pid32 pid);
 
+uint32_t priority_export(sched_hint_t *hints, uint32_t max);
+
+void priority_enqueue_batch(const sched_hint_t *hints, uint32_t count);
+
 void priority_set(pid32 pid, uint32_t priority);
 
 uint32_t priority_get(pid32 pid);
@@ -71,6 +81,10 @@ void priority_set_aging_interval(uint32_t ticks);
 
 void priority_tick(void);
 
+uint64_t priority_next_event(void);
+
+void priority_catchup(uint64_t ticks);
+
 void priority_get_stats(prio_stats_t *stats);
 
 void priority_reset_stats(void);
@@ -1,4 +1,5 @@
 #include "realtime.h"
+#include "sched_trace.h"
 #include "../include/kernel.h"
 #include "../include/process.h"
 #include <stdlib.h>
@@ -16,7 +17,8 @@ static uint32_t task_count = 0;
 
 static rt_algorithm_t current_algo = RT_DEFAULT_ALGO;
 
-static uint64_t system_time = 0;
+/* Realtime clock (ticks) minus framework tick, so realtime_set_time() can move it */
+static uint64_t time_offset = 0;
 
 static rt_stats_t stats;
 
@@ -24,12 +26,19 @@ static scheduler_ops_t realtime_ops;
 
 static rt_task_t *all_tasks = NULL;
 
+extern proc_t proctab[];
+
 static rt_task_t *alloc_task(void);
 static void free_task(rt_task_t *task);
 static rt_task_t *find_task(pid32 pid);
+static bool rt_before(rt_task_t *a, rt_task_t *b);
 static void insert_ready(rt_task_t *task);
 static void remove_ready(rt_task_t *task);
+static rt_task_t *merge_ready(rt_task_t *a, rt_task_t *b);
+static rt_task_t *sort_ready(rt_task_t *list);
 static void update_stats_completion(rt_task_t *task);
+static void release_expire(void *arg);
+static void deadline_expire(void *arg);
 
 static rt_task_t *alloc_task(void)
 {
@@ -41,6 +50,8 @@ static rt_task_t *alloc_task(void)
     free_tasks = free_tasks->next;
     
     memset(task, 0, sizeof(rt_task_t));
+    sched_timer_setup(&task->release_timer, release_expire, task);
+    sched_timer_setup(&task->deadline_timer, deadline_expire, task);
     return task;
 }
 
@@ -50,6 +61,9 @@ static void free_task(rt_task_t *task)
         return;
     }
     
+    sched_timer_cancel(&task->release_timer);
+    sched_timer_cancel(&task->deadline_timer);
+    
     task->next = free_tasks;
     free_tasks = task;
 }
@@ -68,6 +82,124 @@ static rt_task_t *find_task(pid32 pid)
     return NULL;
 }
 
+/* Realtime clock in ticks, derived from the framework tick */
+static uint64_t rt_now(void)
+{
+    return sched_get_time() + time_offset;
+}
+
+/* Realtime clock in ns, used for execution budgets and laxity */
+static uint64_t rt_clock(void)
+{
+    return sched_clock() + time_offset * SCHED_TICK_NS;
+}
+
+/* Framework tick at which the realtime clock reaches due */
+static uint64_t wheel_time(uint64_t due)
+{
+    uint64_t now = sched_get_time();
+    
+    return (due > now + time_offset) ? due - time_offset : now;
+}
+
+/* Charge the running job for the time since it was dispatched or last charged */
+static void charge_running(void)
+{
+    if (current_task == NULL || current_task->state != RT_STATE_RUNNING) {
+        return;
+    }
+    
+    uint64_t now = sched_clock();
+    uint64_t elapsed = now - current_task->start_time;
+    
+    current_task->remaining_time = (elapsed < current_task->remaining_time) ?
+                                   current_task->remaining_time - elapsed : 0;
+    current_task->start_time = now;
+}
+
+static bool release_pending(rt_task_t *task)
+{
+    return task->state == RT_STATE_COMPLETED ||
+           task->state == RT_STATE_MISSED ||
+           task->state == RT_STATE_INACTIVE;
+}
+
+static void arm_release(rt_task_t *task)
+{
+    sched_timer_arm(&task->release_timer,
+                    wheel_time(task->release_time + task->params.period));
+}
+
+/* Arm the period and deadline timers of a freshly released job */
+static void arm_job(rt_task_t *task)
+{
+    arm_release(task);
+    sched_timer_arm(&task->deadline_timer, wheel_time(task->absolute_deadline + 1));
+}
+
+static bool release_due(rt_task_t *task)
+{
+    return release_pending(task) &&
+           rt_now() >= task->release_time + task->params.period;
+}
+
+/* The next period began; jobs still running catch it when they complete or miss */
+static void release_expire(void *arg)
+{
+    rt_task_t *task = arg;
+    
+    if (!release_pending(task)) {
+        return;
+    }
+    
+    if (!release_due(task)) {
+        arm_release(task);
+        return;
+    }
+    
+    realtime_release(task);
+}
+
+static void deadline_expire(void *arg)
+{
+    rt_task_t *task = arg;
+    
+    if (task->state != RT_STATE_READY && task->state != RT_STATE_RUNNING) {
+        return;
+    }
+    
+    if (!realtime_check_deadline(task)) {
+        sched_timer_arm(&task->deadline_timer, wheel_time(task->absolute_deadline + 1));
+        return;
+    }
+    
+    realtime_handle_miss(task);
+    
+    if (release_due(task)) {
+        realtime_release(task);
+    } else if (realtime_check_preempt()) {
+        realtime_schedule();
+    }
+}
+
+/* True if a should run before b under the active algorithm */
+static bool rt_before(rt_task_t *a, rt_task_t *b)
+{
+    switch (current_algo) {
+    case RT_ALGO_EDF:
+        return a->absolute_deadline < b->absolute_deadline;
+        
+    case RT_ALGO_RMS:
+    case RT_ALGO_DMS:
+        return a->rms_priority > b->rms_priority;
+        
+    case RT_ALGO_LLF:
+        return a->laxity < b->laxity;
+    }
+    
+    return false;
+}
+
 static void insert_ready(rt_task_t *task)
 {
     if (task == NULL) {
@@ -77,7 +209,7 @@ static void insert_ready(rt_task_t *task)
     task->state = RT_STATE_READY;
     
     if (ready_queue == NULL) {
-        task->next = NULL;
+        task->ready_next = NULL;
         ready_queue = task;
         return;
     }
@@ -85,41 +217,17 @@ static void insert_ready(rt_task_t *task)
     rt_task_t *prev = NULL;
     rt_task_t *curr = ready_queue;
     
-    while (curr != NULL) {
-        bool insert_here = false;
-        
-        switch (current_algo) {
-        case RT_ALGO_EDF:
-
-            insert_here = (task->absolute_deadline < curr->absolute_deadline);
-            break;
-            
-        case RT_ALGO_RMS:
-        case RT_ALGO_DMS:
-
-            insert_here = (task->rms_priority > curr->rms_priority);
-            break;
-            
-        case RT_ALGO_LLF:
-
-            insert_here = (task->laxity < curr->laxity);
-            break;
-        }
-        
-        if (insert_here) {
-            break;
-        }
-        
+    while (curr != NULL && !rt_before(task, curr)) {
         prev = curr;
-        curr = curr->next;
+        curr = curr->ready_next;
     }
     
     if (prev == NULL) {
-        task->next = ready_queue;
+        task->ready_next = ready_queue;
         ready_queue = task;
     } else {
-        task->next = prev->next;
-        prev->next = task;
+        task->ready_next = prev->ready_next;
+        prev->ready_next = task;
     }
 }
 
@@ -130,20 +238,62 @@ static void remove_ready(rt_task_t *task)
     }
     
     if (ready_queue == task) {
-        ready_queue = task->next;
-        task->next = NULL;
+        ready_queue = task->ready_next;
+        task->ready_next = NULL;
         return;
     }
     
     rt_task_t *prev = ready_queue;
-    while (prev->next != NULL && prev->next != task) {
-        prev = prev->next;
+    while (prev->ready_next != NULL && prev->ready_next != task) {
+        prev = prev->ready_next;
+    }
+    
+    if (prev->ready_next == task) {
+        prev->ready_next = task->ready_next;
+        task->ready_next = NULL;
+    }
+}
+
+/* Stable merge of two ready chains; ties keep a's tasks first */
+static rt_task_t *merge_ready(rt_task_t *a, rt_task_t *b)
+{
+    rt_task_t head;
+    rt_task_t *tail = &head;
+    
+    while (a != NULL && b != NULL) {
+        if (rt_before(b, a)) {
+            tail->ready_next = b;
+            b = b->ready_next;
+        } else {
+            tail->ready_next = a;
+            a = a->ready_next;
+        }
+        tail = tail->ready_next;
     }
     
-    if (prev->next == task) {
-        prev->next = task->next;
-        task->next = NULL;
+    tail->ready_next = (a != NULL) ? a : b;
+    
+    return head.ready_next;
+}
+
+/* Merge sort a ready chain in O(n log n) instead of re-inserting each task */
+static rt_task_t *sort_ready(rt_task_t *list)
+{
+    if (list == NULL || list->ready_next == NULL) {
+        return list;
     }
+    
+    rt_task_t *slow = list;
+    rt_task_t *fast = list->ready_next;
+    while (fast != NULL && fast->ready_next != NULL) {
+        slow = slow->ready_next;
+        fast = fast->ready_next->ready_next;
+    }
+    
+    rt_task_t *half = slow->ready_next;
+    slow->ready_next = NULL;
+    
+    return merge_ready(sort_ready(list), sort_ready(half));
 }
 
 void realtime_init(void)
@@ -151,6 +301,8 @@ void realtime_init(void)
 
     free_tasks = NULL;
     for (int i = RT_MAX_TASKS - 1; i >= 0; i--) {
+        sched_timer_cancel(&task_pool[i].release_timer);
+        sched_timer_cancel(&task_pool[i].deadline_timer);
         task_pool[i].next = free_tasks;
         free_tasks = &task_pool[i];
     }
@@ -159,7 +311,7 @@ void realtime_init(void)
     all_tasks = NULL;
     current_task = NULL;
     task_count = 0;
-    system_time = 0;
+    time_offset = 0 - sched_get_time();
     current_algo = RT_DEFAULT_ALGO;
     
     memset(&stats, 0, sizeof(stats));
@@ -171,7 +323,13 @@ void realtime_init(void)
     realtime_ops.preempt = realtime_preempt;
     realtime_ops.enqueue = realtime_enqueue;
     realtime_ops.dequeue = realtime_dequeue;
+    realtime_ops.pick_next = realtime_pick_next;
+    realtime_ops.check_preempt_wakeup = realtime_check_preempt_wakeup;
+    realtime_ops.export_runnable = realtime_export;
+    realtime_ops.enqueue_batch = realtime_enqueue_batch;
     realtime_ops.tick = realtime_tick;
+    realtime_ops.next_event = realtime_next_event;
+    realtime_ops.catchup = realtime_catchup;
     realtime_ops.get_stats = (void (*)(void *))realtime_get_stats;
     realtime_ops.print_stats = realtime_print_stats;
     realtime_ops.type = SCHED_EDF;
@@ -221,15 +379,7 @@ void realtime_set_algorithm(rt_algorithm_t algo)
         break;
     }
     
-    rt_task_t *old_queue = ready_queue;
-    ready_queue = NULL;
-    
-    while (old_queue != NULL) {
-        rt_task_t *task = old_queue;
-        old_queue = old_queue->next;
-        task->next = NULL;
-        insert_ready(task);
-    }
+    ready_queue = sort_ready(ready_queue);
 }
 
 rt_algorithm_t realtime_get_algorithm(void)
@@ -354,7 +504,7 @@ rt_task_t *llf_pick_next(void)
             min_laxity = task->laxity;
             min_task = task;
         }
-        task = task->next;
+        task = task->ready_next;
     }
     
     return min_task;
@@ -362,37 +512,60 @@ rt_task_t *llf_pick_next(void)
 
 void llf_update_laxity(void)
 {
+    charge_running();
+    
+    int64_t now = (int64_t)rt_clock();
     rt_task_t *task = all_tasks;
     while (task != NULL) {
         if (task->state == RT_STATE_READY || task->state == RT_STATE_RUNNING) {
 
-            task->laxity = (int64_t)task->absolute_deadline - 
-                          (int64_t)system_time - 
+            task->laxity = (int64_t)(task->absolute_deadline * SCHED_TICK_NS) - 
+                          now - 
                           (int64_t)task->remaining_time;
         }
         task = task->next;
     }
 }
 
-void realtime_schedule(void)
+/* Best ready task under the active algorithm, left on the ready queue */
+static rt_task_t *pick_ready(void)
 {
-    rt_task_t *next = NULL;
-    
     switch (current_algo) {
     case RT_ALGO_EDF:
-        next = edf_pick_next();
-        break;
+        return edf_pick_next();
     case RT_ALGO_RMS:
-        next = rms_pick_next();
-        break;
+        return rms_pick_next();
     case RT_ALGO_DMS:
-        next = dms_pick_next();
-        break;
+        return dms_pick_next();
     case RT_ALGO_LLF:
-        next = llf_pick_next();
-        break;
+        return llf_pick_next();
+    }
+    
+    return NULL;
+}
+
+/* Pid that should run now; the running task keeps the CPU unless it is outranked */
+pid32 realtime_pick_next(void)
+{
+    if (current_task != NULL && current_task->state == RT_STATE_RUNNING &&
+        !realtime_check_preempt()) {
+        return current_task->pid;
+    }
+    
+    rt_task_t *next = pick_ready();
+    
+    return (next != NULL) ? next->pid : -1;
+}
+
+void realtime_schedule(void)
+{
+    if (current_task != NULL && current_task->state == RT_STATE_RUNNING &&
+        !realtime_check_preempt()) {
+        return;
     }
     
+    rt_task_t *next = pick_ready();
+    
     if (next == NULL) {
 
         current_task = NULL;
@@ -405,6 +578,7 @@ void realtime_schedule(void)
         pid32 old_pid = (current_task != NULL) ? current_task->pid : -1;
         
         if (current_task != NULL && current_task->state == RT_STATE_RUNNING) {
+            charge_running();
             current_task->state = RT_STATE_READY;
             insert_ready(current_task);
             stats.preemptions++;
@@ -412,12 +586,11 @@ void realtime_schedule(void)
         
         current_task = next;
         current_task->state = RT_STATE_RUNNING;
-        current_task->start_time = system_time;
+        current_task->start_time = sched_clock();
         
         stats.context_switches++;
         
-        extern void context_switch(pid32 old, pid32 new);
-        context_switch(old_pid, next->pid);
+        sched_switch(old_pid, next->pid);
     }
 }
 
@@ -425,12 +598,7 @@ void realtime_yield(void)
 {
     if (current_task != NULL) {
 
-        uint64_t elapsed = system_time - current_task->start_time;
-        if (elapsed < current_task->remaining_time) {
-            current_task->remaining_time -= elapsed;
-        } else {
-            current_task->remaining_time = 0;
-        }
+        charge_running();
         
         current_task->state = RT_STATE_READY;
         insert_ready(current_task);
@@ -445,32 +613,52 @@ void realtime_preempt(void)
     realtime_schedule();
 }
 
-bool realtime_check_preempt(void)
+/* Whether task should run ahead of the running task under the current algorithm */
+static bool rt_outranks(rt_task_t *task)
 {
-    if (current_task == NULL) {
-        return ready_queue != NULL;
-    }
-    
-    if (ready_queue == NULL) {
-        return false;
-    }
-    
     switch (current_algo) {
     case RT_ALGO_EDF:
-        return ready_queue->absolute_deadline < current_task->absolute_deadline;
+        return task->absolute_deadline < current_task->absolute_deadline;
         
     case RT_ALGO_RMS:
     case RT_ALGO_DMS:
-        return ready_queue->rms_priority > current_task->rms_priority;
+        return task->rms_priority > current_task->rms_priority;
         
     case RT_ALGO_LLF:
         llf_update_laxity();
-        return ready_queue->laxity < current_task->laxity;
+        return task->laxity < current_task->laxity;
     }
     
     return false;
 }
 
+bool realtime_check_preempt(void)
+{
+    if (current_task == NULL) {
+        return ready_queue != NULL;
+    }
+    
+    if (ready_queue == NULL) {
+        return false;
+    }
+    
+    return rt_outranks(ready_queue);
+}
+
+bool realtime_check_preempt_wakeup(pid32 pid)
+{
+    if (current_task == NULL || current_task->state != RT_STATE_RUNNING) {
+        return true;
+    }
+    
+    rt_task_t *task = find_task(pid);
+    if (task == NULL || task->state != RT_STATE_READY) {
+        return false;
+    }
+    
+    return rt_outranks(task);
+}
+
 void realtime_enqueue(pid32 pid)
 {
     rt_task_t *task = find_task(pid);
@@ -495,6 +683,104 @@ void realtime_enqueue(pid32 pid)
     }
 }
 
+/* Report every task that is ready or running */
+uint32_t realtime_export(sched_hint_t *hints, uint32_t max)
+{
+    uint32_t count = 0;
+    
+    rt_task_t *task = all_tasks;
+    while (task != NULL && count < max) {
+        if (task->state == RT_STATE_READY || task->state == RT_STATE_RUNNING) {
+            hints[count].pid = task->pid;
+            hints[count].priority = proctab[task->pid].pprio;
+            count++;
+        }
+        task = task->next;
+    }
+    
+    return count;
+}
+
+/* Create and release many tasks at once with a single priority assignment and merge */
+void realtime_enqueue_batch(const sched_hint_t *hints, uint32_t count)
+{
+    rt_task_t *by_pid[NPROC];
+    rt_task_t *batch = NULL;
+    rt_task_t **tail = &batch;
+    bool created = false;
+    
+    memset(by_pid, 0, sizeof(by_pid));
+    for (rt_task_t *task = all_tasks; task != NULL; task = task->next) {
+        by_pid[task->pid] = task;
+    }
+    
+    for (uint32_t i = 0; i < count; i++) {
+        pid32 pid = hints[i].pid;
+        if (pid < 0 || pid >= NPROC || by_pid[pid] != NULL) {
+            continue;
+        }
+        
+        rt_task_t *task = alloc_task();
+        if (task == NULL) {
+            break;
+        }
+        
+        task->pid = pid;
+        task->params.period = RT_DEFAULT_PERIOD;
+        task->params.deadline = RT_DEFAULT_DEADLINE;
+        task->params.wcet = RT_DEFAULT_WCET;
+        task->params.miss_policy = RT_DEFAULT_MISS_POLICY;
+        task->state = RT_STATE_INACTIVE;
+        task->remaining_time = (uint64_t)task->params.wcet * SCHED_TICK_NS;
+        task->rms_priority = 1;
+        
+        task->next = all_tasks;
+        all_tasks = task;
+        task_count++;
+        by_pid[pid] = task;
+        created = true;
+    }
+    
+    if (created && current_algo == RT_ALGO_RMS) {
+        rms_assign_priorities();
+    } else if (created && current_algo == RT_ALGO_DMS) {
+        dms_assign_priorities();
+    }
+    
+    for (uint32_t i = 0; i < count; i++) {
+        pid32 pid = hints[i].pid;
+        if (pid < 0 || pid >= NPROC) {
+            continue;
+        }
+        
+        rt_task_t *task = by_pid[pid];
+        if (task == NULL || task->state == RT_STATE_READY ||
+            task->state == RT_STATE_RUNNING) {
+            continue;
+        }
+        
+        task->release_time = rt_now();
+        task->absolute_deadline = task->release_time + task->params.deadline;
+        task->remaining_time = (uint64_t)task->params.wcet * SCHED_TICK_NS;
+        task->laxity = ((int64_t)task->params.deadline - (int64_t)task->params.wcet) *
+                       (int64_t)SCHED_TICK_NS;
+        task->state = RT_STATE_READY;
+        task->instances++;
+        stats.total_releases++;
+        arm_job(task);
+        
+        *tail = task;
+        tail = &task->ready_next;
+    }
+    *tail = NULL;
+    
+    ready_queue = merge_ready(ready_queue, sort_ready(batch));
+    
+    if (realtime_check_preempt()) {
+        realtime_schedule();
+    }
+}
+
 void realtime_dequeue(pid32 pid)
 {
     rt_task_t *task = find_task(pid);
@@ -542,12 +828,14 @@ int realtime_create_task(pid32 pid, rt_task_params_t *params)
     task->pid = pid;
     task->params = *params;
     task->state = RT_STATE_INACTIVE;
-    task->remaining_time = params->wcet;
+    task->remaining_time = (uint64_t)params->wcet * SCHED_TICK_NS;
     
     task->next = all_tasks;
     all_tasks = task;
     task_count++;
     
+    arm_release(task);
+    
     switch (current_algo) {
     case RT_ALGO_RMS:
         rms_assign_priorities();
@@ -597,18 +885,20 @@ void realtime_release(rt_task_t *task)
         return;
     }
     
-    task->release_time = system_time;
-    task->absolute_deadline = system_time + task->params.deadline;
-    task->remaining_time = task->params.wcet;
+    task->release_time = rt_now();
+    task->absolute_deadline = task->release_time + task->params.deadline;
+    task->remaining_time = (uint64_t)task->params.wcet * SCHED_TICK_NS;
     task->state = RT_STATE_READY;
     task->instances++;
     
     if (current_algo == RT_ALGO_LLF) {
-        task->laxity = (int64_t)task->params.deadline - (int64_t)task->params.wcet;
+        task->laxity = ((int64_t)task->params.deadline - (int64_t)task->params.wcet) *
+                       (int64_t)SCHED_TICK_NS;
     }
     
     insert_ready(task);
     stats.total_releases++;
+    arm_job(task);
     
     if (realtime_check_preempt()) {
         realtime_schedule();
@@ -622,19 +912,22 @@ void realtime_complete(pid32 pid)
         return;
     }
     
-    uint64_t response_time = system_time - task->release_time;
+    uint64_t response_time = rt_now() - task->release_time;
     task->total_response_time += response_time;
     if (response_time > task->worst_response_time) {
         task->worst_response_time = response_time;
     }
     
-    uint64_t exec_time = task->params.wcet - task->remaining_time;
+    uint64_t exec_time = (uint64_t)task->params.wcet * SCHED_TICK_NS - task->remaining_time;
     task->total_exec_time += exec_time;
     
     task->state = RT_STATE_COMPLETED;
     task->completions++;
     stats.total_completions++;
     
+    sched_timer_cancel(&task->deadline_timer);
+    arm_release(task);
+    
     update_stats_completion(task);
     
     if (current_task == task) {
@@ -652,7 +945,7 @@ bool realtime_check_deadline(rt_task_t *task)
         return false;
     }
     
-    return system_time > task->absolute_deadline;
+    return rt_now() > task->absolute_deadline;
 }
 
 void realtime_handle_miss(rt_task_t *task)
@@ -664,6 +957,9 @@ void realtime_handle_miss(rt_task_t *task)
     task->state = RT_STATE_MISSED;
     task->deadline_misses++;
     stats.total_deadline_misses++;
+    arm_release(task);
+    
+    sched_trace_emit(TRACE_DEADLINE_MISS, task->pid, (uint32_t)task->deadline_misses);
     
     switch (task->params.miss_policy) {
     case RT_MISS_SKIP:
@@ -685,41 +981,28 @@ void realtime_handle_miss(rt_task_t *task)
         
     case RT_MISS_NOTIFY:
 
-        kprintf("RT: Deadline miss for PID %d at time %llu\n",
-                task->pid, system_time);
+        if (!sched_trace_enabled()) {
+            kprintf("RT: Deadline miss for PID %d at time %llu\n",
+                    task->pid, rt_now());
+        }
         break;
     }
 }
 
 void realtime_tick(void)
 {
-    system_time++;
-    
     if (current_task != NULL && current_task->state == RT_STATE_RUNNING) {
-        if (current_task->remaining_time > 0) {
-            current_task->remaining_time--;
-        }
+        charge_running();
         
         if (current_task->remaining_time == 0) {
             realtime_complete(current_task->pid);
         }
     }
     
-    realtime_check_deadlines();
-    
-    realtime_check_releases();
-    
     if (current_algo == RT_ALGO_LLF) {
         llf_update_laxity();
         
-        rt_task_t *old_queue = ready_queue;
-        ready_queue = NULL;
-        while (old_queue != NULL) {
-            rt_task_t *task = old_queue;
-            old_queue = old_queue->next;
-            task->next = NULL;
-            insert_ready(task);
-        }
+        ready_queue = sort_ready(ready_queue);
     }
     
     if (realtime_check_preempt()) {
@@ -727,6 +1010,28 @@ void realtime_tick(void)
     }
 }
 
+/* Ticks until the running job completes; releases and deadlines live on the timer wheel */
+uint64_t realtime_next_event(void)
+{
+    if (current_algo == RT_ALGO_LLF) {
+        return 1;
+    }
+    
+    if (current_task != NULL && current_task->state == RT_STATE_RUNNING) {
+        return (current_task->remaining_time + SCHED_TICK_NS - 1) / SCHED_TICK_NS;
+    }
+    
+    return SCHED_NO_EVENT;
+}
+
+/* The framework clock already covers the skipped ticks; charge them to the running task */
+void realtime_catchup(uint64_t ticks)
+{
+    (void)ticks;
+    
+    charge_running();
+}
+
 void realtime_check_releases(void)
 {
     rt_task_t *task = all_tasks;
@@ -738,7 +1043,7 @@ void realtime_check_releases(void)
             
             uint64_t next_release = task->release_time + task->params.period;
             
-            if (system_time >= next_release) {
+            if (rt_now() >= next_release) {
                 realtime_release(task);
             }
         }
@@ -872,7 +1177,7 @@ void realtime_print_stats(void)
     
     kprintf("\n=== Real-Time Scheduler Statistics ===\n");
     kprintf("Algorithm: %s\n", algo_names[current_algo]);
-    kprintf("System time: %llu ticks\n", system_time);
+    kprintf("System time: %llu ticks\n", rt_now());
     kprintf("Total tasks: %u\n", task_count);
     kprintf("Utilization: %.2f%%\n", stats.utilization * 100);
     
@@ -915,7 +1220,7 @@ void realtime_print_task(rt_task_t *task)
     kprintf("  PID %d [%s]:\n", task->pid, state_names[task->state]);
     kprintf("    Period=%u, Deadline=%u, WCET=%u\n",
             task->params.period, task->params.deadline, task->params.wcet);
-    kprintf("    Priority=%u, Remaining=%llu\n",
+    kprintf("    Priority=%u, Remaining=%llu ns\n",
             task->rms_priority, task->remaining_time);
     kprintf("    Abs deadline=%llu, Release=%llu\n",
             task->absolute_deadline, task->release_time);
@@ -966,7 +1271,7 @@ bool realtime_validate(void)
         }
         
         prev = task;
-        task = task->next;
+        task = task->ready_next;
     }
     
     return valid;
@@ -979,10 +1284,18 @@ rt_task_t *realtime_get_task(pid32 pid)
 
 void realtime_set_time(uint64_t time)
 {
-    system_time = time;
+    time_offset = time - sched_get_time();
+    
+    for (rt_task_t *task = all_tasks; task != NULL; task = task->next) {
+        if (task->state == RT_STATE_READY || task->state == RT_STATE_RUNNING) {
+            arm_job(task);
+        } else if (release_pending(task)) {
+            arm_release(task);
+        }
+    }
 }
 
 uint64_t realtime_get_time(void)
 {
-    return system_time;
+    return rt_now();
 }
@@ -4,6 +4,7 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include "scheduler.h"
+#include "sched_timer.h"
 
 #define RT_MAX_TASKS            64
 
@@ -69,7 +70,11 @@ typedef struct rt_task {
     
     int64_t     laxity;
     
+    sched_timer_t   release_timer;
+    sched_timer_t   deadline_timer;
+    
     struct rt_task  *next;
+    struct rt_task  *ready_next;
 } rt_task_t;
 
 typedef struct rt_stats {
@@ -95,12 +100,16 @@ rt_algorithm_t realtime_get_algorithm(void);
 
 void realtime_schedule(void);
 
+pid32 realtime_pick_next(void);
+
 void realtime_yield(void);
 
 void realtime_preempt(void);
 
 bool realtime_check_preempt(void);
 
+bool realtime_check_preempt_wakeup(pid32 pid);
+
 rt_task_t *edf_pick_next(void);
 
 void edf_enqueue(rt_task_t *task);
@@ -127,6 +136,10 @@ void realtime_enqueue(pid32 pid);
 
 void realtime_dequeue(pid32 pid);
 
+uint32_t realtime_export(sched_hint_t *hints, uint32_t max);
+
+void realtime_enqueue_batch(const sched_hint_t *hints, uint32_t count);
+
 int realtime_create_task(pid32 pid, rt_task_params_t *params);
 
 int realtime_set_params(pid32 pid, rt_task_params_t *params);
@@ -143,6 +156,10 @@ void realtime_handle_miss(rt_task_t *task);
 
 void realtime_tick(void);
 
+uint64_t realtime_next_event(void);
+
+void realtime_catchup(uint64_t ticks);
+
 void realtime_check_releases(void);
 
 void realtime_check_deadlines(void);
@@ -4,6 +4,7 @@
 #include <stddef.h>
 #include "round_robin.h"
 #include "scheduler.h"
+#include "sched_trace.h"
 #include "../include/kernel.h"
 #include "../include/process.h"
 #include "../include/interrupts.h"
@@ -18,6 +19,7 @@ static uint32_t rr_queue_count = 0;
 
 static uint32_t rr_quantum = RR_DEFAULT_QUANTUM;
 static uint32_t rr_quantum_remaining = RR_DEFAULT_QUANTUM;
+static uint32_t rr_max_quantum = RR_MAX_QUANTUM;
 
 static rr_stats_t rr_stats;
 
@@ -25,7 +27,6 @@ static sid32 rr_lock;
 
 extern proc_t proctab[];
 extern pid32 currpid;
-extern void context_switch(pid32 oldpid, pid32 newpid);
 
 static scheduler_ops_t rr_ops = {
     .name = "Round-Robin",
@@ -37,6 +38,9 @@ static scheduler_ops_t rr_ops = {
     .enqueue = round_robin_enqueue,
     .dequeue = round_robin_dequeue,
     .pick_next = round_robin_pick_next,
+    .check_preempt_wakeup = round_robin_check_preempt_wakeup,
+    .export_runnable = round_robin_export,
+    .enqueue_batch = round_robin_enqueue_batch,
     .set_priority = NULL,
     .get_priority = NULL,
     .boost_priority = NULL,
@@ -44,6 +48,8 @@ static scheduler_ops_t rr_ops = {
     .set_quantum = round_robin_set_quantum,
     .get_quantum = round_robin_get_quantum,
     .tick = round_robin_tick,
+    .next_event = round_robin_next_event,
+    .catchup = round_robin_catchup,
     .get_stats = NULL,
     .reset_stats = round_robin_reset_stats,
     .print_stats = round_robin_print_stats
@@ -242,6 +248,87 @@ void round_robin_dequeue(pid32 pid) {
     restore(mask);
 }
 
+uint32_t round_robin_export(sched_hint_t *hints, uint32_t max) {
+    rr_node_t *node;
+    uint32_t count = 0;
+    intmask mask;
+    
+    mask = disable();
+    
+    if (rr_queue_head != NULL) {
+        node = rr_queue_head;
+        do {
+            hints[count].pid = node->pid;
+            hints[count].priority = proctab[node->pid].pprio;
+            count++;
+            node = node->next;
+        } while (node != rr_queue_head && count < max);
+    }
+    
+    restore(mask);
+    
+    return count;
+}
+
+void round_robin_enqueue_batch(const sched_hint_t *hints, uint32_t count) {
+    bool queued[NPROC];
+    rr_node_t *node;
+    pid32 pid;
+    uint32_t i;
+    intmask mask;
+    
+    mask = disable();
+    wait(rr_lock);
+    
+    memset(queued, 0, sizeof(queued));
+    if (rr_queue_head != NULL) {
+        node = rr_queue_head;
+        do {
+            queued[node->pid] = true;
+            node = node->next;
+        } while (node != rr_queue_head);
+    }
+    
+    for (i = 0; i < count; i++) {
+        pid = hints[i].pid;
+        if (pid < 0 || pid >= NPROC || queued[pid]) {
+            continue;
+        }
+        
+        node = rr_node_alloc();
+        if (node == NULL) {
+            break;
+        }
+        
+        node->pid = pid;
+        node->time_remaining = rr_quantum;
+        queued[pid] = true;
+        
+        if (rr_queue_head == NULL) {
+            node->next = node;
+            node->prev = node;
+            rr_queue_head = node;
+            rr_current = node;
+        } else {
+            node->next = rr_queue_head;
+            node->prev = rr_queue_head->prev;
+            rr_queue_head->prev->next = node;
+            rr_queue_head->prev = node;
+        }
+        
+        rr_queue_count++;
+        rr_stats.total_processes++;
+    }
+    
+    if (rr_queue_count > rr_stats.max_queue_length) {
+        rr_stats.max_queue_length = rr_queue_count;
+    }
+    rr_stats.current_queue_length = rr_queue_count;
+    
+    signal(rr_lock);
+    restore(mask);
+}
+
 pid32 round_robin_pick_next(void) {
     if (rr_current == NULL) {
         return -1;
@@ -250,6 +337,12 @@ pid32 round_robin_pick_next(void) {
     return rr_current->pid;
 }
 
+bool round_robin_check_preempt_wakeup(pid32 pid) {
+    (void)pid;
+    
+    return rr_current == NULL || rr_current->pid != currpid;
+}
+
 void round_robin_rotate(void) {
     intmask mask;
     
@@ -293,7 +386,7 @@ void round_robin_schedule(void) {
         
         rr_stats.total_context_switches++;
         
-        context_switch(old_pid, next_pid);
+        sched_switch(old_pid, next_pid);
     }
     
     restore(mask);
@@ -327,13 +420,21 @@ void round_robin_set_quantum(uint32_t quantum) {
     if (quantum < RR_MIN_QUANTUM) {
         quantum = RR_MIN_QUANTUM;
     }
-    if (quantum > RR_MAX_QUANTUM) {
-        quantum = RR_MAX_QUANTUM;
+    if (quantum > rr_max_quantum) {
+        quantum = rr_max_quantum;
     }
     
     rr_quantum = quantum;
 }
 
+void round_robin_set_max_quantum(uint32_t quantum) {
+    rr_max_quantum = quantum;
+    
+    if (rr_quantum > rr_max_quantum) {
+        rr_quantum = rr_max_quantum;
+    }
+}
+
 uint32_t round_robin_get_quantum(void) {
     return rr_quantum;
 }
@@ -352,11 +453,41 @@ void round_robin_tick(void) {
         
         if (rr_current->time_remaining == 0) {
             rr_stats.total_quantum_expires++;
+            sched_trace_emit(TRACE_QUANTUM, rr_current->pid, rr_quantum);
             
             round_robin_rotate();
             
-            extern volatile bool need_resched;
-            need_resched = true;
+            sched_set_resched();
+        }
+    }
+    
+    restore(mask);
+}
+
+uint64_t round_robin_next_event(void) {
+    if (rr_current == NULL || rr_current->pid != currpid) {
+        return SCHED_NO_EVENT;
+    }
+    
+    if (rr_queue_count <= 1) {
+        return SCHED_NO_EVENT;
+    }
+    
+    return rr_current->time_remaining;
+}
+
+void round_robin_catchup(uint64_t ticks) {
+    intmask mask;
+    
+    mask = disable();
+    
+    if (rr_current != NULL && rr_current->pid == currpid) {
+        rr_current->total_time += ticks;
+        
+        if (rr_current->time_remaining > ticks) {
+            rr_current->time_remaining -= ticks;
+        } else {
+            rr_current->time_remaining = 0;
         }
     }
     
@@ -47,14 +47,26 @@ void round_robin_dequeue(pid32 pid);
 
 pid32 round_robin_pick_next(void);
 
+bool round_robin_check_preempt_wakeup(pid32 pid);
+
+uint32_t round_robin_export(sched_hint_t *hints, uint32_t max);
+
+void round_robin_enqueue_batch(const sched_hint_t *hints, uint32_t count);
+
 void round_robin_rotate(void);
 
 void round_robin_set_quantum(uint32_t quantum);
 
 uint32_t round_robin_get_quantum(void);
 
+void round_robin_set_max_quantum(uint32_t quantum);
+
 void round_robin_tick(void);
 
+uint64_t round_robin_next_event(void);
+
+void round_robin_catchup(uint64_t ticks);
+
 void round_robin_reset_slice(pid32 pid);
 
 void round_robin_get_stats(rr_stats_t *stats);
@@ -0,0 +1,554 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "sched_bench.h"
+#include "sched_prof.h"
+#include "scheduler.h"
+#include "round_robin.h"
+#include "priority.h"
+#include "multilevel_queue.h"
+#include "lottery.h"
+#include "cfs.h"
+#include "realtime.h"
+#include "sched_timer.h"
+#include "../include/kernel.h"
+#include "../include/process.h"
+
+typedef struct bench_policy {
+    scheduler_type_t type;
+    void (*init)(void);
+    scheduler_ops_t *(*get_ops)(void);
+} bench_policy_t;
+
+static const bench_policy_t bench_policies[] = {
+    { SCHEDULER_ROUND_ROBIN, round_robin_init, round_robin_get_ops },
+    { SCHEDULER_PRIORITY,    priority_init,    priority_get_ops },
+    { SCHEDULER_MLFQ,        mlfq_init,        mlfq_get_ops },
+    { SCHEDULER_LOTTERY,     lottery_init,     lottery_get_ops },
+    { SCHEDULER_CFS,         cfs_init,         cfs_get_ops },
+    { SCHEDULER_EDF,         realtime_init,    realtime_get_ops }
+};
+
+static const char *bench_op_names[BENCH_NUM_OPS] = {
+    "enqueue", "dequeue", "pick_next", "tick", "schedule", "enqueue_loop", "enqueue_batch",
+    "sched_tick", "sched_ready", "sched_schedule", "sched_tick_cold",
+    "timer_arm", "timer_tick", "ready_enqueue", "ready_dequeue"
+};
+
+static uint32_t bench_mhz = SCHED_BENCH_DEFAULT_MHZ;
+
+static uint64_t bench_overhead = 0;
+
+static volatile uint8_t bench_evict_buf[SCHED_BENCH_EVICT_BYTES];
+
+static sched_timer_t bench_timers[SCHED_BENCH_MAX_TIMERS];
+
+static uint32_t bench_timer_fired = 0;
+
+extern proc_t proctab[];
+extern pid32 currpid;
+
+uint64_t sched_bench_cycles(void) {
+    return sched_prof_cycles();
+}
+
+void sched_bench_set_mhz(uint32_t mhz) {
+    bench_mhz = (mhz > 0) ? mhz : SCHED_BENCH_DEFAULT_MHZ;
+}
+
+static void bench_calibrate(void) {
+    uint64_t t0, t1, best;
+    int i;
+    
+    best = UINT64_MAX;
+    for (i = 0; i < 100; i++) {
+        t0 = sched_bench_cycles();
+        t1 = sched_bench_cycles();
+        if (t1 - t0 < best) {
+            best = t1 - t0;
+        }
+    }
+    
+    bench_overhead = best;
+}
+
+static void bench_evict(void) {
+    uint32_t i;
+    
+    for (i = 0; i < SCHED_BENCH_EVICT_BYTES; i += 64) {
+        bench_evict_buf[i]++;
+    }
+}
+
+static void bench_record(bench_result_t *result, uint64_t t0, uint64_t t1) {
+    uint64_t delta;
+    
+    delta = t1 - t0;
+    delta = (delta > bench_overhead) ? delta - bench_overhead : 0;
+    
+    result->cycles += delta;
+    if (delta < result->min_cycles) {
+        result->min_cycles = delta;
+    }
+    result->iters++;
+}
+
+static void bench_record_n(bench_result_t *result, uint64_t t0, uint64_t t1, uint32_t n) {
+    uint64_t delta;
+    
+    delta = t1 - t0;
+    delta = (delta > bench_overhead) ? delta - bench_overhead : 0;
+    
+    result->cycles += delta;
+    if (delta / n < result->min_cycles) {
+        result->min_cycles = delta / n;
+    }
+    result->iters += n;
+}
+
+static void bench_reset(bench_result_t *result, const char *policy,
+                        bench_op_t op, uint32_t depth) {
+    result->policy = policy;
+    result->op = op;
+    result->depth = depth;
+    result->iters = 0;
+    result->cycles = 0;
+    result->min_cycles = UINT64_MAX;
+}
+
+static void bench_populate(scheduler_ops_t *ops, uint32_t depth) {
+    pid32 pid;
+    uint32_t i;
+    
+    currpid = NULLPROC;
+    proctab[NULLPROC].pstate = PR_CURR;
+    
+    for (i = 0; i < depth; i++) {
+        pid = SCHED_BENCH_FIRST_PID + i;
+        proctab[pid].pstate = PR_READY;
+        proctab[pid].pprio = (i * 37) % (PRIORITY_MAX + 1);
+        ops->enqueue(pid);
+    }
+}
+
+static void bench_drain(scheduler_ops_t *ops, uint32_t depth) {
+    uint32_t i;
+    
+    for (i = 0; i < depth; i++) {
+        ops->dequeue(SCHED_BENCH_FIRST_PID + i);
+    }
+}
+
+static void bench_batch(scheduler_ops_t *ops, uint32_t depth) {
+    sched_hint_t hints[SCHED_BENCH_MAX_DEPTH];
+    bench_result_t loop, batch;
+    uint64_t t0, t1;
+    uint32_t round, i;
+    
+    for (i = 0; i < depth; i++) {
+        hints[i].pid = SCHED_BENCH_FIRST_PID + i;
+        hints[i].priority = SCHED_HINT_NONE;
+    }
+    
+    bench_reset(&loop, ops->name, BENCH_OP_ENQUEUE_LOOP, depth);
+    bench_reset(&batch, ops->name, BENCH_OP_ENQUEUE_BATCH, depth);
+    for (round = 0; round < SCHED_BENCH_BATCH_ROUNDS; round++) {
+        bench_drain(ops, depth);
+        t0 = sched_bench_cycles();
+        for (i = 0; i < depth; i++) {
+            ops->enqueue(hints[i].pid);
+        }
+        t1 = sched_bench_cycles();
+        bench_record_n(&loop, t0, t1, depth);
+    
+        bench_drain(ops, depth);
+        t0 = sched_bench_cycles();
+        ops->enqueue_batch(hints, depth);
+        t1 = sched_bench_cycles();
+        bench_record_n(&batch, t0, t1, depth);
+    }
+    sched_bench_print(&loop);
+    sched_bench_print(&batch);
+}
+
+static void bench_depth(const bench_policy_t *policy, uint32_t depth) {
+    scheduler_ops_t *ops;
+    bench_result_t enq, deq, result;
+    uint64_t t0, t1, t2;
+    pid32 pid;
+    uint32_t i;
+    intmask mask;
+    
+    mask = disable();
+    
+    policy->init();
+    ops = policy->get_ops();
+    
+    if (ops->enqueue == NULL || ops->dequeue == NULL) {
+        if (ops->shutdown != NULL) {
+            ops->shutdown();
+        }
+        restore(mask);
+        return;
+    }
+    
+    bench_populate(ops, depth);
+    
+    bench_reset(&enq, ops->name, BENCH_OP_ENQUEUE, depth);
+    bench_reset(&deq, ops->name, BENCH_OP_DEQUEUE, depth);
+    for (i = 0; i < SCHED_BENCH_ITERS; i++) {
+        pid = SCHED_BENCH_FIRST_PID + (pid32)((i * 7) % depth);
+    
+        t0 = sched_bench_cycles();
+        ops->dequeue(pid);
+        t1 = sched_bench_cycles();
+        ops->enqueue(pid);
+        t2 = sched_bench_cycles();
+    
+        bench_record(&deq, t0, t1);
+        bench_record(&enq, t1, t2);
+    }
+    sched_bench_print(&enq);
+    sched_bench_print(&deq);
+    
+    if (ops->enqueue_batch != NULL) {
+        bench_batch(ops, depth);
+    }
+    
+    if (ops->pick_next != NULL) {
+        bench_reset(&result, ops->name, BENCH_OP_PICK_NEXT, depth);
+        for (i = 0; i < SCHED_BENCH_ITERS; i++) {
+            t0 = sched_bench_cycles();
+            ops->pick_next();
+            t1 = sched_bench_cycles();
+            bench_record(&result, t0, t1);
+        }
+        sched_bench_print(&result);
+    }
+    
+    if (ops->tick != NULL) {
+        bench_reset(&result, ops->name, BENCH_OP_TICK, depth);
+        for (i = 0; i < SCHED_BENCH_ITERS; i++) {
+            t0 = sched_bench_cycles();
+            ops->tick();
+            t1 = sched_bench_cycles();
+            bench_record(&result, t0, t1);
+        }
+        sched_bench_print(&result);
+    }
+    
+    if (ops->schedule != NULL) {
+        bench_reset(&result, ops->name, BENCH_OP_SCHEDULE, depth);
+        for (i = 0; i < SCHED_BENCH_ITERS; i++) {
+            t0 = sched_bench_cycles();
+            ops->schedule();
+            t1 = sched_bench_cycles();
+            bench_record(&result, t0, t1);
+        }
+        sched_bench_print(&result);
+    }
+    
+    if (ops->shutdown != NULL) {
+        ops->shutdown();
+    }
+    
+    for (i = 0; i < depth; i++) {
+        proctab[SCHED_BENCH_FIRST_PID + i].pstate = PR_FREE;
+    }
+    
+    restore(mask);
+}
+
+syscall sched_bench_policy(scheduler_type_t type, uint32_t max_depth) {
+    const bench_policy_t *policy;
+    uint32_t i, depth;
+    
+    policy = NULL;
+    for (i = 0; i < sizeof(bench_policies) / sizeof(bench_policies[0]); i++) {
+        if (bench_policies[i].type == type) {
+            policy = &bench_policies[i];
+            break;
+        }
+    }
+    
+    if (policy == NULL) {
+        return SYSERR;
+    }
+    
+    if (max_depth == 0 || max_depth > SCHED_BENCH_MAX_DEPTH) {
+        max_depth = SCHED_BENCH_MAX_DEPTH;
+    }
+    
+    bench_calibrate();
+    
+    for (depth = SCHED_BENCH_MIN_DEPTH; depth < max_depth; depth *= 2) {
+        bench_depth(policy, depth);
+    }
+    bench_depth(policy, max_depth);
+    
+    return OK;
+}
+
+void sched_bench_all(uint32_t max_depth) {
+    uint32_t i;
+    
+    kprintf("policy,op,depth,iters,cycles_per_op,min_cycles,ns_per_op\n");
+    
+    for (i = 0; i < sizeof(bench_policies) / sizeof(bench_policies[0]); i++) {
+        sched_bench_policy(bench_policies[i].type, max_depth);
+    }
+}
+
+syscall sched_bench_dispatch(uint32_t depth) {
+    const bench_policy_t *policy;
+    scheduler_ops_t *ops;
+    sched_cpu_t *cpu;
+    bench_result_t result;
+    const char *name;
+    uint64_t t0, t1;
+    pid32 pid, curr;
+    uint32_t i;
+    intmask mask;
+    
+    policy = NULL;
+    for (i = 0; i < sizeof(bench_policies) / sizeof(bench_policies[0]); i++) {
+        if ((uint32_t)bench_policies[i].type == sched_policy) {
+            policy = &bench_policies[i];
+            break;
+        }
+    }
+    
+    if (policy == NULL) {
+        return SYSERR;
+    }
+    
+    if (depth == 0 || depth > SCHED_BENCH_MAX_DEPTH) {
+        depth = SCHED_BENCH_DISPATCH_DEPTH;
+    }
+    
+#ifdef SCHED_STATIC_POLICY
+    name = "static";
+#else
+    name = "dynamic";
+#endif
+    
+    bench_calibrate();
+    
+    mask = disable();
+    
+    ops = policy->get_ops();
+    
+    currpid = NULLPROC;
+    proctab[NULLPROC].pstate = PR_CURR;
+    for (i = 0; i < depth; i++) {
+        pid = SCHED_BENCH_FIRST_PID + i;
+        proctab[pid].pstate = PR_READY;
+        proctab[pid].pprio = (i * 37) % (PRIORITY_MAX + 1);
+        sched_ready(pid);
+    }
+    
+    bench_reset(&result, name, BENCH_OP_SCHED_TICK, depth);
+    for (i = 0; i < SCHED_BENCH_ITERS; i++) {
+        t0 = sched_bench_cycles();
+        sched_tick();
+        t1 = sched_bench_cycles();
+        bench_record(&result, t0, t1);
+    }
+    sched_bench_print(&result);
+    
+    cpu = sched_this_cpu();
+    curr = cpu->curr;
+    bench_reset(&result, name, BENCH_OP_SCHED_TICK_COLD, depth);
+    for (i = 0; i < SCHED_BENCH_ITERS; i++) {
+        cpu->curr = SCHED_BENCH_FIRST_PID + (pid32)((i * 7) % depth);
+        bench_evict();
+    
+        t0 = sched_bench_cycles();
+        sched_tick();
+        t1 = sched_bench_cycles();
+        bench_record(&result, t0, t1);
+    }
+    cpu->curr = curr;
+    sched_bench_print(&result);
+    
+    bench_reset(&result, name, BENCH_OP_SCHED_READY, depth);
+    for (i = 0; i < SCHED_BENCH_ITERS; i++) {
+        pid = SCHED_BENCH_FIRST_PID + (pid32)((i * 7) % depth);
+        if (pid == currpid) {
+            continue;
+        }
+    
+        ops->dequeue(pid);
+        t0 = sched_bench_cycles();
+        sched_ready(pid);
+        t1 = sched_bench_cycles();
+        bench_record(&result, t0, t1);
+    }
+    sched_bench_print(&result);
+    
+    bench_reset(&result, name, BENCH_OP_SCHED_SCHEDULE, depth);
+    for (i = 0; i < SCHED_BENCH_ITERS; i++) {
+        sched_set_resched();
+        t0 = sched_bench_cycles();
+        schedule();
+        t1 = sched_bench_cycles();
+        bench_record(&result, t0, t1);
+    }
+    sched_bench_print(&result);
+    
+    for (i = 0; i < depth; i++) {
+        pid = SCHED_BENCH_FIRST_PID + i;
+        ops->dequeue(pid);
+        proctab[pid].pstate = PR_FREE;
+    }
+    currpid = NULLPROC;
+    proctab[NULLPROC].pstate = PR_CURR;
+    
+    restore(mask);
+    
+    return OK;
+}
+
+static void bench_timer_expire(void *arg) {
+    (void)arg;
+    
+    bench_timer_fired++;
+}
+
+static uint64_t bench_timer_offset(uint32_t i) {
+    return SCHED_BENCH_ITERS + 1 + (uint64_t)((i * 2654435761u) % SCHED_BENCH_TIMER_SPAN);
+}
+
+static void bench_timers_depth(uint32_t count) {
+    bench_result_t result;
+    uint64_t t0, t1, now;
+    uint32_t i;
+    intmask mask;
+    
+    mask = disable();
+    
+    now = sched_get_time();
+    for (i = 0; i < count; i++) {
+        sched_timer_setup(&bench_timers[i], bench_timer_expire, NULL);
+        sched_timer_arm(&bench_timers[i], now + bench_timer_offset(i));
+    }
+    
+    bench_reset(&result, "wheel", BENCH_OP_TIMER_ARM, count);
+    for (i = 0; i < SCHED_BENCH_ITERS; i++) {
+        t0 = sched_bench_cycles();
+        sched_timer_arm(&bench_timers[i % count], now + bench_timer_offset(i * 7));
+        t1 = sched_bench_cycles();
+        bench_record(&result, t0, t1);
+    }
+    sched_bench_print(&result);
+    
+    bench_reset(&result, "wheel", BENCH_OP_TIMER_TICK, count);
+    for (i = 0; i < SCHED_BENCH_ITERS; i++) {
+        t0 = sched_bench_cycles();
+        sched_tick();
+        t1 = sched_bench_cycles();
+        bench_record(&result, t0, t1);
+    }
+    sched_bench_print(&result);
+    
+    for (i = 0; i < count; i++) {
+        sched_timer_cancel(&bench_timers[i]);
+    }
+    
+    restore(mask);
+}
+
+syscall sched_bench_timers(uint32_t max_timers) {
+    uint32_t count;
+    
+    if (max_timers == 0 || max_timers > SCHED_BENCH_MAX_TIMERS) {
+        max_timers = SCHED_BENCH_MAX_TIMERS;
+    }
+    
+    bench_calibrate();
+    bench_timer_fired = 0;
+    
+    for (count = SCHED_BENCH_MIN_TIMERS; count < max_timers; count *= 4) {
+        bench_timers_depth(count);
+    }
+    bench_timers_depth(max_timers);
+    
+    return (bench_timer_fired == 0) ? OK : SYSERR;
+}
+
+static void bench_ready_depth(uint32_t depth) {
+    bench_result_t enq, deq;
+    uint64_t t0, t1, t2;
+    pid32 pid;
+    uint32_t i;
+    intmask mask;
+    
+    mask = disable();
+    
+    for (i = 0; i < depth; i++) {
+        pid = SCHED_BENCH_FIRST_PID + i;
+        proctab[pid].pstate = PR_READY;
+        proctab[pid].pprio = (i * 37) % (PRIORITY_MAX + 1);
+        ready_enqueue_cpu(0, pid);
+    }
+    
+    bench_reset(&enq, "ready_queue", BENCH_OP_READY_ENQUEUE, depth);
+    bench_reset(&deq, "ready_queue", BENCH_OP_READY_DEQUEUE, depth);
+    for (i = 0; i < SCHED_BENCH_ITERS; i++) {
+        pid = SCHED_BENCH_FIRST_PID + (pid32)((i * 7) % depth);
+    
+        t0 = sched_bench_cycles();
+        ready_dequeue(pid);
+        t1 = sched_bench_cycles();
+        ready_enqueue_cpu(0, pid);
+        t2 = sched_bench_cycles();
+    
+        bench_record(&deq, t0, t1);
+        bench_record(&enq, t1, t2);
+    }
+    sched_bench_print(&enq);
+    sched_bench_print(&deq);
+    
+    for (i = 0; i < depth; i++) {
+        pid = SCHED_BENCH_FIRST_PID + i;
+        ready_dequeue(pid);
+        proctab[pid].pstate = PR_FREE;
+    }
+    
+    restore(mask);
+}
+
+syscall sched_bench_ready(uint32_t max_depth) {
+    uint32_t depth;
+    
+    if (max_depth == 0 || max_depth > SCHED_BENCH_MAX_DEPTH) {
+        max_depth = SCHED_BENCH_MAX_DEPTH;
+    }
+    if (max_depth < SCHED_BENCH_READY_MIN_DEPTH) {
+        return SYSERR;
+    }
+    
+    bench_calibrate();
+    
+    for (depth = SCHED_BENCH_READY_MIN_DEPTH; depth < max_depth; depth *= 2) {
+        bench_ready_depth(depth);
+    }
+    bench_ready_depth(max_depth);
+    
+    return OK;
+}
+
+void sched_bench_print(const bench_result_t *result) {
+    uint64_t per_op;
+    
+    if (result == NULL || result->iters == 0) {
+        return;
+    }
+    
+    per_op = result->cycles / result->iters;
+    
+    kprintf("%s,%s,%u,%u,%llu,%llu,%llu\n",
+            result->policy, bench_op_names[result->op], result->depth,
+            result->iters, per_op, result->min_cycles,
+            per_op * 1000 / bench_mhz);
+}
@@ -0,0 +1,65 @@
+#ifndef _SCHED_BENCH_H_
+#define _SCHED_BENCH_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "scheduler.h"
+
+#define SCHED_BENCH_ITERS       1000
+#define SCHED_BENCH_MIN_DEPTH   4
+#define SCHED_BENCH_MAX_DEPTH   (NPROC - 1)
+#define SCHED_BENCH_FIRST_PID   1
+#define SCHED_BENCH_DEFAULT_MHZ 1000
+#define SCHED_BENCH_BATCH_ROUNDS 32
+#define SCHED_BENCH_DISPATCH_DEPTH 16
+#define SCHED_BENCH_EVICT_BYTES (64 * 1024)
+#define SCHED_BENCH_MIN_TIMERS  16
+#define SCHED_BENCH_MAX_TIMERS  4096
+#define SCHED_BENCH_TIMER_SPAN  (1 << 20)
+#define SCHED_BENCH_READY_MIN_DEPTH 8
+
+typedef enum {
+    BENCH_OP_ENQUEUE,
+    BENCH_OP_DEQUEUE,
+    BENCH_OP_PICK_NEXT,
+    BENCH_OP_TICK,
+    BENCH_OP_SCHEDULE,
+    BENCH_OP_ENQUEUE_LOOP,
+    BENCH_OP_ENQUEUE_BATCH,
+    BENCH_OP_SCHED_TICK,
+    BENCH_OP_SCHED_READY,
+    BENCH_OP_SCHED_SCHEDULE,
+    BENCH_OP_SCHED_TICK_COLD,
+    BENCH_OP_TIMER_ARM,
+    BENCH_OP_TIMER_TICK,
+    BENCH_OP_READY_ENQUEUE,
+    BENCH_OP_READY_DEQUEUE,
+    BENCH_NUM_OPS
+} bench_op_t;
+
+typedef struct bench_result {
+    const char *policy;
+    bench_op_t op;
+    uint32_t depth;
+    uint32_t iters;
+    uint64_t cycles;
+    uint64_t min_cycles;
+} bench_result_t;
+
+uint64_t sched_bench_cycles(void);
+
+void sched_bench_set_mhz(uint32_t mhz);
+
+syscall sched_bench_policy(scheduler_type_t type, uint32_t max_depth);
+
+void sched_bench_all(uint32_t max_depth);
+
+syscall sched_bench_dispatch(uint32_t depth);
+
+syscall sched_bench_timers(uint32_t max_timers);
+
+syscall sched_bench_ready(uint32_t max_depth);
+
+void sched_bench_print(const bench_result_t *result);
+
+#endif
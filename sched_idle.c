@@ -0,0 +1,284 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "sched_idle.h"
+#include "scheduler.h"
+#include "../include/kernel.h"
+
+static const sched_idle_state_t idle_default_states[] = {
+    { "poll", 0,  0,  100 },
+    { "C1",   1,  2,  40  },
+    { "C2",   3,  10, 15  },
+    { "C3",   10, 50, 3   },
+};
+
+static sched_idle_state_t idle_states[SCHED_IDLE_MAX_STATES];
+
+static uint32_t idle_nstates = 0;
+
+static sched_idle_usage_t idle_usage[SCHED_IDLE_MAX_STATES];
+
+static sched_idle_cpu_t idle_cpus[SCHED_NCPUS];
+
+static sched_idle_gov_t idle_gov = SCHED_IDLE_GOV_MENU;
+
+static uint32_t idle_latency_limit = SCHED_IDLE_NO_LIMIT;
+
+static uint64_t idle_typical(const sched_idle_cpu_t *cpu) {
+    uint64_t sum, avg, var, diff, max, limit;
+    uint32_t i, n, round;
+    
+    limit = UINT64_MAX;
+    
+    for (round = 0; round < 3; round++) {
+        sum = 0;
+        max = 0;
+        n = 0;
+        for (i = 0; i < cpu->history_count; i++) {
+            if (cpu->history[i] <= limit) {
+                sum += cpu->history[i];
+                if (cpu->history[i] > max) {
+                    max = cpu->history[i];
+                }
+                n++;
+            }
+        }
+        
+        if (n < SCHED_IDLE_HISTORY / 2) {
+            break;
+        }
+        
+        avg = sum / n;
+        var = 0;
+        for (i = 0; i < cpu->history_count; i++) {
+            if (cpu->history[i] <= limit) {
+                diff = (cpu->history[i] > avg) ? cpu->history[i] - avg : avg - cpu->history[i];
+                var += diff * diff;
+            }
+        }
+        var /= n;
+        
+        if (avg * avg > 36 * var) {
+            return avg;
+        }
+        
+        limit = max - 1;
+    }
+    
+    return UINT64_MAX;
+}
+
+void sched_idle_init(void) {
+    uint32_t i;
+    
+    if (idle_nstates == 0) {
+        sched_idle_set_states(idle_default_states,
+                              sizeof(idle_default_states) / sizeof(idle_default_states[0]));
+    }
+    
+    for (i = 0; i < SCHED_IDLE_MAX_STATES; i++) {
+        idle_usage[i].entries = 0;
+        idle_usage[i].residency = 0;
+        idle_usage[i].too_deep = 0;
+        idle_usage[i].too_shallow = 0;
+    }
+    
+    for (i = 0; i < SCHED_NCPUS; i++) {
+        idle_cpus[i].idle = false;
+        idle_cpus[i].state = 0;
+        idle_cpus[i].entered = 0;
+        idle_cpus[i].predicted = 0;
+        idle_cpus[i].timer = SCHED_NO_EVENT;
+        idle_cpus[i].history_pos = 0;
+        idle_cpus[i].history_count = 0;
+    }
+}
+
+syscall sched_idle_set_states(const sched_idle_state_t *states, uint32_t count) {
+    uint32_t i;
+    
+    if (states == NULL || count == 0 || count > SCHED_IDLE_MAX_STATES) {
+        return SYSERR;
+    }
+    
+    for (i = 1; i < count; i++) {
+        if (states[i].exit_latency < states[i - 1].exit_latency ||
+            states[i].target_residency < states[i - 1].target_residency) {
+            return SYSERR;
+        }
+    }
+    
+    for (i = 0; i < count; i++) {
+        idle_states[i] = states[i];
+    }
+    idle_nstates = count;
+    
+    return OK;
+}
+
+uint32_t sched_idle_get_states(const sched_idle_state_t **states) {
+    if (states != NULL) {
+        *states = idle_states;
+    }
+    
+    return idle_nstates;
+}
+
+void sched_idle_set_governor(sched_idle_gov_t gov) {
+    idle_gov = gov;
+}
+
+void sched_idle_set_latency_limit(uint32_t limit) {
+    idle_latency_limit = limit;
+}
+
+void sched_idle_set_timer(uint32_t cpuid, uint64_t deadline) {
+    if (cpuid < SCHED_NCPUS) {
+        idle_cpus[cpuid].timer = deadline;
+    }
+}
+
+uint64_t sched_idle_predict(uint32_t cpuid, uint64_t now, uint64_t next_event) {
+    sched_idle_cpu_t *cpu;
+    uint64_t predicted;
+    
+    if (cpuid >= SCHED_NCPUS) {
+        return 0;
+    }
+    
+    cpu = &idle_cpus[cpuid];
+    
+    predicted = idle_typical(cpu);
+    
+    if (next_event < predicted) {
+        predicted = next_event;
+    }
+    
+    if (cpu->timer != SCHED_NO_EVENT && cpu->timer > now && cpu->timer - now < predicted) {
+        predicted = cpu->timer - now;
+    }
+    
+    return predicted;
+}
+
+uint32_t sched_idle_enter(uint32_t cpuid, uint64_t now, uint64_t next_event) {
+    sched_idle_cpu_t *cpu;
+    uint32_t state, i;
+    
+    if (cpuid >= SCHED_NCPUS || idle_nstates == 0) {
+        return 0;
+    }
+    
+    cpu = &idle_cpus[cpuid];
+    if (cpu->idle) {
+        return cpu->state;
+    }
+    
+    cpu->predicted = sched_idle_predict(cpuid, now, next_event);
+    
+    state = 0;
+    for (i = 1; i < idle_nstates; i++) {
+        if (idle_states[i].exit_latency > idle_latency_limit) {
+            break;
+        }
+        if (idle_gov == SCHED_IDLE_GOV_SHALLOW) {
+            break;
+        }
+        if (idle_gov == SCHED_IDLE_GOV_MENU &&
+            idle_states[i].target_residency > cpu->predicted) {
+            break;
+        }
+        state = i;
+    }
+    
+    cpu->idle = true;
+    cpu->state = state;
+    cpu->entered = now;
+    idle_usage[state].entries++;
+    
+    return state;
+}
+
+uint64_t sched_idle_exit(uint32_t cpuid, uint64_t now) {
+    sched_idle_cpu_t *cpu;
+    uint64_t duration;
+    uint32_t state;
+    
+    if (cpuid >= SCHED_NCPUS || !idle_cpus[cpuid].idle) {
+        return 0;
+    }
+    
+    cpu = &idle_cpus[cpuid];
+    state = cpu->state;
+    duration = now - cpu->entered;
+    
+    idle_usage[state].residency += duration;
+    
+    if (duration < idle_states[state].target_residency) {
+        idle_usage[state].too_deep++;
+    } else if (state + 1 < idle_nstates &&
+               duration >= idle_states[state + 1].target_residency &&
+               idle_states[state + 1].exit_latency <= idle_latency_limit) {
+        idle_usage[state].too_shallow++;
+    }
+    
+    cpu->history[cpu->history_pos] = duration;
+    cpu->history_pos = (cpu->history_pos + 1) % SCHED_IDLE_HISTORY;
+    if (cpu->history_count < SCHED_IDLE_HISTORY) {
+        cpu->history_count++;
+    }
+    
+    cpu->idle = false;
+    
+    return duration;
+}
+
+const sched_idle_cpu_t *sched_idle_cpu(uint32_t cpuid) {
+    if (cpuid >= SCHED_NCPUS) {
+        return NULL;
+    }
+    
+    return &idle_cpus[cpuid];
+}
+
+uint64_t sched_idle_energy(void) {
+    uint64_t energy = 0;
+    uint32_t i;
+    
+    for (i = 0; i < idle_nstates; i++) {
+        energy += idle_usage[i].residency * idle_states[i].power;
+        energy += idle_usage[i].entries * idle_states[i].exit_latency * SCHED_IDLE_ACTIVE_POWER;
+    }
+    
+    return energy;
+}
+
+uint64_t sched_idle_exit_latency(void) {
+    uint64_t latency = 0;
+    uint32_t i;
+    
+    for (i = 0; i < idle_nstates; i++) {
+        latency += idle_usage[i].entries * idle_states[i].exit_latency;
+    }
+    
+    return latency;
+}
+
+void sched_idle_print(void) {
+    uint32_t i;
+    
+    kprintf("\n=== Idle States ===\n");
+    kprintf("State  ExitLat  Residency  Power  Entries    Time       TooDeep  TooShallow\n");
+    kprintf("-----  -------  ---------  -----  ---------  ---------  -------  ----------\n");
+    
+    for (i = 0; i < idle_nstates; i++) {
+        kprintf("%5s  %7u  %9u  %5u  %9llu  %9llu  %7llu  %10llu\n",
+                idle_states[i].name, idle_states[i].exit_latency,
+                idle_states[i].target_residency, idle_states[i].power,
+                idle_usage[i].entries, idle_usage[i].residency,
+                idle_usage[i].too_deep, idle_usage[i].too_shallow);
+    }
+    
+    kprintf("Energy: %llu  Exit latency: %llu ticks\n",
+            sched_idle_energy(), sched_idle_exit_latency());
+}
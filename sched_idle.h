@@ -0,0 +1,70 @@
+#ifndef _SCHED_IDLE_H_
+#define _SCHED_IDLE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "scheduler.h"
+
+#define SCHED_IDLE_MAX_STATES   8
+#define SCHED_IDLE_HISTORY      8
+#define SCHED_IDLE_ACTIVE_POWER 100
+#define SCHED_IDLE_NO_LIMIT     UINT32_MAX
+
+typedef enum {
+    SCHED_IDLE_GOV_MENU,
+    SCHED_IDLE_GOV_SHALLOW,
+    SCHED_IDLE_GOV_DEEP
+} sched_idle_gov_t;
+
+typedef struct sched_idle_state {
+    const char *name;
+    uint32_t    exit_latency;
+    uint32_t    target_residency;
+    uint32_t    power;
+} sched_idle_state_t;
+
+typedef struct sched_idle_usage {
+    uint64_t    entries;
+    uint64_t    residency;
+    uint64_t    too_deep;
+    uint64_t    too_shallow;
+} sched_idle_usage_t;
+
+typedef struct sched_idle_cpu {
+    bool        idle;
+    uint32_t    state;
+    uint64_t    entered;
+    uint64_t    predicted;
+    uint64_t    timer;
+    uint64_t    history[SCHED_IDLE_HISTORY];
+    uint32_t    history_pos;
+    uint32_t    history_count;
+} sched_idle_cpu_t;
+
+void sched_idle_init(void);
+
+syscall sched_idle_set_states(const sched_idle_state_t *states, uint32_t count);
+
+uint32_t sched_idle_get_states(const sched_idle_state_t **states);
+
+void sched_idle_set_governor(sched_idle_gov_t gov);
+
+void sched_idle_set_latency_limit(uint32_t limit);
+
+void sched_idle_set_timer(uint32_t cpuid, uint64_t deadline);
+
+uint64_t sched_idle_predict(uint32_t cpuid, uint64_t now, uint64_t next_event);
+
+uint32_t sched_idle_enter(uint32_t cpuid, uint64_t now, uint64_t next_event);
+
+uint64_t sched_idle_exit(uint32_t cpuid, uint64_t now);
+
+const sched_idle_cpu_t *sched_idle_cpu(uint32_t cpuid);
+
+uint64_t sched_idle_energy(void);
+
+uint64_t sched_idle_exit_latency(void);
+
+void sched_idle_print(void);
+
+#endif
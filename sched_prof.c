@@ -0,0 +1,139 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "sched_prof.h"
+#include "scheduler.h"
+#include "../include/kernel.h"
+
+#ifdef SCHED_PROFILE
+
+static sched_prof_stat_t prof_stats[SCHED_NCPUS][SCHED_PROF_NUM_OPS];
+
+static const char *prof_names[SCHED_PROF_NUM_OPS] = {
+    "schedule", "tick", "enqueue", "dequeue", "pick_next", "set_priority"
+};
+
+static uint32_t prof_bucket(uint64_t cycles) {
+    uint32_t bits;
+    
+    bits = (cycles == 0) ? 0 : 64 - (uint32_t)__builtin_clzll(cycles);
+    
+    return (bits < SCHED_PROF_BUCKETS) ? bits : SCHED_PROF_BUCKETS - 1;
+}
+
+static void prof_merge(sched_prof_op_t op, sched_prof_stat_t *out) {
+    sched_prof_stat_t *stat;
+    uint32_t cpu, i;
+    
+    memset(out, 0, sizeof(sched_prof_stat_t));
+    
+    for (cpu = 0; cpu < SCHED_NCPUS; cpu++) {
+        stat = &prof_stats[cpu][op];
+        out->calls += stat->calls;
+        out->cycles += stat->cycles;
+        if (stat->max_cycles > out->max_cycles) {
+            out->max_cycles = stat->max_cycles;
+        }
+        for (i = 0; i < SCHED_PROF_BUCKETS; i++) {
+            out->buckets[i] += stat->buckets[i];
+        }
+    }
+}
+
+void sched_prof_record(sched_prof_op_t op, uint64_t cycles) {
+    sched_prof_stat_t *stat;
+    
+    stat = &prof_stats[sched_this_cpu()->id][op];
+    
+    stat->calls++;
+    stat->cycles += cycles;
+    if (cycles > stat->max_cycles) {
+        stat->max_cycles = cycles;
+    }
+    stat->buckets[prof_bucket(cycles)]++;
+}
+
+void sched_prof_reset(void) {
+    intmask mask;
+    
+    mask = disable();
+    memset(prof_stats, 0, sizeof(prof_stats));
+    restore(mask);
+}
+
+void sched_prof_get(sched_prof_op_t op, sched_prof_stat_t *stat) {
+    intmask mask;
+    
+    if (stat == NULL || op >= SCHED_PROF_NUM_OPS) {
+        return;
+    }
+    
+    mask = disable();
+    prof_merge(op, stat);
+    restore(mask);
+}
+
+uint32_t sched_prof_export(void *buf, uint32_t size) {
+    sched_prof_export_t *out;
+    uint32_t op;
+    intmask mask;
+    
+    if (buf == NULL || size < sizeof(sched_prof_export_t)) {
+        return 0;
+    }
+    
+    out = (sched_prof_export_t *)buf;
+    out->magic = SCHED_PROF_MAGIC;
+    out->version = SCHED_PROF_VERSION;
+    out->nops = SCHED_PROF_NUM_OPS;
+    out->nbuckets = SCHED_PROF_BUCKETS;
+    out->ncpus = SCHED_NCPUS;
+    
+    mask = disable();
+    for (op = 0; op < SCHED_PROF_NUM_OPS; op++) {
+        prof_merge((sched_prof_op_t)op, &out->ops[op]);
+    }
+    restore(mask);
+    
+    return sizeof(sched_prof_export_t);
+}
+
+const char *sched_prof_name(sched_prof_op_t op) {
+    if (op >= SCHED_PROF_NUM_OPS) {
+        return "unknown";
+    }
+    
+    return prof_names[op];
+}
+
+void sched_prof_print(void) {
+    sched_prof_stat_t stat;
+    uint32_t op, i, last;
+    
+    kprintf("\n=== Policy Op Cycles ===\n");
+    kprintf("%-13s %10s %8s %10s  %s\n", "Op", "Calls", "Avg", "Max",
+            "Histogram (count per power of two)");
+    
+    for (op = 0; op < SCHED_PROF_NUM_OPS; op++) {
+        sched_prof_get((sched_prof_op_t)op, &stat);
+        if (stat.calls == 0) {
+            continue;
+        }
+    
+        kprintf("%-13s %10llu %8llu %10llu ", prof_names[op], stat.calls,
+                stat.cycles / stat.calls, stat.max_cycles);
+    
+        last = 0;
+        for (i = 0; i < SCHED_PROF_BUCKETS; i++) {
+            if (stat.buckets[i] != 0) {
+                last = i;
+            }
+        }
+        for (i = 0; i <= last; i++) {
+            kprintf(" %u", stat.buckets[i]);
+        }
+        kprintf("\n");
+    }
+}
+
+#endif
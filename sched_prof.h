@@ -0,0 +1,85 @@
+#ifndef _SCHED_PROF_H_
+#define _SCHED_PROF_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "scheduler.h"
+
+#define SCHED_PROF_BUCKETS      16
+#define SCHED_PROF_MAGIC        0x46525053u
+#define SCHED_PROF_VERSION      1
+
+typedef enum {
+    SCHED_PROF_SCHEDULE,
+    SCHED_PROF_TICK,
+    SCHED_PROF_ENQUEUE,
+    SCHED_PROF_DEQUEUE,
+    SCHED_PROF_PICK_NEXT,
+    SCHED_PROF_SET_PRIORITY,
+    SCHED_PROF_NUM_OPS
+} sched_prof_op_t;
+
+typedef struct sched_prof_stat {
+    uint64_t    calls;
+    uint64_t    cycles;
+    uint64_t    max_cycles;
+    uint32_t    buckets[SCHED_PROF_BUCKETS];
+} sched_prof_stat_t;
+
+typedef struct sched_prof_export {
+    uint32_t    magic;
+    uint16_t    version;
+    uint16_t    nops;
+    uint32_t    nbuckets;
+    uint32_t    ncpus;
+    sched_prof_stat_t ops[SCHED_PROF_NUM_OPS];
+} sched_prof_export_t;
+
+static inline uint64_t sched_prof_cycles(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __builtin_ia32_rdtsc();
+#elif defined(__aarch64__)
+    uint64_t value;
+    
+    __asm__ volatile("mrs %0, cntvct_el0" : "=r"(value));
+    return value;
+#else
+    return sched_get_time();
+#endif
+}
+
+#ifdef SCHED_PROFILE
+
+#define SCHED_PROF_VOID(op, call) do {                                  \
+        uint64_t _prof_t0 = sched_prof_cycles();                        \
+        call;                                                           \
+        sched_prof_record(op, sched_prof_cycles() - _prof_t0);          \
+    } while (0)
+
+#define SCHED_PROF_CALL(op, call) ({                                    \
+        uint64_t _prof_t0 = sched_prof_cycles();                        \
+        __typeof__(call) _prof_ret = (call);                            \
+        sched_prof_record(op, sched_prof_cycles() - _prof_t0);          \
+        _prof_ret;                                                      \
+    })
+
+void sched_prof_record(sched_prof_op_t op, uint64_t cycles);
+
+void sched_prof_reset(void);
+
+void sched_prof_get(sched_prof_op_t op, sched_prof_stat_t *stat);
+
+uint32_t sched_prof_export(void *buf, uint32_t size);
+
+const char *sched_prof_name(sched_prof_op_t op);
+
+void sched_prof_print(void);
+
+#else
+
+#define SCHED_PROF_VOID(op, call)   call
+#define SCHED_PROF_CALL(op, call)   (call)
+
+#endif
+
+#endif
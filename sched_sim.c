@@ -0,0 +1,827 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "sched_sim.h"
+#include "scheduler.h"
+#include "sched_idle.h"
+#include "../include/kernel.h"
+#include "../include/process.h"
+
+typedef enum {
+    SIM_MODE_POLICY,
+    SIM_MODE_CLASSES,
+    SIM_MODE_CAPPED,
+    SIM_MODE_IDLE,
+    SIM_MODE_SMP
+} sim_mode_t;
+
+typedef struct sim_task {
+    sim_job_state_t state;
+    uint32_t phase;
+    uint32_t remaining;
+    uint64_t wake_at;
+    uint64_t first_run;
+    uint64_t finish;
+    uint64_t cpu_time;
+    uint64_t io_time;
+} sim_task_t;
+
+static sim_task_t sim_tasks[SIM_MAX_JOBS];
+
+static uint32_t sim_order[SIM_MAX_JOBS];
+
+static uint32_t sim_io_heap[SIM_MAX_JOBS];
+static uint32_t sim_io_count = 0;
+
+static uint64_t sim_samples[SIM_MAX_JOBS];
+
+static int32_t sim_groups[SIM_CAPPED_GROUPS];
+
+static uint64_t sim_stall = 0;
+static uint64_t sim_stall_ticks = 0;
+static uint64_t sim_wakeups = 0;
+
+#if SCHED_NCPUS > 1
+uint32_t sim_cpu = 0;
+
+typedef struct sim_thread {
+    uint32_t phase;
+    uint32_t remaining;
+    bool waiting;
+    bool done;
+} sim_thread_t;
+
+static sim_thread_t sim_threads[SIM_MAX_JOBS];
+
+static uint32_t sim_arrived[SCHED_MAX_GANGS];
+#endif
+
+static const scheduler_type_t sim_policies[] = {
+    SCHEDULER_ROUND_ROBIN,
+    SCHEDULER_PRIORITY,
+    SCHEDULER_MLFQ,
+    SCHEDULER_LOTTERY,
+    SCHEDULER_CFS,
+    SCHEDULER_EDF
+};
+
+static const char *sim_governors[] = { "menu", "shallow", "deep" };
+
+extern proc_t proctab[];
+extern pid32 currpid;
+
+static void io_heap_push(uint32_t idx) {
+    uint32_t pos, parent;
+    
+    pos = sim_io_count++;
+    while (pos > 0) {
+        parent = (pos - 1) / 2;
+        if (sim_tasks[sim_io_heap[parent]].wake_at <= sim_tasks[idx].wake_at) {
+            break;
+        }
+        sim_io_heap[pos] = sim_io_heap[parent];
+        pos = parent;
+    }
+    sim_io_heap[pos] = idx;
+}
+
+static uint32_t io_heap_pop(void) {
+    uint32_t top, last, pos, child;
+    
+    top = sim_io_heap[0];
+    last = sim_io_heap[--sim_io_count];
+    
+    pos = 0;
+    while ((child = 2 * pos + 1) < sim_io_count) {
+        if (child + 1 < sim_io_count &&
+            sim_tasks[sim_io_heap[child + 1]].wake_at <
+            sim_tasks[sim_io_heap[child]].wake_at) {
+            child++;
+        }
+        if (sim_tasks[last].wake_at <= sim_tasks[sim_io_heap[child]].wake_at) {
+            break;
+        }
+        sim_io_heap[pos] = sim_io_heap[child];
+        pos = child;
+    }
+    sim_io_heap[pos] = last;
+    
+    return top;
+}
+
+static void sim_admit(const sim_job_t *jobs, uint32_t idx, sim_mode_t mode) {
+    pid32 pid;
+    
+    pid = SIM_FIRST_PID + idx;
+    
+    sim_tasks[idx].state = SIM_JOB_READY;
+    sim_tasks[idx].phase = 0;
+    sim_tasks[idx].remaining = jobs[idx].cpu_burst[0];
+    
+    sched_new_process(pid);
+    proctab[pid].pprio = jobs[idx].priority;
+    proctab[pid].pstate = PR_READY;
+    if (mode == SIM_MODE_CLASSES) {
+        sched_set_class(pid, jobs[idx].realtime ? SCHED_CLASS_RT : SCHED_CLASS_FAIR);
+    } else if (mode == SIM_MODE_SMP) {
+        sched_set_class(pid, SCHED_CLASS_IDLE);
+    } else if (mode == SIM_MODE_CAPPED && jobs[idx].capped) {
+        sched_bw_attach(pid, sim_groups[idx % SIM_CAPPED_GROUPS]);
+    }
+    if (jobs[idx].affinity != 0) {
+        sched_set_affinity(pid, jobs[idx].affinity);
+    }
+    sched_ready(pid);
+}
+
+static void sim_wake(const sim_job_t *jobs, uint32_t idx) {
+    sim_tasks[idx].state = SIM_JOB_READY;
+    sim_tasks[idx].remaining = jobs[idx].cpu_burst[sim_tasks[idx].phase];
+    
+    sched_wakeup(SIM_FIRST_PID + idx);
+}
+
+static bool sim_burst_done(const sim_job_t *jobs, uint32_t idx, uint64_t now) {
+    sim_task_t *task;
+    pid32 pid;
+    uint32_t io;
+    
+    task = &sim_tasks[idx];
+    pid = SIM_FIRST_PID + idx;
+    io = jobs[idx].io_wait[task->phase];
+    
+    task->phase++;
+    
+    if (task->phase >= jobs[idx].nphases) {
+        task->state = SIM_JOB_DONE;
+        task->finish = now;
+        proctab[pid].pstate = PR_FREE;
+        sched_exit(pid);
+        return true;
+    }
+    
+    task->state = SIM_JOB_IO;
+    task->wake_at = now + io;
+    task->io_time += io;
+    io_heap_push(idx);
+    sched_idle_set_timer(0, sim_tasks[sim_io_heap[0]].wake_at);
+    
+    proctab[pid].pstate = PR_WAIT;
+    sched_block(pid);
+    
+    return false;
+}
+
+static void sim_percentiles(uint32_t count, sim_percentiles_t *out) {
+    uint64_t value;
+    uint32_t i, j;
+    
+    out->p50 = out->p90 = out->p99 = out->max = 0;
+    if (count == 0) {
+        return;
+    }
+    
+    for (i = 1; i < count; i++) {
+        value = sim_samples[i];
+        for (j = i; j > 0 && sim_samples[j - 1] > value; j--) {
+            sim_samples[j] = sim_samples[j - 1];
+        }
+        sim_samples[j] = value;
+    }
+    
+    out->p50 = sim_samples[(count - 1) * 50 / 100];
+    out->p90 = sim_samples[(count - 1) * 90 / 100];
+    out->p99 = sim_samples[(count - 1) * 99 / 100];
+    out->max = sim_samples[count - 1];
+}
+
+static void sim_collect(const sim_job_t *jobs, uint32_t njobs, sim_result_t *result) {
+    sim_task_t *task;
+    uint32_t i, count;
+    
+    count = 0;
+    for (i = 0; i < njobs; i++) {
+        task = &sim_tasks[i];
+        if (task->state == SIM_JOB_DONE) {
+            sim_samples[count++] = task->finish - jobs[i].arrival -
+                                   task->cpu_time - task->io_time;
+        }
+    }
+    sim_percentiles(count, &result->wait);
+    
+    count = 0;
+    for (i = 0; i < njobs; i++) {
+        task = &sim_tasks[i];
+        if (task->state == SIM_JOB_DONE) {
+            sim_samples[count++] = task->finish - jobs[i].arrival;
+        }
+    }
+    sim_percentiles(count, &result->turnaround);
+    
+    count = 0;
+    for (i = 0; i < njobs; i++) {
+        task = &sim_tasks[i];
+        if (task->first_run != UINT64_MAX) {
+            sim_samples[count++] = task->first_run - jobs[i].arrival;
+        }
+    }
+    sim_percentiles(count, &result->response);
+}
+
+static syscall sim_prepare(scheduler_type_t type, bool stacked, const sim_job_t *jobs,
+                           uint32_t njobs, sim_result_t *result) {
+    sim_task_t *task;
+    uint32_t i, j;
+    
+    if (jobs == NULL || result == NULL || njobs == 0 || njobs > SIM_MAX_JOBS) {
+        return SYSERR;
+    }
+    
+    for (i = 0; i < njobs; i++) {
+        if (jobs[i].nphases == 0 || jobs[i].nphases > SIM_MAX_PHASES) {
+            return SYSERR;
+        }
+    }
+    
+    for (i = 0; i < njobs; i++) {
+        task = &sim_tasks[i];
+        task->state = SIM_JOB_NEW;
+        task->phase = 0;
+        task->remaining = 0;
+        task->wake_at = 0;
+        task->first_run = UINT64_MAX;
+        task->finish = 0;
+        task->cpu_time = 0;
+        task->io_time = 0;
+        proctab[SIM_FIRST_PID + i].pstate = PR_FREE;
+    
+        for (j = i; j > 0 && jobs[sim_order[j - 1]].arrival > jobs[i].arrival; j--) {
+            sim_order[j] = sim_order[j - 1];
+        }
+        sim_order[j] = i;
+    }
+    sim_io_count = 0;
+    
+    scheduler_shutdown();
+    scheduler_init(type);
+    if (sched_policy != (uint32_t)type) {
+        return SYSERR;
+    }
+    if (stacked && sched_classes_enable(type) != OK) {
+        return SYSERR;
+    }
+    
+    return OK;
+}
+
+static void sim_finish(const sim_job_t *jobs, uint32_t njobs, uint64_t now,
+                       uint64_t busy, uint32_t done, sim_result_t *result) {
+    uint32_t i;
+    
+    result->policy = sched_get_name();
+    result->ticks = now;
+    result->busy_ticks = busy;
+    result->cpus = SCHED_NCPUS;
+    result->jobs = njobs;
+    result->completed = done;
+    result->context_switches = sched_stats.context_switches;
+    result->migrations = 0;
+    result->steals = 0;
+    for (i = 0; i < SCHED_NCPUS; i++) {
+        result->migrations += sched_cpus[i].migrations;
+        result->steals += sched_cpus[i].steals;
+    }
+    result->throughput = (now > 0) ? (uint32_t)((uint64_t)done * 1000 / now) : 0;
+    result->wakeup.p50 = sched_latency_percentile(-1, SCHED_LAT_WAKEUP, 500) / SCHED_TICK_NS;
+    result->wakeup.p90 = sched_latency_percentile(-1, SCHED_LAT_WAKEUP, 900) / SCHED_TICK_NS;
+    result->wakeup.p99 = sched_latency_percentile(-1, SCHED_LAT_WAKEUP, 990) / SCHED_TICK_NS;
+    result->wakeup.max = sched_stats.latency[SCHED_LAT_WAKEUP].max / SCHED_TICK_NS;
+    
+    sim_collect(jobs, njobs, result);
+}
+
+static void sim_schedule(sim_mode_t mode) {
+    const sched_idle_state_t *states;
+    const sched_idle_cpu_t *idle;
+    uint32_t state;
+    bool was_idle;
+    
+    if (mode != SIM_MODE_IDLE) {
+        schedule();
+        return;
+    }
+    
+    sched_idle_set_timer(0, (sim_io_count > 0) ? sim_tasks[sim_io_heap[0]].wake_at
+                                               : SCHED_NO_EVENT);
+    
+    idle = sched_idle_cpu(0);
+    was_idle = idle->idle;
+    state = idle->state;
+    
+    schedule();
+    
+    if (was_idle && !idle->idle) {
+        sched_idle_get_states(&states);
+        sim_stall += states[state].exit_latency;
+        sim_wakeups++;
+    }
+}
+
+static void sim_loop(const sim_job_t *jobs, uint32_t njobs, uint64_t max_ticks,
+                     sim_mode_t mode, sim_result_t *result) {
+    sim_task_t *task;
+    uint32_t idx, next_arrival, done;
+    uint64_t now, busy;
+    pid32 pid;
+    
+    next_arrival = 0;
+    done = 0;
+    busy = 0;
+    
+    for (now = 0; done < njobs && now < max_ticks; now++) {
+        while (next_arrival < njobs && jobs[sim_order[next_arrival]].arrival <= now) {
+            sim_admit(jobs, sim_order[next_arrival++], mode);
+        }
+    
+        while (sim_io_count > 0 && sim_tasks[sim_io_heap[0]].wake_at <= now) {
+            sim_wake(jobs, io_heap_pop());
+        }
+    
+        if (need_resched) {
+            sim_schedule(mode);
+        }
+    
+        pid = currpid;
+        idx = (uint32_t)(pid - SIM_FIRST_PID);
+        task = NULL;
+        if (sim_stall > 0) {
+            sim_stall--;
+            sim_stall_ticks++;
+        } else if (pid >= SIM_FIRST_PID && idx < njobs &&
+                   sim_tasks[idx].state == SIM_JOB_READY && proctab[pid].pstate == PR_CURR) {
+            task = &sim_tasks[idx];
+            if (task->first_run == UINT64_MAX) {
+                task->first_run = now;
+            }
+            task->cpu_time++;
+            if (task->remaining > 0) {
+                task->remaining--;
+            }
+            busy++;
+        }
+    
+        sched_tick();
+    
+        if (task != NULL && task->remaining == 0 &&
+            sim_burst_done(jobs, idx, now + 1)) {
+            done++;
+        }
+    
+        if (need_resched) {
+            sim_schedule(mode);
+        }
+    }
+    
+    sim_finish(jobs, njobs, now, busy, done, result);
+}
+
+static syscall sim_execute(scheduler_type_t type, bool stacked, const sim_job_t *jobs,
+                           uint32_t njobs, uint64_t max_ticks, sim_result_t *result) {
+    if (sim_prepare(type, stacked, jobs, njobs, result) != OK) {
+        return SYSERR;
+    }
+    
+    sim_loop(jobs, njobs, max_ticks, stacked ? SIM_MODE_CLASSES : SIM_MODE_POLICY, result);
+    
+    return OK;
+}
+
+syscall sim_run(scheduler_type_t type, const sim_job_t *jobs, uint32_t njobs,
+                uint64_t max_ticks, sim_result_t *result) {
+    return sim_execute(type, false, jobs, njobs, max_ticks, result);
+}
+
+syscall sim_run_classes(scheduler_type_t fair, const sim_job_t *jobs, uint32_t njobs,
+                        uint64_t max_ticks, sim_result_t *result) {
+    return sim_execute(fair, true, jobs, njobs, max_ticks, result);
+}
+
+syscall sim_run_capped(scheduler_type_t type, const sim_job_t *jobs, uint32_t njobs,
+                       uint64_t max_ticks, uint64_t quota, uint64_t period,
+                       sim_result_t *result) {
+    int32_t parent;
+    uint32_t i;
+    
+    if (sim_prepare(type, false, jobs, njobs, result) != OK) {
+        return SYSERR;
+    }
+    
+    parent = sched_bw_create(-1, quota, period);
+    if (parent == SYSERR) {
+        return SYSERR;
+    }
+    
+    for (i = 0; i < SIM_CAPPED_GROUPS; i++) {
+        sim_groups[i] = sched_bw_create(parent, (i == 0) ? SCHED_BW_UNLIMITED : quota / 2,
+                                        period);
+        if (sim_groups[i] == SYSERR) {
+            return SYSERR;
+        }
+    }
+    
+    sim_loop(jobs, njobs, max_ticks, SIM_MODE_CAPPED, result);
+    
+    return OK;
+}
+
+syscall sim_run_idle(scheduler_type_t type, const sim_job_t *jobs, uint32_t njobs,
+                     uint64_t max_ticks, sched_idle_gov_t gov, sim_idle_result_t *result) {
+    if (result == NULL || sim_prepare(type, false, jobs, njobs, &result->run) != OK) {
+        return SYSERR;
+    }
+    
+    sched_idle_set_governor(gov);
+    sim_stall = 0;
+    sim_stall_ticks = 0;
+    sim_wakeups = 0;
+    
+    sim_loop(jobs, njobs, max_ticks, SIM_MODE_IDLE, &result->run);
+    
+    result->governor = sim_governors[gov];
+    result->idle_ticks = sched_stats.idle_time;
+    result->stall_ticks = sim_stall_ticks;
+    result->wakeups = sim_wakeups;
+    result->energy = sched_idle_energy() + result->run.busy_ticks * SCHED_IDLE_ACTIVE_POWER;
+    
+    return OK;
+}
+
+#if SCHED_NCPUS > 1
+syscall sim_run_smp(const sim_job_t *jobs, uint32_t njobs, uint64_t max_ticks,
+                    bool balance, sim_result_t *result) {
+    sched_cpu_t *cpu;
+    sim_task_t *task;
+    uint32_t c, idx, next_arrival, done;
+    uint64_t now, busy;
+    pid32 pid;
+    
+    if (sim_prepare(SCHEDULER_CFS, true, jobs, njobs, result) != OK) {
+        return SYSERR;
+    }
+    
+    sched_balance_enable(balance);
+    
+    next_arrival = 0;
+    done = 0;
+    busy = 0;
+    
+    for (now = 0; done < njobs && now < max_ticks; now++) {
+        sim_cpu = 0;
+    
+        while (next_arrival < njobs && jobs[sim_order[next_arrival]].arrival <= now) {
+            sim_admit(jobs, sim_order[next_arrival++], SIM_MODE_SMP);
+        }
+    
+        while (sim_io_count > 0 && sim_tasks[sim_io_heap[0]].wake_at <= now) {
+            sim_wake(jobs, io_heap_pop());
+        }
+    
+        for (c = 0; c < SCHED_NCPUS; c++) {
+            sim_cpu = c;
+            cpu = &sched_cpus[c];
+    
+            if (cpu->need_resched || cpu->curr < 0 ||
+                proctab[cpu->curr].pstate != PR_CURR) {
+                schedule();
+            }
+    
+            pid = cpu->curr;
+            idx = (uint32_t)(pid - SIM_FIRST_PID);
+            task = NULL;
+            if (pid >= SIM_FIRST_PID && idx < njobs &&
+                sim_tasks[idx].state == SIM_JOB_READY &&
+                proctab[pid].pstate == PR_CURR) {
+                task = &sim_tasks[idx];
+                if (task->first_run == UINT64_MAX) {
+                    task->first_run = now;
+                }
+                task->cpu_time++;
+                if (task->remaining > 0) {
+                    task->remaining--;
+                }
+                busy++;
+            }
+    
+            sched_tick();
+    
+            if (task != NULL && task->remaining == 0 &&
+                sim_burst_done(jobs, idx, now + 1)) {
+                done++;
+            }
+    
+            if (cpu->need_resched) {
+                schedule();
+            }
+        }
+    }
+    
+    sim_cpu = 0;
+    sched_balance_enable(true);
+    
+    sim_finish(jobs, njobs, now, busy, done, result);
+    result->policy = balance ? "SMP steal+balance" : "SMP steal only";
+    
+    return OK;
+}
+#endif
+
+#if SCHED_NCPUS > 1
+static uint32_t sim_jitter(uint32_t *state, uint32_t work) {
+    *state = *state * 1103515245 + 12345;
+    return work + (*state >> 16) % work;
+}
+
+static void sim_barrier_release(uint32_t g, uint32_t width, uint32_t phases,
+                                uint32_t work, uint32_t *state) {
+    sim_thread_t *thread;
+    uint32_t t;
+    pid32 pid;
+    
+    sim_arrived[g] = 0;
+    
+    for (t = g * width; t < (g + 1) * width; t++) {
+        thread = &sim_threads[t];
+        pid = SIM_FIRST_PID + t;
+        thread->phase++;
+        thread->waiting = false;
+    
+        if (thread->phase >= phases) {
+            thread->done = true;
+            proctab[pid].pstate = PR_FREE;
+            sched_exit(pid);
+        } else {
+            thread->remaining = sim_jitter(state, work);
+        }
+    }
+}
+
+syscall sim_run_barrier(uint32_t ngangs, uint32_t width, uint32_t phases,
+                        uint32_t work, bool gang, uint64_t max_ticks,
+                        sim_barrier_result_t *result) {
+    sim_thread_t *thread;
+    sched_cpu_t *cpu;
+    uint32_t c, t, g, nthreads, done, state;
+    uint64_t now;
+    int32_t gid;
+    pid32 pid;
+    
+    nthreads = ngangs * width;
+    if (result == NULL || ngangs == 0 || ngangs > SCHED_MAX_GANGS || width == 0 ||
+        width > SCHED_NCPUS || nthreads > SIM_MAX_JOBS || phases == 0 || work == 0) {
+        return SYSERR;
+    }
+    
+    scheduler_shutdown();
+    scheduler_init(SCHEDULER_CFS);
+    if (sched_classes_enable(SCHEDULER_CFS) != OK) {
+        return SYSERR;
+    }
+    
+    result->mode = gang ? "gang" : "independent";
+    result->cpus = SCHED_NCPUS;
+    result->threads = nthreads;
+    result->barriers = 0;
+    result->useful_ticks = 0;
+    result->spin_ticks = 0;
+    result->idle_ticks = 0;
+    
+    state = 1;
+    gid = -1;
+    for (t = 0; t < nthreads; t++) {
+        thread = &sim_threads[t];
+        pid = SIM_FIRST_PID + t;
+        g = t / width;
+    
+        thread->phase = 0;
+        thread->remaining = sim_jitter(&state, work);
+        thread->waiting = false;
+        thread->done = false;
+        sim_arrived[g] = 0;
+    
+        sched_new_process(pid);
+        proctab[pid].pprio = PRIORITY_NORMAL;
+        proctab[pid].pstate = PR_READY;
+        sched_set_class(pid, SCHED_CLASS_IDLE);
+        if (gang) {
+            if (t % width == 0) {
+                gid = sched_gang_create();
+            }
+            sched_gang_join(gid, pid);
+        }
+        sched_ready(pid);
+    }
+    
+    done = 0;
+    for (now = 0; done < nthreads && now < max_ticks; now++) {
+        for (c = 0; c < SCHED_NCPUS; c++) {
+            sim_cpu = c;
+            cpu = &sched_cpus[c];
+    
+            if (cpu->need_resched || cpu->curr < 0 ||
+                proctab[cpu->curr].pstate != PR_CURR) {
+                schedule();
+            }
+    
+            pid = cpu->curr;
+            t = (uint32_t)(pid - SIM_FIRST_PID);
+            if (pid >= SIM_FIRST_PID && t < nthreads && !sim_threads[t].done &&
+                proctab[pid].pstate == PR_CURR) {
+                thread = &sim_threads[t];
+                if (thread->waiting) {
+                    result->spin_ticks++;
+                } else {
+                    result->useful_ticks++;
+                    if (--thread->remaining == 0) {
+                        thread->waiting = true;
+                        g = t / width;
+                        if (++sim_arrived[g] == width) {
+                            sim_barrier_release(g, width, phases, work, &state);
+                            result->barriers++;
+                            if (sim_threads[t].done) {
+                                done += width;
+                            }
+                        }
+                    }
+                }
+            } else {
+                result->idle_ticks++;
+            }
+    
+            sched_tick();
+    
+            if (cpu->need_resched) {
+                schedule();
+            }
+        }
+    }
+    
+    sim_cpu = 0;
+    
+    result->ticks = now;
+    result->context_switches = sched_stats.context_switches;
+    
+    return OK;
+}
+#endif
+
+void sim_compare(const sim_job_t *jobs, uint32_t njobs, uint64_t max_ticks) {
+    sim_result_t result;
+    uint32_t i;
+    
+    for (i = 0; i < sizeof(sim_policies) / sizeof(sim_policies[0]); i++) {
+        if (sim_run(sim_policies[i], jobs, njobs, max_ticks, &result) == OK) {
+            sim_print_result(&result);
+        }
+    }
+}
+
+void sim_compare_idle(scheduler_type_t type, const sim_job_t *jobs, uint32_t njobs,
+                      uint64_t max_ticks) {
+    sim_idle_result_t result;
+    uint32_t gov;
+    
+    for (gov = SCHED_IDLE_GOV_MENU; gov <= SCHED_IDLE_GOV_DEEP; gov++) {
+        if (sim_run_idle(type, jobs, njobs, max_ticks, (sched_idle_gov_t)gov,
+                         &result) == OK) {
+            sim_print_idle(&result);
+            sched_idle_print();
+        }
+    }
+}
+
+void sim_workload_mixed(sim_job_t *jobs, uint32_t njobs, uint32_t seed) {
+    uint32_t i, p, state;
+    bool interactive;
+    
+    state = (seed != 0) ? seed : 1;
+    
+    for (i = 0; i < njobs; i++) {
+        state = state * 1103515245 + 12345;
+        interactive = ((state >> 16) % 3) != 0;
+    
+        state = state * 1103515245 + 12345;
+        jobs[i].arrival = (uint64_t)i * 10 + ((state >> 16) % 10);
+        jobs[i].priority = interactive ? PRIORITY_NORMAL + 10 : PRIORITY_NORMAL - 10;
+        jobs[i].realtime = interactive && (i % 4) == 0;
+        jobs[i].affinity = 0;
+        jobs[i].capped = !interactive;
+        jobs[i].nphases = interactive ? SIM_MAX_PHASES : 4;
+    
+        for (p = 0; p < jobs[i].nphases; p++) {
+            state = state * 1103515245 + 12345;
+            jobs[i].cpu_burst[p] = interactive ? 1 + (state >> 16) % 4
+                                               : 50 + (state >> 16) % 150;
+            state = state * 1103515245 + 12345;
+            jobs[i].io_wait[p] = interactive ? 5 + (state >> 16) % 25
+                                             : 10 + (state >> 16) % 10;
+        }
+    }
+}
+
+void sim_workload_bursty(sim_job_t *jobs, uint32_t njobs, uint32_t seed) {
+    uint32_t i, p, state, period;
+    bool periodic;
+    
+    state = (seed != 0) ? seed : 1;
+    
+    for (i = 0; i < njobs; i++) {
+        state = state * 1103515245 + 12345;
+        periodic = (i % 2) == 0;
+        period = 20 + (state >> 16) % 60;
+    
+        jobs[i].arrival = (uint64_t)i * 25;
+        jobs[i].priority = PRIORITY_NORMAL;
+        jobs[i].realtime = false;
+        jobs[i].affinity = 0;
+        jobs[i].capped = false;
+        jobs[i].nphases = SIM_MAX_PHASES;
+    
+        for (p = 0; p < jobs[i].nphases; p++) {
+            state = state * 1103515245 + 12345;
+            jobs[i].cpu_burst[p] = 1 + (state >> 16) % 3;
+            state = state * 1103515245 + 12345;
+            jobs[i].io_wait[p] = periodic ? period : 5 + (state >> 16) % 120;
+        }
+    }
+}
+
+void sim_print_result(const sim_result_t *result) {
+    if (result == NULL) {
+        return;
+    }
+    
+    kprintf("\n=== Simulation: %s ===\n", result->policy);
+    kprintf("Jobs Completed: %u/%u in %llu ticks\n",
+            result->completed, result->jobs, result->ticks);
+    kprintf("Throughput: %u jobs/1000 ticks\n", result->throughput);
+    kprintf("Utilization: %llu%%\n",
+            (result->ticks > 0) ?
+            result->busy_ticks * 100 / (result->ticks * result->cpus) : 0);
+    kprintf("Context Switches: %llu\n", result->context_switches);
+    if (result->cpus > 1) {
+        kprintf("CPUs: %u  Migrations: %llu  Steals: %llu\n",
+                result->cpus, result->migrations, result->steals);
+    }
+    kprintf("              p50      p90      p99      max\n");
+    kprintf("Wait:       %7llu  %7llu  %7llu  %7llu\n",
+            result->wait.p50, result->wait.p90, result->wait.p99, result->wait.max);
+    kprintf("Turnaround: %7llu  %7llu  %7llu  %7llu\n",
+            result->turnaround.p50, result->turnaround.p90,
+            result->turnaround.p99, result->turnaround.max);
+    kprintf("Response:   %7llu  %7llu  %7llu  %7llu\n",
+            result->response.p50, result->response.p90,
+            result->response.p99, result->response.max);
+    kprintf("Wakeup:     %7llu  %7llu  %7llu  %7llu\n",
+            result->wakeup.p50, result->wakeup.p90,
+            result->wakeup.p99, result->wakeup.max);
+}
+
+void sim_print_barrier(const sim_barrier_result_t *result) {
+    uint64_t busy;
+    
+    if (result == NULL) {
+        return;
+    }
+    
+    busy = result->useful_ticks + result->spin_ticks;
+    
+    kprintf("\n=== Barrier workload: %s ===\n", result->mode);
+    kprintf("Threads: %u on %u CPUs  Barriers: %u in %llu ticks\n",
+            result->threads, result->cpus, result->barriers, result->ticks);
+    kprintf("Useful: %llu  Spin: %llu (%llu%% of busy)  Idle: %llu\n",
+            result->useful_ticks, result->spin_ticks,
+            (busy > 0) ? result->spin_ticks * 100 / busy : 0, result->idle_ticks);
+    kprintf("Context Switches: %llu\n", result->context_switches);
+}
+
+void sim_print_idle(const sim_idle_result_t *result) {
+    if (result == NULL) {
+        return;
+    }
+    
+    kprintf("\n=== Idle governor: %s (%s) ===\n", result->governor, result->run.policy);
+    kprintf("Jobs Completed: %u/%u in %llu ticks\n",
+            result->run.completed, result->run.jobs, result->run.ticks);
+    kprintf("Busy: %llu  Idle: %llu  Wakeups: %llu  Exit stall: %llu ticks\n",
+            result->run.busy_ticks, result->idle_ticks, result->wakeups,
+            result->stall_ticks);
+    kprintf("Energy: %llu (%llu per tick)\n", result->energy,
+            (result->run.ticks > 0) ? result->energy / result->run.ticks : 0);
+    kprintf("              p50      p90      p99      max\n");
+    kprintf("Response:   %7llu  %7llu  %7llu  %7llu\n",
+            result->run.response.p50, result->run.response.p90,
+            result->run.response.p99, result->run.response.max);
+    kprintf("Wait:       %7llu  %7llu  %7llu  %7llu\n",
+            result->run.wait.p50, result->run.wait.p90,
+            result->run.wait.p99, result->run.wait.max);
+}
@@ -0,0 +1,116 @@
+#ifndef _SCHED_SIM_H_
+#define _SCHED_SIM_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "scheduler.h"
+#include "sched_idle.h"
+
+#define SIM_MAX_JOBS            (NPROC - 1)
+#define SIM_MAX_PHASES          16
+#define SIM_FIRST_PID           1
+#define SIM_CAPPED_GROUPS       2
+
+typedef enum {
+    SIM_JOB_NEW,
+    SIM_JOB_READY,
+    SIM_JOB_IO,
+    SIM_JOB_DONE
+} sim_job_state_t;
+
+typedef struct sim_job {
+    uint64_t arrival;
+    uint32_t priority;
+    bool realtime;
+    sched_cpumask_t affinity;
+    bool capped;
+    uint32_t nphases;
+    uint32_t cpu_burst[SIM_MAX_PHASES];
+    uint32_t io_wait[SIM_MAX_PHASES];
+} sim_job_t;
+
+typedef struct sim_percentiles {
+    uint64_t p50;
+    uint64_t p90;
+    uint64_t p99;
+    uint64_t max;
+} sim_percentiles_t;
+
+typedef struct sim_result {
+    const char *policy;
+    uint64_t ticks;
+    uint64_t busy_ticks;
+    uint32_t cpus;
+    uint32_t jobs;
+    uint32_t completed;
+    uint64_t context_switches;
+    uint64_t migrations;
+    uint64_t steals;
+    uint32_t throughput;
+    sim_percentiles_t wait;
+    sim_percentiles_t turnaround;
+    sim_percentiles_t response;
+    sim_percentiles_t wakeup;
+} sim_result_t;
+
+syscall sim_run(scheduler_type_t type, const sim_job_t *jobs, uint32_t njobs,
+                uint64_t max_ticks, sim_result_t *result);
+
+syscall sim_run_capped(scheduler_type_t type, const sim_job_t *jobs, uint32_t njobs,
+                       uint64_t max_ticks, uint64_t quota, uint64_t period,
+                       sim_result_t *result);
+
+syscall sim_run_classes(scheduler_type_t fair, const sim_job_t *jobs, uint32_t njobs,
+                        uint64_t max_ticks, sim_result_t *result);
+
+typedef struct sim_idle_result {
+    const char *governor;
+    sim_result_t run;
+    uint64_t idle_ticks;
+    uint64_t stall_ticks;
+    uint64_t wakeups;
+    uint64_t energy;
+} sim_idle_result_t;
+
+syscall sim_run_idle(scheduler_type_t type, const sim_job_t *jobs, uint32_t njobs,
+                     uint64_t max_ticks, sched_idle_gov_t gov, sim_idle_result_t *result);
+
+typedef struct sim_barrier_result {
+    const char *mode;
+    uint32_t cpus;
+    uint32_t threads;
+    uint32_t barriers;
+    uint64_t ticks;
+    uint64_t useful_ticks;
+    uint64_t spin_ticks;
+    uint64_t idle_ticks;
+    uint64_t context_switches;
+} sim_barrier_result_t;
+
+#if SCHED_NCPUS > 1
+extern uint32_t sim_cpu;
+
+syscall sim_run_barrier(uint32_t ngangs, uint32_t width, uint32_t phases,
+                        uint32_t work, bool gang, uint64_t max_ticks,
+                        sim_barrier_result_t *result);
+
+syscall sim_run_smp(const sim_job_t *jobs, uint32_t njobs, uint64_t max_ticks,
+                    bool balance, sim_result_t *result);
+#endif
+
+void sim_compare(const sim_job_t *jobs, uint32_t njobs, uint64_t max_ticks);
+
+void sim_compare_idle(scheduler_type_t type, const sim_job_t *jobs, uint32_t njobs,
+                      uint64_t max_ticks);
+
+void sim_workload_mixed(sim_job_t *jobs, uint32_t njobs, uint32_t seed);
+
+void sim_workload_bursty(sim_job_t *jobs, uint32_t njobs, uint32_t seed);
+
+void sim_print_result(const sim_result_t *result);
+
+void sim_print_barrier(const sim_barrier_result_t *result);
+
+void sim_print_idle(const sim_idle_result_t *result);
+
+#endif
@@ -0,0 +1,826 @@
+#ifdef SCHED_SIM_HOSTED
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "sched_sim.h"
+#include "sched_bench.h"
+#include "sched_trace.h"
+#include "sched_topology.h"
+#include "sched_idle.h"
+#include "sched_tunables.h"
+#include "sched_prof.h"
+#include "sched_wlat.h"
+#include "scheduler.h"
+#include "../include/kernel.h"
+#include "../include/process.h"
+
+#define SIM_HOST_DEFAULT_TICKS  10000000ULL
+#define SIM_HOST_SCALE_MS       200
+#define SIM_HOST_RACE_MS        200
+#define SIM_HOST_RACE_PIDS      8
+
+proc_t proctab[NPROC];
+
+pid32 currpid = NULLPROC;
+
+static sid32 host_nsems = 0;
+
+intmask disable(void) {
+    return 0;
+}
+
+void restore(intmask mask) {
+    (void)mask;
+}
+
+sid32 semcreate(int32 count) {
+    (void)count;
+    return host_nsems++;
+}
+
+syscall wait(sid32 sem) {
+    (void)sem;
+    return OK;
+}
+
+syscall signal(sid32 sem) {
+    (void)sem;
+    return OK;
+}
+
+syscall kprintf(char *fmt, ...) {
+    va_list args;
+    
+    va_start(args, fmt);
+    vprintf(fmt, args);
+    va_end(args);
+    
+    return OK;
+}
+
+void context_switch(pid32 oldpid, pid32 newpid) {
+    (void)oldpid;
+    (void)newpid;
+}
+
+void save_context(void) {
+}
+
+void restore_context(pid32 pid) {
+    (void)pid;
+}
+
+uint64_t clkoneshot(uint64_t ticks) {
+    (void)ticks;
+    return 0;
+}
+
+#if SCHED_NCPUS > 1
+typedef struct host_cpu_thread {
+    pthread_t thread;
+    uint32_t cpu;
+    uint32_t npids;
+    uint64_t dispatches;
+    pid32 pids[NPROC];
+} host_cpu_thread_t;
+
+static __thread int32_t host_thread_cpu = -1;
+
+static bool host_scale_stop = false;
+
+static pid32 host_race_pid;
+static uint64_t host_race_lost;
+
+uint32_t getcpuid(void) {
+    return (host_thread_cpu >= 0) ? (uint32_t)host_thread_cpu : sim_cpu;
+}
+#endif
+
+static uint32_t host_cpu_mhz(void) {
+    struct timespec t0, t1;
+    uint64_t c0, c1, ns;
+    
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    c0 = sched_bench_cycles();
+    do {
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        ns = (uint64_t)(t1.tv_sec - t0.tv_sec) * 1000000000ULL +
+             (uint64_t)(t1.tv_nsec - t0.tv_nsec);
+    } while (ns < 50000000ULL);
+    c1 = sched_bench_cycles();
+    
+    return (uint32_t)((c1 - c0) * 1000 / ns);
+}
+
+static uint64_t host_clock_ns(void) {
+    struct timespec ts;
+    
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static int host_bench(int argc, char **argv) {
+    uint32_t max_depth;
+    
+    max_depth = (argc > 2) ? (uint32_t)strtoul(argv[2], NULL, 0) : 0;
+    
+    proctab[NULLPROC].pstate = PR_CURR;
+    proctab[NULLPROC].pprio = PRIORITY_IDLE;
+    
+    sched_bench_set_mhz(host_cpu_mhz());
+    sched_bench_all(max_depth);
+    
+    return 0;
+}
+
+static int host_dispatch(int argc, char **argv) {
+    scheduler_type_t type;
+    uint32_t depth;
+    
+    type = (argc > 2) ? (scheduler_type_t)strtoul(argv[2], NULL, 0) : SCHEDULER_ROUND_ROBIN;
+    depth = (argc > 3) ? (uint32_t)strtoul(argv[3], NULL, 0) : 0;
+    
+    proctab[NULLPROC].pstate = PR_CURR;
+    proctab[NULLPROC].pprio = PRIORITY_IDLE;
+    
+    scheduler_init(type);
+    
+    sched_bench_set_mhz(host_cpu_mhz());
+    printf("policy,op,depth,iters,cycles_per_op,min_cycles,ns_per_op\n");
+    sched_bench_dispatch(depth);
+    
+    return 0;
+}
+
+static int host_timers(int argc, char **argv) {
+    uint32_t max_timers;
+    
+    max_timers = (argc > 2) ? (uint32_t)strtoul(argv[2], NULL, 0) : 0;
+    
+    proctab[NULLPROC].pstate = PR_CURR;
+    proctab[NULLPROC].pprio = PRIORITY_IDLE;
+    
+    scheduler_init(SCHEDULER_ROUND_ROBIN);
+    
+    sched_bench_set_mhz(host_cpu_mhz());
+    printf("policy,op,depth,iters,cycles_per_op,min_cycles,ns_per_op\n");
+    if (sched_bench_timers(max_timers) != OK) {
+        printf("timers: a benchmark timer fired early\n");
+        return 1;
+    }
+    
+    return 0;
+}
+
+static int host_ready(int argc, char **argv) {
+    uint32_t max_depth;
+    
+    max_depth = (argc > 2) ? (uint32_t)strtoul(argv[2], NULL, 0) : 0;
+    
+    proctab[NULLPROC].pstate = PR_CURR;
+    proctab[NULLPROC].pprio = PRIORITY_IDLE;
+    
+    scheduler_init(SCHEDULER_ROUND_ROBIN);
+    
+    sched_bench_set_mhz(host_cpu_mhz());
+    printf("policy,op,depth,iters,cycles_per_op,min_cycles,ns_per_op\n");
+    if (sched_bench_ready(max_depth) != OK) {
+        printf("ready: depth must be at least %u\n", SCHED_BENCH_READY_MIN_DEPTH);
+        return 1;
+    }
+    
+    return 0;
+}
+
+static int host_prof(int argc, char **argv) {
+#ifdef SCHED_PROFILE
+    static sim_job_t jobs[SIM_MAX_JOBS];
+    sched_prof_export_t snapshot;
+    sim_result_t result;
+    scheduler_type_t type;
+    
+    type = (argc > 2) ? (scheduler_type_t)strtoul(argv[2], NULL, 0) : SCHEDULER_CFS;
+    
+    proctab[NULLPROC].pstate = PR_CURR;
+    proctab[NULLPROC].pprio = PRIORITY_IDLE;
+    
+    sim_workload_mixed(jobs, SIM_MAX_JOBS, 1);
+    
+    sched_prof_reset();
+    if (sim_run(type, jobs, SIM_MAX_JOBS, SIM_HOST_DEFAULT_TICKS, &result) != OK) {
+        return 1;
+    }
+    
+    sim_print_result(&result);
+    sched_prof_print();
+    
+    if (sched_prof_export(&snapshot, sizeof(snapshot)) != sizeof(snapshot) ||
+        snapshot.magic != SCHED_PROF_MAGIC) {
+        printf("prof: export failed\n");
+        return 1;
+    }
+    printf("\nExport: %u bytes, %u ops x %u buckets\n", (uint32_t)sizeof(snapshot),
+           snapshot.nops, snapshot.nbuckets);
+    
+    return 0;
+#else
+    (void)argc;
+    (void)argv;
+    printf("prof: rebuild with -DSCHED_PROFILE\n");
+    return 1;
+#endif
+}
+
+static int host_classes(int argc, char **argv) {
+    static sim_job_t jobs[SIM_MAX_JOBS];
+    sim_result_t result;
+    uint32_t njobs, seed;
+    
+    njobs = (argc > 2) ? (uint32_t)strtoul(argv[2], NULL, 0) : SIM_MAX_JOBS;
+    seed = (argc > 3) ? (uint32_t)strtoul(argv[3], NULL, 0) : 1;
+    if (njobs == 0 || njobs > SIM_MAX_JOBS) {
+        njobs = SIM_MAX_JOBS;
+    }
+    
+    proctab[NULLPROC].pstate = PR_CURR;
+    proctab[NULLPROC].pprio = PRIORITY_IDLE;
+    
+    sim_workload_mixed(jobs, njobs, seed);
+    
+    if (sim_run_classes(SCHEDULER_CFS, jobs, njobs, SIM_HOST_DEFAULT_TICKS, &result) == OK) {
+        sim_print_result(&result);
+    }
+    if (sim_run_classes(SCHEDULER_MLFQ, jobs, njobs, SIM_HOST_DEFAULT_TICKS, &result) == OK) {
+        sim_print_result(&result);
+    }
+    
+    return 0;
+}
+
+static int host_smp(int argc, char **argv) {
+#if SCHED_NCPUS > 1
+    static sim_job_t jobs[SIM_MAX_JOBS];
+    sim_result_t result;
+    uint32_t njobs, seed, i;
+    
+    njobs = (argc > 2) ? (uint32_t)strtoul(argv[2], NULL, 0) : SIM_MAX_JOBS;
+    seed = (argc > 3) ? (uint32_t)strtoul(argv[3], NULL, 0) : 1;
+    if (njobs == 0 || njobs > SIM_MAX_JOBS) {
+        njobs = SIM_MAX_JOBS;
+    }
+    
+    proctab[NULLPROC].pstate = PR_CURR;
+    proctab[NULLPROC].pprio = PRIORITY_IDLE;
+    
+    sim_workload_mixed(jobs, njobs, seed);
+    
+    if (sim_run_smp(jobs, njobs, SIM_HOST_DEFAULT_TICKS, false, &result) == OK) {
+        sim_print_result(&result);
+    }
+    if (sim_run_smp(jobs, njobs, SIM_HOST_DEFAULT_TICKS, true, &result) == OK) {
+        sim_print_result(&result);
+    }
+    
+    for (i = 0; i < njobs; i += 4) {
+        jobs[i].affinity = 1u << (i / 4 % SCHED_NCPUS);
+    }
+    if (sim_run_smp(jobs, njobs, SIM_HOST_DEFAULT_TICKS, true, &result) == OK) {
+        printf("\n(every 4th job pinned to one CPU)");
+        sim_print_result(&result);
+        sched_validate();
+    }
+    
+    sched_topology_print();
+#else
+    (void)argc;
+    (void)argv;
+    printf("smp: rebuild with -DSCHED_NCPUS=N (N > 1)\n");
+#endif
+    
+    return 0;
+}
+
+#if SCHED_NCPUS > 1
+static void *host_scale_cpu(void *arg) {
+    host_cpu_thread_t *t = arg;
+    uint32_t i, n;
+    pid32 pid;
+    
+    host_thread_cpu = (int32_t)t->cpu;
+    
+    while (!__atomic_load_n(&host_scale_stop, __ATOMIC_ACQUIRE)) {
+        for (i = 0; i < t->npids; i++) {
+            ready_enqueue_cpu(t->cpu, t->pids[i]);
+        }
+    
+        n = 0;
+        while ((pid = ready_pop_cpu(t->cpu)) >= 0 || (pid = sched_steal(t->cpu)) >= 0) {
+            t->pids[n++] = pid;
+        }
+    
+        t->npids = n;
+        t->dispatches += n;
+    }
+    
+    return NULL;
+}
+
+static uint64_t host_scale_run(host_cpu_thread_t *threads, uint32_t ncpus, uint32_t ms,
+                               uint64_t *steals) {
+    struct timespec pause;
+    uint64_t dispatches, stolen;
+    uint32_t i;
+    pid32 pid;
+    
+    for (i = 0; i < ncpus; i++) {
+        threads[i].cpu = i;
+        threads[i].npids = 0;
+        threads[i].dispatches = 0;
+    }
+    for (pid = NULLPROC + 1; pid < NPROC; pid++) {
+        proctab[pid].pstate = PR_READY;
+        proctab[pid].pprio = PRIORITY_DEFAULT;
+        i = (uint32_t)pid % ncpus;
+        threads[i].pids[threads[i].npids++] = pid;
+    }
+    
+    stolen = 0;
+    for (i = 0; i < SCHED_NCPUS; i++) {
+        stolen += sched_cpus[i].steals;
+    }
+    
+    __atomic_store_n(&host_scale_stop, false, __ATOMIC_RELEASE);
+    for (i = 0; i < ncpus; i++) {
+        pthread_create(&threads[i].thread, NULL, host_scale_cpu, &threads[i]);
+    }
+    
+    pause.tv_sec = ms / 1000;
+    pause.tv_nsec = (long)(ms % 1000) * 1000000L;
+    nanosleep(&pause, NULL);
+    __atomic_store_n(&host_scale_stop, true, __ATOMIC_RELEASE);
+    
+    dispatches = 0;
+    for (i = 0; i < ncpus; i++) {
+        pthread_join(threads[i].thread, NULL);
+        dispatches += threads[i].dispatches;
+    }
+    
+    *steals = 0 - stolen;
+    for (i = 0; i < SCHED_NCPUS; i++) {
+        *steals += sched_cpus[i].steals;
+    }
+    
+    return dispatches;
+}
+#endif
+
+static int host_scale(int argc, char **argv) {
+#if SCHED_NCPUS > 1
+    static host_cpu_thread_t threads[SCHED_NCPUS];
+    uint64_t dispatches, base, steals;
+    uint32_t ms, ncpus;
+    
+    ms = (argc > 2) ? (uint32_t)strtoul(argv[2], NULL, 0) : SIM_HOST_SCALE_MS;
+    if (ms == 0) {
+        ms = SIM_HOST_SCALE_MS;
+    }
+    
+    proctab[NULLPROC].pstate = PR_CURR;
+    proctab[NULLPROC].pprio = PRIORITY_IDLE;
+    
+    scheduler_init(SCHEDULER_ROUND_ROBIN);
+    
+    printf("cpus,dispatches_per_sec,ns_per_dispatch,speedup,steals\n");
+    
+    base = 0;
+    ncpus = 1;
+    while (true) {
+        dispatches = host_scale_run(threads, ncpus, ms, &steals);
+        if (base == 0) {
+            base = (dispatches > 0) ? dispatches : 1;
+        }
+    
+        printf("%u,%llu,%llu,%llu.%02llu,%llu\n", ncpus,
+               (unsigned long long)(dispatches * 1000 / ms),
+               (unsigned long long)(dispatches ? (uint64_t)ms * 1000000ULL * ncpus / dispatches : 0),
+               (unsigned long long)(dispatches / base),
+               (unsigned long long)(dispatches * 100 / base % 100),
+               (unsigned long long)steals);
+    
+        if (ncpus == SCHED_NCPUS) {
+            break;
+        }
+        ncpus = (ncpus * 2 < SCHED_NCPUS) ? ncpus * 2 : SCHED_NCPUS;
+    }
+    
+    sched_validate();
+#else
+    (void)argc;
+    (void)argv;
+    printf("scale: rebuild with -DSCHED_NCPUS=N (N > 1)\n");
+#endif
+    
+    return 0;
+}
+
+#if SCHED_NCPUS > 1
+static void *host_race_enqueue(void *arg) {
+    host_cpu_thread_t *t = arg;
+    
+    host_thread_cpu = (int32_t)t->cpu;
+    
+    while (!__atomic_load_n(&host_scale_stop, __ATOMIC_ACQUIRE)) {
+        ready_enqueue_cpu(1, host_race_pid);
+        t->dispatches++;
+    }
+    
+    return NULL;
+}
+
+static void *host_race_dequeue(void *arg) {
+    host_cpu_thread_t *t = arg;
+    uint32_t i, popped;
+    pid32 pid;
+    
+    host_thread_cpu = (int32_t)t->cpu;
+    
+    while (!__atomic_load_n(&host_scale_stop, __ATOMIC_ACQUIRE)) {
+        for (i = 0; i < t->npids; i++) {
+            ready_enqueue_cpu(1, t->pids[i]);
+        }
+    
+        ready_dequeue(host_race_pid);
+    
+        popped = 0;
+        while ((pid = ready_pop_cpu(1)) >= 0) {
+            if (pid != host_race_pid) {
+                popped++;
+            }
+        }
+    
+        host_race_lost += t->npids - popped;
+        t->dispatches++;
+    }
+    
+    return NULL;
+}
+#endif
+
+static int host_race(int argc, char **argv) {
+#if SCHED_NCPUS > 1
+    static host_cpu_thread_t threads[2];
+    struct timespec pause;
+    uint32_t ms, i;
+    pid32 pid;
+    
+    ms = (argc > 2) ? (uint32_t)strtoul(argv[2], NULL, 0) : SIM_HOST_RACE_MS;
+    if (ms == 0) {
+        ms = SIM_HOST_RACE_MS;
+    }
+    
+    proctab[NULLPROC].pstate = PR_CURR;
+    proctab[NULLPROC].pprio = PRIORITY_IDLE;
+    
+    scheduler_init(SCHEDULER_ROUND_ROBIN);
+    
+    host_race_pid = NPROC - 1;
+    host_race_lost = 0;
+    
+    for (i = 0; i < 2; i++) {
+        threads[i].cpu = i;
+        threads[i].npids = 0;
+        threads[i].dispatches = 0;
+    }
+    for (pid = NULLPROC + 1; pid <= SIM_HOST_RACE_PIDS; pid++) {
+        threads[1].pids[threads[1].npids++] = pid;
+    }
+    for (pid = NULLPROC + 1; pid < NPROC; pid++) {
+        if (pid <= SIM_HOST_RACE_PIDS || pid == host_race_pid) {
+            proctab[pid].pstate = PR_READY;
+            proctab[pid].pprio = PRIORITY_DEFAULT;
+            sched_set_affinity(pid, 1u << 1);
+        }
+    }
+    
+    __atomic_store_n(&host_scale_stop, false, __ATOMIC_RELEASE);
+    pthread_create(&threads[0].thread, NULL, host_race_enqueue, &threads[0]);
+    pthread_create(&threads[1].thread, NULL, host_race_dequeue, &threads[1]);
+    
+    pause.tv_sec = ms / 1000;
+    pause.tv_nsec = (long)(ms % 1000) * 1000000L;
+    nanosleep(&pause, NULL);
+    __atomic_store_n(&host_scale_stop, true, __ATOMIC_RELEASE);
+    
+    for (i = 0; i < 2; i++) {
+        pthread_join(threads[i].thread, NULL);
+    }
+    
+    ready_dequeue(host_race_pid);
+    
+    printf("race: %llu enqueues of pid %d from CPU 0, %llu dequeue rounds on CPU 1, "
+           "%llu queued pids lost\n",
+           (unsigned long long)threads[0].dispatches, host_race_pid,
+           (unsigned long long)threads[1].dispatches, (unsigned long long)host_race_lost);
+    
+    if (!sched_validate() || host_race_lost > 0) {
+        printf("race: FAILED\n");
+        return 1;
+    }
+    printf("race: ok\n");
+#else
+    (void)argc;
+    (void)argv;
+    printf("race: rebuild with -DSCHED_NCPUS=N (N > 1)\n");
+#endif
+    
+    return 0;
+}
+
+static int host_bw(int argc, char **argv) {
+    static sim_job_t jobs[SIM_MAX_JOBS];
+    sim_result_t result;
+    uint64_t quota, period;
+    uint32_t njobs;
+    
+    quota = (argc > 2) ? strtoull(argv[2], NULL, 0) : 30;
+    period = (argc > 3) ? strtoull(argv[3], NULL, 0) : 100;
+    njobs = (argc > 4) ? (uint32_t)strtoul(argv[4], NULL, 0) : SIM_MAX_JOBS;
+    if (njobs == 0 || njobs > SIM_MAX_JOBS) {
+        njobs = SIM_MAX_JOBS;
+    }
+    
+    proctab[NULLPROC].pstate = PR_CURR;
+    proctab[NULLPROC].pprio = PRIORITY_IDLE;
+    
+    sim_workload_mixed(jobs, njobs, 1);
+    
+    if (sim_run(SCHEDULER_CFS, jobs, njobs, SIM_HOST_DEFAULT_TICKS, &result) == OK) {
+        sim_print_result(&result);
+    }
+    if (sim_run_capped(SCHEDULER_CFS, jobs, njobs, SIM_HOST_DEFAULT_TICKS,
+                       quota, period, &result) == OK) {
+        printf("\n(batch jobs capped at %llu/%llu ticks)",
+               (unsigned long long)quota, (unsigned long long)period);
+        sim_print_result(&result);
+        sched_bw_print();
+        sched_validate();
+    }
+    
+    return 0;
+}
+
+static int host_idle(int argc, char **argv) {
+    static sim_job_t jobs[SIM_MAX_JOBS];
+    uint32_t njobs, limit;
+    
+    njobs = (argc > 2) ? (uint32_t)strtoul(argv[2], NULL, 0) : 8;
+    limit = (argc > 3) ? (uint32_t)strtoul(argv[3], NULL, 0) : SCHED_IDLE_NO_LIMIT;
+    if (njobs == 0 || njobs > SIM_MAX_JOBS) {
+        njobs = 8;
+    }
+    
+    proctab[NULLPROC].pstate = PR_CURR;
+    proctab[NULLPROC].pprio = PRIORITY_IDLE;
+    
+    sim_workload_bursty(jobs, njobs, 1);
+    
+    sched_idle_set_latency_limit(limit);
+    sim_compare_idle(SCHEDULER_CFS, jobs, njobs, SIM_HOST_DEFAULT_TICKS);
+    
+    return 0;
+}
+
+static int host_tune(int argc, char **argv) {
+    static sim_job_t jobs[SIM_MAX_JOBS];
+    sched_tunable_update_t updates[SCHED_TUNABLES_MAX_BATCH];
+    uint32_t count, i;
+    int32_t id;
+    
+    count = 0;
+    for (i = 2; i + 1 < (uint32_t)argc && count < SCHED_TUNABLES_MAX_BATCH; i += 2) {
+        id = sched_tunable_lookup(argv[i]);
+        if (id == SYSERR) {
+            printf("tune: unknown tunable %s\n", argv[i]);
+            return 1;
+        }
+        updates[count].id = (sched_tunable_id_t)id;
+        updates[count].value = (uint32_t)strtoul(argv[i + 1], NULL, 0);
+        count++;
+    }
+    
+    if (count > 0 && sched_tunables_apply(updates, count) != OK) {
+        printf("tune: rejected, no tunable changed\n");
+    }
+    sched_tunables_print();
+    
+    proctab[NULLPROC].pstate = PR_CURR;
+    proctab[NULLPROC].pprio = PRIORITY_IDLE;
+    
+    sim_workload_mixed(jobs, SIM_MAX_JOBS, 1);
+    sim_compare(jobs, SIM_MAX_JOBS, SIM_HOST_DEFAULT_TICKS);
+    
+    return 0;
+}
+
+static int host_gang(int argc, char **argv) {
+#if SCHED_NCPUS > 1
+    sim_barrier_result_t result;
+    uint32_t ngangs, phases;
+    
+    ngangs = (argc > 2) ? (uint32_t)strtoul(argv[2], NULL, 0) : 3;
+    phases = (argc > 3) ? (uint32_t)strtoul(argv[3], NULL, 0) : 50;
+    
+    proctab[NULLPROC].pstate = PR_CURR;
+    proctab[NULLPROC].pprio = PRIORITY_IDLE;
+    
+    if (sim_run_barrier(ngangs, SCHED_NCPUS, phases, 4, false,
+                        SIM_HOST_DEFAULT_TICKS, &result) == OK) {
+        sim_print_barrier(&result);
+    }
+    if (sim_run_barrier(ngangs, SCHED_NCPUS, phases, 4, true,
+                        SIM_HOST_DEFAULT_TICKS, &result) == OK) {
+        sim_print_barrier(&result);
+        sched_validate();
+    }
+#else
+    (void)argc;
+    (void)argv;
+    printf("gang: rebuild with -DSCHED_NCPUS=N (N > 1)\n");
+#endif
+    
+    return 0;
+}
+
+static int host_trace(int argc, char **argv) {
+    static sim_job_t jobs[SIM_MAX_JOBS];
+    sim_result_t result;
+    struct timespec t0, t1;
+    uint32_t njobs, i;
+    uint64_t ns;
+    
+    njobs = (argc > 2) ? (uint32_t)strtoul(argv[2], NULL, 0) : 4;
+    if (njobs == 0 || njobs > SIM_MAX_JOBS) {
+        njobs = 4;
+    }
+    
+    proctab[NULLPROC].pstate = PR_CURR;
+    proctab[NULLPROC].pprio = PRIORITY_IDLE;
+    
+    sim_workload_mixed(jobs, njobs, 1);
+    
+    sched_clock_set_source(host_clock_ns);
+    sched_trace_enable(true);
+    sim_run(SCHEDULER_ROUND_ROBIN, jobs, njobs, SIM_HOST_DEFAULT_TICKS, &result);
+    sched_trace_dump();
+    
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (i = 0; i < 1000000; i++) {
+        sched_trace_emit(TRACE_ENQUEUE, (pid32)(i & 63), i);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    sched_trace_enable(false);
+    
+    ns = (uint64_t)(t1.tv_sec - t0.tv_sec) * 1000000000ULL +
+         (uint64_t)(t1.tv_nsec - t0.tv_nsec);
+    printf("\nsched_trace_emit: %llu.%02llu ns/event\n",
+           (unsigned long long)(ns / 1000000),
+           (unsigned long long)(ns % 1000000 / 10000));
+    
+    return 0;
+}
+
+static int host_wlat(int argc, char **argv) {
+    static sim_job_t jobs[SIM_MAX_JOBS];
+    sim_result_t result;
+    scheduler_type_t type;
+    struct timespec t0, t1;
+    uint32_t i;
+    uint64_t ns;
+    
+    type = (argc > 2) ? (scheduler_type_t)strtoul(argv[2], NULL, 0) : SCHEDULER_CFS;
+    
+    proctab[NULLPROC].pstate = PR_CURR;
+    proctab[NULLPROC].pprio = PRIORITY_IDLE;
+    
+    sim_workload_mixed(jobs, SIM_MAX_JOBS, 1);
+    
+    sched_clock_set_source(host_clock_ns);
+    if (sim_run(type, jobs, SIM_MAX_JOBS, SIM_HOST_DEFAULT_TICKS, &result) != OK) {
+        return 1;
+    }
+    
+    sim_print_result(&result);
+    sched_wlat_print();
+    
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (i = 0; i < 1000000; i++) {
+        sched_wlat_wakeup((pid32)(i & 63));
+        sched_wlat_dispatch((pid32)(i & 63), NULLPROC, "bench");
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    
+    ns = (uint64_t)(t1.tv_sec - t0.tv_sec) * 1000000000ULL +
+         (uint64_t)(t1.tv_nsec - t0.tv_nsec);
+    printf("\nwakeup + dispatch: %llu.%02llu ns/event\n",
+           (unsigned long long)(ns / 1000000),
+           (unsigned long long)(ns % 1000000 / 10000));
+    
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    static sim_job_t jobs[SIM_MAX_JOBS];
+    uint32_t njobs, seed;
+    uint64_t max_ticks;
+    clock_t start;
+    double elapsed;
+    
+    if (argc > 1 && strcmp(argv[1], "bench") == 0) {
+        return host_bench(argc, argv);
+    }
+    
+    if (argc > 1 && strcmp(argv[1], "dispatch") == 0) {
+        return host_dispatch(argc, argv);
+    }
+    
+    if (argc > 1 && strcmp(argv[1], "timers") == 0) {
+        return host_timers(argc, argv);
+    }
+    
+    if (argc > 1 && strcmp(argv[1], "ready") == 0) {
+        return host_ready(argc, argv);
+    }
+    
+    if (argc > 1 && strcmp(argv[1], "prof") == 0) {
+        return host_prof(argc, argv);
+    }
+    
+    if (argc > 1 && strcmp(argv[1], "classes") == 0) {
+        return host_classes(argc, argv);
+    }
+    
+    if (argc > 1 && strcmp(argv[1], "smp") == 0) {
+        return host_smp(argc, argv);
+    }
+    
+    if (argc > 1 && strcmp(argv[1], "scale") == 0) {
+        return host_scale(argc, argv);
+    }
+    
+    if (argc > 1 && strcmp(argv[1], "race") == 0) {
+        return host_race(argc, argv);
+    }
+    if (argc > 1 && strcmp(argv[1], "bw") == 0) {
+        return host_bw(argc, argv);
+    }
+    
+    if (argc > 1 && strcmp(argv[1], "idle") == 0) {
+        return host_idle(argc, argv);
+    }
+    
+    if (argc > 1 && strcmp(argv[1], "tune") == 0) {
+        return host_tune(argc, argv);
+    }
+    
+    if (argc > 1 && strcmp(argv[1], "gang") == 0) {
+        return host_gang(argc, argv);
+    }
+    
+    if (argc > 1 && strcmp(argv[1], "trace") == 0) {
+        return host_trace(argc, argv);
+    }
+    
+    if (argc > 1 && strcmp(argv[1], "wlat") == 0) {
+        return host_wlat(argc, argv);
+    }
+    
+    njobs = (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 0) : SIM_MAX_JOBS;
+    seed = (argc > 2) ? (uint32_t)strtoul(argv[2], NULL, 0) : 1;
+    max_ticks = (argc > 3) ? strtoull(argv[3], NULL, 0) : SIM_HOST_DEFAULT_TICKS;
+    
+    if (njobs == 0 || njobs > SIM_MAX_JOBS) {
+        njobs = SIM_MAX_JOBS;
+    }
+    
+    proctab[NULLPROC].pstate = PR_CURR;
+    proctab[NULLPROC].pprio = PRIORITY_IDLE;
+    
+    sim_workload_mixed(jobs, njobs, seed);
+    
+    start = clock();
+    sim_compare(jobs, njobs, max_ticks);
+    elapsed = (double)(clock() - start) / CLOCKS_PER_SEC;
+    
+    printf("\nSimulated %u jobs under 6 policies in %.3f s\n", njobs, elapsed);
+    
+    return 0;
+}
+
+#endif
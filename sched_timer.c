@@ -0,0 +1,377 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "sched_timer.h"
+#include "scheduler.h"
+#include "../include/kernel.h"
+
+typedef struct timer_list {
+    sched_timer_t   *head;
+    sched_timer_t  **tail;
+} timer_list_t;
+
+static timer_list_t timer_slots[SCHED_TIMER_LEVELS][SCHED_TIMER_SLOTS];
+
+static uint64_t timer_occupied[SCHED_TIMER_LEVELS];
+
+static timer_list_t timer_expired;
+
+static sched_timer_stats_t timer_stats;
+
+static timer_list_t *timer_list_of(sched_timer_t *timer) {
+    if (timer->level == SCHED_TIMER_LEVELS) {
+        return &timer_expired;
+    }
+    
+    return &timer_slots[timer->level][timer->slot];
+}
+
+static void timer_append(timer_list_t *list, sched_timer_t *timer) {
+    if (list->head == NULL) {
+        list->tail = &list->head;
+    }
+    
+    timer->next = NULL;
+    timer->pprev = list->tail;
+    *list->tail = timer;
+    list->tail = &timer->next;
+}
+
+static sched_timer_t *timer_take(timer_list_t *list) {
+    sched_timer_t *head;
+    
+    head = list->head;
+    list->head = NULL;
+    list->tail = &list->head;
+    
+    return head;
+}
+
+static void timer_unlink(sched_timer_t *timer) {
+    timer_list_t *list;
+    
+    list = timer_list_of(timer);
+    if (list->tail == &timer->next) {
+        list->tail = timer->pprev;
+    }
+    
+    *timer->pprev = timer->next;
+    if (timer->next != NULL) {
+        timer->next->pprev = timer->pprev;
+    }
+    
+    if (timer->level < SCHED_TIMER_LEVELS && list->head == NULL) {
+        timer_occupied[timer->level] &= ~(1ULL << timer->slot);
+    }
+    
+    timer->next = NULL;
+    timer->pprev = NULL;
+}
+
+static void timer_place(sched_timer_t *timer) {
+    uint64_t delta, expires;
+    uint32_t level;
+    
+    if (timer->expires <= timer_stats.now) {
+        timer->level = SCHED_TIMER_LEVELS;
+        timer->slot = 0;
+        timer_append(&timer_expired, timer);
+        return;
+    }
+    
+    expires = timer->expires;
+    delta = expires - timer_stats.now;
+    if (delta > SCHED_TIMER_HORIZON) {
+        expires = timer_stats.now + SCHED_TIMER_HORIZON;
+        delta = SCHED_TIMER_HORIZON;
+    }
+    
+    for (level = 0; level < SCHED_TIMER_LEVELS - 1; level++) {
+        if (delta < (1ULL << (SCHED_TIMER_BITS * (level + 1)))) {
+            break;
+        }
+    }
+    
+    timer->level = (uint8_t)level;
+    timer->slot = (uint8_t)((expires >> (SCHED_TIMER_BITS * level)) & SCHED_TIMER_MASK);
+    
+    timer_append(&timer_slots[level][timer->slot], timer);
+    timer_occupied[level] |= 1ULL << timer->slot;
+}
+
+static void timer_cascade(uint32_t level, uint32_t slot) {
+    sched_timer_t *timer, *next;
+    
+    timer = timer_take(&timer_slots[level][slot]);
+    timer_occupied[level] &= ~(1ULL << slot);
+    
+    while (timer != NULL) {
+        next = timer->next;
+        timer_place(timer);
+        if (level > 0) {
+            timer_stats.cascaded++;
+        }
+        timer = next;
+    }
+}
+
+static uint32_t timer_run_expired(void) {
+    sched_timer_t *timer;
+    uint32_t fired = 0;
+    
+    while ((timer = timer_expired.head) != NULL) {
+        timer_unlink(timer);
+        timer_stats.pending--;
+        timer_stats.fired++;
+        fired++;
+        timer->fn(timer->arg);
+    }
+    
+    return fired;
+}
+
+static uint32_t timer_first_slot(uint64_t occupied, uint32_t from) {
+    uint64_t rotated;
+    
+    rotated = (occupied >> from) | ((from != 0) ? occupied << (SCHED_TIMER_SLOTS - from) : 0);
+    
+    return (from + (uint32_t)__builtin_ctzll(rotated)) & SCHED_TIMER_MASK;
+}
+
+static void timer_detach(sched_timer_t *timer) {
+    sched_timer_t *next;
+    
+    while (timer != NULL) {
+        next = timer->next;
+        timer->next = NULL;
+        timer->pprev = NULL;
+        timer = next;
+    }
+}
+
+void sched_timer_init(uint64_t now) {
+    uint32_t level, slot;
+    intmask mask;
+    
+    mask = disable();
+    
+    for (level = 0; level < SCHED_TIMER_LEVELS; level++) {
+        for (slot = 0; slot < SCHED_TIMER_SLOTS; slot++) {
+            timer_detach(timer_take(&timer_slots[level][slot]));
+        }
+        timer_occupied[level] = 0;
+    }
+    
+    timer_detach(timer_take(&timer_expired));
+    memset(&timer_stats, 0, sizeof(timer_stats));
+    timer_stats.now = now;
+    
+    restore(mask);
+}
+
+void sched_timer_setup(sched_timer_t *timer, sched_timer_fn_t fn, void *arg) {
+    if (timer == NULL) {
+        return;
+    }
+    
+    timer->next = NULL;
+    timer->pprev = NULL;
+    timer->expires = 0;
+    timer->fn = fn;
+    timer->arg = arg;
+    timer->level = 0;
+    timer->slot = 0;
+}
+
+void sched_timer_arm(sched_timer_t *timer, uint64_t expires) {
+    intmask mask;
+    
+    if (timer == NULL || timer->fn == NULL) {
+        return;
+    }
+    
+    mask = disable();
+    
+    if (timer->pprev != NULL) {
+        timer_unlink(timer);
+    } else {
+        timer_stats.pending++;
+    }
+    
+    timer->expires = expires;
+    timer_place(timer);
+    timer_stats.armed++;
+    
+    restore(mask);
+}
+
+bool sched_timer_cancel(sched_timer_t *timer) {
+    intmask mask;
+    
+    if (timer == NULL) {
+        return false;
+    }
+    
+    mask = disable();
+    
+    if (timer->pprev == NULL) {
+        restore(mask);
+        return false;
+    }
+    
+    timer_unlink(timer);
+    timer_stats.pending--;
+    timer_stats.cancelled++;
+    
+    restore(mask);
+    
+    return true;
+}
+
+bool sched_timer_pending(const sched_timer_t *timer) {
+    return timer != NULL && timer->pprev != NULL;
+}
+
+uint32_t sched_timer_advance(uint64_t now) {
+    uint64_t tick, boundary;
+    uint32_t fired, level, slot, first;
+    intmask mask;
+    
+    mask = disable();
+    
+    fired = timer_run_expired();
+    
+    while (timer_stats.now < now) {
+        if (timer_stats.pending == 0) {
+            timer_stats.now = now;
+            break;
+        }
+        
+        tick = timer_stats.now + 1;
+        slot = (uint32_t)(tick & SCHED_TIMER_MASK);
+        
+        if (slot != 0) {
+            boundary = tick - slot + SCHED_TIMER_SLOTS;
+            first = (timer_occupied[0] != 0) ? timer_first_slot(timer_occupied[0], slot) : 0;
+            if (first < slot) {
+                tick = boundary;
+            } else {
+                tick += first - slot;
+            }
+            if (tick > now) {
+                timer_stats.now = now;
+                break;
+            }
+        }
+        
+        timer_stats.now = tick;
+        
+        for (level = 1; level < SCHED_TIMER_LEVELS; level++) {
+            if (((tick >> (SCHED_TIMER_BITS * (level - 1))) & SCHED_TIMER_MASK) != 0) {
+                break;
+            }
+        }
+        while (--level > 0) {
+            timer_cascade(level, (uint32_t)((tick >> (SCHED_TIMER_BITS * level)) &
+                                            SCHED_TIMER_MASK));
+        }
+        
+        timer_cascade(0, (uint32_t)(tick & SCHED_TIMER_MASK));
+        fired += timer_run_expired();
+    }
+    
+    restore(mask);
+    
+    return fired;
+}
+
+uint64_t sched_timer_now(void) {
+    return timer_stats.now;
+}
+
+uint64_t sched_timer_next(void) {
+    sched_timer_t *timer;
+    uint64_t next, base, occupied, found, block;
+    uint32_t level, slot, from, shift;
+    intmask mask;
+    
+    mask = disable();
+    
+    if (timer_expired.head != NULL) {
+        restore(mask);
+        return timer_stats.now;
+    }
+    
+    next = SCHED_NO_EVENT;
+    
+    for (level = 0; level < SCHED_TIMER_LEVELS; level++) {
+        shift = SCHED_TIMER_BITS * level;
+        base = timer_stats.now >> shift;
+        from = (uint32_t)((base + 1) & SCHED_TIMER_MASK);
+        occupied = timer_occupied[level];
+    
+        while (occupied != 0) {
+            slot = timer_first_slot(occupied, from);
+            block = base + 1 + ((slot - from) & SCHED_TIMER_MASK);
+    
+            if (level == 0) {
+                next = block;
+                break;
+            }
+    
+            found = SCHED_NO_EVENT;
+            for (timer = timer_slots[level][slot].head; timer != NULL; timer = timer->next) {
+                if (timer->expires < found) {
+                    found = timer->expires;
+                }
+            }
+            if (found < next) {
+                next = found;
+            }
+    
+            if (found < ((block + 1) << shift)) {
+                break;
+            }
+            occupied &= ~(1ULL << slot);
+        }
+    }
+    
+    restore(mask);
+    
+    return next;
+}
+
+void sched_timer_get_stats(sched_timer_stats_t *stats) {
+    intmask mask;
+    
+    if (stats == NULL) {
+        return;
+    }
+    
+    mask = disable();
+    *stats = timer_stats;
+    restore(mask);
+}
+
+void sched_timer_print(void) {
+    sched_timer_stats_t stats;
+    uint32_t level;
+    
+    sched_timer_get_stats(&stats);
+    
+    kprintf("\n=== Timer Wheel ===\n");
+    kprintf("Now: %llu  Pending: %u  Next: ", stats.now, stats.pending);
+    if (stats.pending > 0) {
+        kprintf("%llu\n", sched_timer_next());
+    } else {
+        kprintf("none\n");
+    }
+    kprintf("Armed: %llu  Cancelled: %llu  Fired: %llu  Cascaded: %llu\n",
+            stats.armed, stats.cancelled, stats.fired, stats.cascaded);
+    
+    for (level = 0; level < SCHED_TIMER_LEVELS; level++) {
+        kprintf("Level %u: %2u of %u slots occupied, %llu ticks per slot\n",
+                level, (uint32_t)__builtin_popcountll(timer_occupied[level]),
+                SCHED_TIMER_SLOTS, 1ULL << (SCHED_TIMER_BITS * level));
+    }
+}
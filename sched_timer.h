@@ -0,0 +1,56 @@
+#ifndef _SCHED_TIMER_H_
+#define _SCHED_TIMER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "scheduler.h"
+
+#define SCHED_TIMER_BITS        6
+#define SCHED_TIMER_SLOTS       (1 << SCHED_TIMER_BITS)
+#define SCHED_TIMER_MASK        (SCHED_TIMER_SLOTS - 1)
+#define SCHED_TIMER_LEVELS      4
+#define SCHED_TIMER_HORIZON     ((uint64_t)(SCHED_TIMER_SLOTS - 1) << \
+                                 (SCHED_TIMER_BITS * (SCHED_TIMER_LEVELS - 1)))
+
+typedef void (*sched_timer_fn_t)(void *arg);
+
+typedef struct sched_timer {
+    struct sched_timer  *next;
+    struct sched_timer **pprev;
+    uint64_t             expires;
+    sched_timer_fn_t     fn;
+    void                *arg;
+    uint8_t              level;
+    uint8_t              slot;
+} sched_timer_t;
+
+typedef struct sched_timer_stats {
+    uint64_t    now;
+    uint32_t    pending;
+    uint64_t    armed;
+    uint64_t    cancelled;
+    uint64_t    fired;
+    uint64_t    cascaded;
+} sched_timer_stats_t;
+
+void sched_timer_init(uint64_t now);
+
+void sched_timer_setup(sched_timer_t *timer, sched_timer_fn_t fn, void *arg);
+
+void sched_timer_arm(sched_timer_t *timer, uint64_t expires);
+
+bool sched_timer_cancel(sched_timer_t *timer);
+
+bool sched_timer_pending(const sched_timer_t *timer);
+
+uint32_t sched_timer_advance(uint64_t now);
+
+uint64_t sched_timer_now(void);
+
+uint64_t sched_timer_next(void);
+
+void sched_timer_get_stats(sched_timer_stats_t *stats);
+
+void sched_timer_print(void);
+
+#endif
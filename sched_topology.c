@@ -0,0 +1,103 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "sched_topology.h"
+#include "scheduler.h"
+#include "../include/kernel.h"
+
+static sched_topology_t topology;
+
+static const char *domain_names[SCHED_DOMAIN_NUM] = {
+    "cache", "package", "system"
+};
+
+syscall sched_topology_init(uint32_t cores_per_cache, uint32_t caches_per_package) {
+    uint32_t cpu, other;
+    sched_cpumask_t cache, package;
+    
+    if (cores_per_cache == 0 || caches_per_package == 0) {
+        return SYSERR;
+    }
+    
+    topology.cores_per_cache = cores_per_cache;
+    topology.caches_per_package = caches_per_package;
+    
+    for (cpu = 0; cpu < SCHED_NCPUS; cpu++) {
+        topology.cache_id[cpu] = cpu / cores_per_cache;
+        topology.package_id[cpu] = topology.cache_id[cpu] / caches_per_package;
+    }
+    
+    for (cpu = 0; cpu < SCHED_NCPUS; cpu++) {
+        cache = 0;
+        package = 0;
+        for (other = 0; other < SCHED_NCPUS; other++) {
+            if (topology.cache_id[other] == topology.cache_id[cpu]) {
+                cache |= 1u << other;
+            }
+            if (topology.package_id[other] == topology.package_id[cpu]) {
+                package |= 1u << other;
+            }
+        }
+        topology.span[cpu][SCHED_DOMAIN_CACHE] = cache;
+        topology.span[cpu][SCHED_DOMAIN_PACKAGE] = package;
+        topology.span[cpu][SCHED_DOMAIN_SYSTEM] = SCHED_CPUMASK_ALL;
+    }
+    
+    return OK;
+}
+
+sched_cpumask_t sched_domain_span(uint32_t cpuid, sched_domain_t level) {
+    if (cpuid >= SCHED_NCPUS || level >= SCHED_DOMAIN_NUM) {
+        return 0;
+    }
+    
+    return topology.span[cpuid][level];
+}
+
+sched_domain_t sched_cpu_distance(uint32_t a, uint32_t b) {
+    if (a >= SCHED_NCPUS || b >= SCHED_NCPUS) {
+        return SCHED_DOMAIN_SYSTEM;
+    }
+    
+    if (topology.cache_id[a] == topology.cache_id[b]) {
+        return SCHED_DOMAIN_CACHE;
+    }
+    if (topology.package_id[a] == topology.package_id[b]) {
+        return SCHED_DOMAIN_PACKAGE;
+    }
+    return SCHED_DOMAIN_SYSTEM;
+}
+
+uint32_t sched_cpu_cache(uint32_t cpuid) {
+    if (cpuid >= SCHED_NCPUS) {
+        return 0;
+    }
+    
+    return topology.cache_id[cpuid];
+}
+
+uint32_t sched_cpu_package(uint32_t cpuid) {
+    if (cpuid >= SCHED_NCPUS) {
+        return 0;
+    }
+    
+    return topology.package_id[cpuid];
+}
+
+void sched_topology_print(void) {
+    uint32_t cpu, level;
+    
+    kprintf("\n=== CPU Topology ===\n");
+    kprintf("Cores/Cache: %u  Caches/Package: %u\n",
+            topology.cores_per_cache, topology.caches_per_package);
+    kprintf("CPU  Cache  Package  Spans\n");
+    kprintf("---  -----  -------  -----\n");
+    
+    for (cpu = 0; cpu < SCHED_NCPUS; cpu++) {
+        kprintf("%3u  %5u  %7u ", cpu, topology.cache_id[cpu], topology.package_id[cpu]);
+        for (level = 0; level < SCHED_DOMAIN_NUM; level++) {
+            kprintf(" %s=0x%x", domain_names[level], topology.span[cpu][level]);
+        }
+        kprintf("\n");
+    }
+}
@@ -0,0 +1,38 @@
+#ifndef _SCHED_TOPOLOGY_H_
+#define _SCHED_TOPOLOGY_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "scheduler.h"
+
+#define SCHED_CORES_PER_CACHE       2
+#define SCHED_CACHES_PER_PACKAGE    2
+
+typedef enum {
+    SCHED_DOMAIN_CACHE,
+    SCHED_DOMAIN_PACKAGE,
+    SCHED_DOMAIN_SYSTEM,
+    SCHED_DOMAIN_NUM
+} sched_domain_t;
+
+typedef struct sched_topology {
+    uint32_t        cores_per_cache;
+    uint32_t        caches_per_package;
+    uint32_t        cache_id[SCHED_NCPUS];
+    uint32_t        package_id[SCHED_NCPUS];
+    sched_cpumask_t span[SCHED_NCPUS][SCHED_DOMAIN_NUM];
+} sched_topology_t;
+
+syscall sched_topology_init(uint32_t cores_per_cache, uint32_t caches_per_package);
+
+sched_cpumask_t sched_domain_span(uint32_t cpuid, sched_domain_t level);
+
+sched_domain_t sched_cpu_distance(uint32_t a, uint32_t b);
+
+uint32_t sched_cpu_cache(uint32_t cpuid);
+
+uint32_t sched_cpu_package(uint32_t cpuid);
+
+void sched_topology_print(void);
+
+#endif
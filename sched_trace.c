@@ -0,0 +1,189 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "sched_trace.h"
+#include "scheduler.h"
+#include "../include/kernel.h"
+
+static sched_trace_ring_t trace_rings[SCHED_NCPUS];
+
+static bool trace_enabled = false;
+
+static const char *trace_names[TRACE_NUM_EVENTS] = {
+    "switch", "wakeup", "enqueue", "dequeue", "quantum", "priority", "deadline_miss"
+};
+
+static uint64_t trace_reserve(sched_trace_ring_t *ring) {
+#if defined(__x86_64__)
+    uint64_t slot = 1;
+    
+    __asm__ volatile("xaddq %0, %1" : "+r"(slot), "+m"(ring->head) : : "memory");
+    return slot;
+#else
+    return __atomic_fetch_add(&ring->head, 1, __ATOMIC_RELAXED);
+#endif
+}
+
+void sched_trace_init(void) {
+    uint32_t cpu, i;
+    
+    for (cpu = 0; cpu < SCHED_NCPUS; cpu++) {
+        trace_rings[cpu].head = 0;
+        for (i = 0; i < SCHED_TRACE_SIZE; i++) {
+            trace_rings[cpu].events[i].seq = 0;
+        }
+    }
+}
+
+void sched_trace_enable(bool enable) {
+    __atomic_store_n(&trace_enabled, enable, __ATOMIC_RELEASE);
+}
+
+bool sched_trace_enabled(void) {
+    return __atomic_load_n(&trace_enabled, __ATOMIC_RELAXED);
+}
+
+void sched_trace_emit(sched_trace_type_t type, pid32 pid, uint32_t arg) {
+    sched_trace_ring_t *ring;
+    sched_trace_event_t *event;
+    uint64_t slot;
+    uint32_t cpu;
+    
+    if (!__atomic_load_n(&trace_enabled, __ATOMIC_RELAXED)) {
+        return;
+    }
+    
+    cpu = sched_this_cpu()->id;
+    ring = &trace_rings[cpu];
+    
+    slot = trace_reserve(ring);
+    event = &ring->events[slot & SCHED_TRACE_MASK];
+    
+    __atomic_store_n(&event->seq, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    
+    event->timestamp = sched_clock();
+    event->arg = arg;
+    event->pid = (int16_t)pid;
+    event->type = (uint8_t)type;
+    event->cpu = (uint8_t)cpu;
+    
+    __atomic_store_n(&event->seq, (uint32_t)(slot + 1), __ATOMIC_RELEASE);
+}
+
+void sched_trace_cursor_init(sched_trace_cursor_t *cursor) {
+    uint64_t head;
+    uint32_t cpu;
+    
+    if (cursor == NULL) {
+        return;
+    }
+    
+    for (cpu = 0; cpu < SCHED_NCPUS; cpu++) {
+        head = __atomic_load_n(&trace_rings[cpu].head, __ATOMIC_ACQUIRE);
+        cursor->next[cpu] = (head > SCHED_TRACE_SIZE) ? head - SCHED_TRACE_SIZE : 0;
+    }
+    cursor->lost = 0;
+}
+
+uint32_t sched_trace_read(sched_trace_cursor_t *cursor, uint32_t cpu,
+                          sched_trace_event_t *out, uint32_t max) {
+    sched_trace_ring_t *ring;
+    sched_trace_event_t *event;
+    uint64_t head, next;
+    uint32_t count, seq;
+    
+    if (cursor == NULL || out == NULL || cpu >= SCHED_NCPUS) {
+        return 0;
+    }
+    
+    ring = &trace_rings[cpu];
+    head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    next = cursor->next[cpu];
+    
+    if (head > SCHED_TRACE_SIZE && next < head - SCHED_TRACE_SIZE) {
+        cursor->lost += head - SCHED_TRACE_SIZE - next;
+        next = head - SCHED_TRACE_SIZE;
+    }
+    
+    count = 0;
+    while (next < head && count < max) {
+        event = &ring->events[next & SCHED_TRACE_MASK];
+    
+        seq = __atomic_load_n(&event->seq, __ATOMIC_ACQUIRE);
+        out[count] = *event;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    
+        if (seq != (uint32_t)(next + 1) ||
+            __atomic_load_n(&event->seq, __ATOMIC_RELAXED) != seq) {
+            if (seq != 0 && seq > (uint32_t)(next + 1)) {
+                cursor->lost++;
+                next++;
+                continue;
+            }
+            break;
+        }
+    
+        out[count].seq = seq;
+        count++;
+        next++;
+    }
+    
+    cursor->next[cpu] = next;
+    
+    return count;
+}
+
+const char *sched_trace_name(uint8_t type) {
+    if (type >= TRACE_NUM_EVENTS) {
+        return "unknown";
+    }
+    
+    return trace_names[type];
+}
+
+void sched_trace_decode(const sched_trace_event_t *event) {
+    if (event == NULL) {
+        return;
+    }
+    
+    switch (event->type) {
+        case TRACE_SWITCH:
+            kprintf("%14llu  cpu%u  %-13s  %d -> %d\n", event->timestamp,
+                    event->cpu, sched_trace_name(event->type),
+                    (int32_t)event->arg, event->pid);
+            break;
+    
+        case TRACE_PRIORITY:
+            kprintf("%14llu  cpu%u  %-13s  pid %d  %u -> %u\n", event->timestamp,
+                    event->cpu, sched_trace_name(event->type), event->pid,
+                    event->arg >> 16, event->arg & 0xFFFF);
+            break;
+    
+        default:
+            kprintf("%14llu  cpu%u  %-13s  pid %d  arg %u\n", event->timestamp,
+                    event->cpu, sched_trace_name(event->type), event->pid,
+                    event->arg);
+            break;
+    }
+}
+
+void sched_trace_dump(void) {
+    sched_trace_cursor_t cursor;
+    sched_trace_event_t batch[32];
+    uint32_t cpu, count, i;
+    
+    sched_trace_cursor_init(&cursor);
+    
+    kprintf("\n=== Scheduler Trace ===\n");
+    
+    for (cpu = 0; cpu < SCHED_NCPUS; cpu++) {
+        while ((count = sched_trace_read(&cursor, cpu, batch, 32)) > 0) {
+            for (i = 0; i < count; i++) {
+                sched_trace_decode(&batch[i]);
+            }
+        }
+    }
+    
+    kprintf("Lost: %llu\n", cursor.lost);
+}
@@ -0,0 +1,60 @@
+#ifndef _SCHED_TRACE_H_
+#define _SCHED_TRACE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "scheduler.h"
+
+#define SCHED_TRACE_SIZE        1024
+#define SCHED_TRACE_MASK        (SCHED_TRACE_SIZE - 1)
+
+typedef enum {
+    TRACE_SWITCH,
+    TRACE_WAKEUP,
+    TRACE_ENQUEUE,
+    TRACE_DEQUEUE,
+    TRACE_QUANTUM,
+    TRACE_PRIORITY,
+    TRACE_DEADLINE_MISS,
+    TRACE_NUM_EVENTS
+} sched_trace_type_t;
+
+typedef struct sched_trace_event {
+    uint64_t timestamp;
+    uint32_t seq;
+    uint32_t arg;
+    int16_t  pid;
+    uint8_t  type;
+    uint8_t  cpu;
+} sched_trace_event_t;
+
+typedef struct sched_trace_ring {
+    uint64_t head;
+    sched_trace_event_t events[SCHED_TRACE_SIZE];
+} sched_trace_ring_t;
+
+typedef struct sched_trace_cursor {
+    uint64_t next[SCHED_NCPUS];
+    uint64_t lost;
+} sched_trace_cursor_t;
+
+void sched_trace_init(void);
+
+void sched_trace_enable(bool enable);
+
+bool sched_trace_enabled(void);
+
+void sched_trace_emit(sched_trace_type_t type, pid32 pid, uint32_t arg);
+
+void sched_trace_cursor_init(sched_trace_cursor_t *cursor);
+
+uint32_t sched_trace_read(sched_trace_cursor_t *cursor, uint32_t cpu,
+                          sched_trace_event_t *out, uint32_t max);
+
+const char *sched_trace_name(uint8_t type);
+
+void sched_trace_decode(const sched_trace_event_t *event);
+
+void sched_trace_dump(void);
+
+#endif
@@ -0,0 +1,297 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "sched_tunables.h"
+#include "scheduler.h"
+#include "round_robin.h"
+#include "priority.h"
+#include "multilevel_queue.h"
+#include "lottery.h"
+#include "cfs.h"
+#include "../include/kernel.h"
+
+static void tunable_prio_aging(uint32_t value) {
+    priority_aging_enable(value != 0);
+}
+
+static void tunable_lottery_compensation(uint32_t value) {
+    lottery_compensation_enable(value != 0);
+}
+
+static const sched_tunable_t tunables[SCHED_NUM_TUNABLES] = {
+    [SCHED_TUN_RR_MAX_QUANTUM] = {
+        "rr_max_quantum", SCHED_TUNABLE_TICKS,
+        RR_MAX_QUANTUM, RR_MIN_QUANTUM, MAX_QUANTUM,
+        round_robin_set_max_quantum
+    },
+    [SCHED_TUN_QUANTUM] = {
+        "quantum", SCHED_TUNABLE_TICKS,
+        DEFAULT_QUANTUM, MIN_QUANTUM, MAX_QUANTUM,
+        sched_set_quantum
+    },
+    [SCHED_TUN_MLFQ_BOOST_INTERVAL] = {
+        "mlfq_boost_interval", SCHED_TUNABLE_TICKS,
+        MLFQ_BOOST_INTERVAL, 1, UINT32_MAX,
+        mlfq_set_boost_interval
+    },
+    [SCHED_TUN_CFS_TARGET_LATENCY] = {
+        "cfs_target_latency", SCHED_TUNABLE_TICKS,
+        CFS_TARGET_LATENCY, 1, MAX_QUANTUM,
+        cfs_set_target_latency
+    },
+    [SCHED_TUN_CFS_MIN_GRANULARITY] = {
+        "cfs_min_granularity", SCHED_TUNABLE_TICKS,
+        CFS_MIN_GRANULARITY, 1, MAX_QUANTUM,
+        cfs_set_min_granularity
+    },
+    [SCHED_TUN_PRIO_AGING] = {
+        "prio_aging", SCHED_TUNABLE_BOOL,
+        PRIO_AGING_ENABLED, 0, 1,
+        tunable_prio_aging
+    },
+    [SCHED_TUN_PRIO_AGING_INTERVAL] = {
+        "prio_aging_interval", SCHED_TUNABLE_TICKS,
+        PRIO_AGING_INTERVAL, 1, UINT32_MAX,
+        priority_set_aging_interval
+    },
+    [SCHED_TUN_LOTTERY_TICKETS] = {
+        "lottery_default_tickets", SCHED_TUNABLE_COUNT,
+        LOTTERY_DEFAULT_TICKETS, LOTTERY_MIN_TICKETS, LOTTERY_MAX_TICKETS,
+        lottery_set_default_tickets
+    },
+    [SCHED_TUN_LOTTERY_COMPENSATION] = {
+        "lottery_compensation", SCHED_TUNABLE_BOOL,
+        LOTTERY_COMPENSATION_ENABLED, 0, 1,
+        tunable_lottery_compensation
+    },
+};
+
+static const char *tunable_types[] = { "ticks", "count", "bool" };
+
+static uint32_t tunable_values[SCHED_NUM_TUNABLES];
+
+static uint32_t tunable_seq = 0;
+
+#if SCHED_NCPUS > 1
+static uint32_t tunable_lock = 0;
+#endif
+
+static bool tunables_ready = false;
+
+static void tunables_write_begin(void) {
+#if SCHED_NCPUS > 1
+    while (__atomic_exchange_n(&tunable_lock, 1, __ATOMIC_ACQUIRE) != 0) {
+        while (__atomic_load_n(&tunable_lock, __ATOMIC_RELAXED) != 0) {
+        }
+    }
+#endif
+    
+    __atomic_store_n(&tunable_seq, tunable_seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static void tunables_write_end(void) {
+    __atomic_store_n(&tunable_seq, tunable_seq + 1, __ATOMIC_RELEASE);
+    
+#if SCHED_NCPUS > 1
+    __atomic_store_n(&tunable_lock, 0, __ATOMIC_RELEASE);
+#endif
+}
+
+static bool tunables_consistent(const uint32_t *values) {
+    return values[SCHED_TUN_CFS_MIN_GRANULARITY] <= values[SCHED_TUN_CFS_TARGET_LATENCY];
+}
+
+void sched_tunables_init(void) {
+    uint32_t i;
+    
+    if (tunables_ready) {
+        return;
+    }
+    
+    for (i = 0; i < SCHED_NUM_TUNABLES; i++) {
+        tunable_values[i] = tunables[i].def;
+    }
+    tunables_ready = true;
+}
+
+void sched_tunables_sync(void) {
+    intmask mask;
+    uint32_t i;
+    
+    mask = disable();
+    
+    sched_tunables_init();
+    
+    tunables_write_begin();
+    for (i = 0; i < SCHED_NUM_TUNABLES; i++) {
+        tunables[i].apply(tunable_values[i]);
+    }
+    tunables_write_end();
+    
+    restore(mask);
+}
+
+int32_t sched_tunable_lookup(const char *name) {
+    uint32_t i;
+    
+    if (name == NULL) {
+        return SYSERR;
+    }
+    
+    for (i = 0; i < SCHED_NUM_TUNABLES; i++) {
+        if (strcmp(tunables[i].name, name) == 0) {
+            return (int32_t)i;
+        }
+    }
+    
+    return SYSERR;
+}
+
+const sched_tunable_t *sched_tunable_info(sched_tunable_id_t id) {
+    if ((uint32_t)id >= SCHED_NUM_TUNABLES) {
+        return NULL;
+    }
+    
+    return &tunables[id];
+}
+
+uint32_t sched_tunable_get(sched_tunable_id_t id) {
+    if ((uint32_t)id >= SCHED_NUM_TUNABLES) {
+        return 0;
+    }
+    
+    sched_tunables_init();
+    
+    return __atomic_load_n(&tunable_values[id], __ATOMIC_RELAXED);
+}
+
+syscall sched_tunable_set(sched_tunable_id_t id, uint32_t value) {
+    sched_tunable_update_t update;
+    
+    update.id = id;
+    update.value = value;
+    
+    return sched_tunables_apply(&update, 1);
+}
+
+syscall sched_tunable_set_name(const char *name, uint32_t value) {
+    int32_t id;
+    
+    id = sched_tunable_lookup(name);
+    if (id == SYSERR) {
+        return SYSERR;
+    }
+    
+    return sched_tunable_set((sched_tunable_id_t)id, value);
+}
+
+syscall sched_tunables_apply(const sched_tunable_update_t *updates, uint32_t count) {
+    uint32_t staged[SCHED_NUM_TUNABLES];
+    bool dirty[SCHED_NUM_TUNABLES];
+    const sched_tunable_t *tunable;
+    intmask mask;
+    uint32_t i;
+    
+    if (updates == NULL || count == 0 || count > SCHED_TUNABLES_MAX_BATCH) {
+        return SYSERR;
+    }
+    
+    mask = disable();
+    
+    sched_tunables_init();
+    
+    for (i = 0; i < SCHED_NUM_TUNABLES; i++) {
+        staged[i] = tunable_values[i];
+        dirty[i] = false;
+    }
+    
+    for (i = 0; i < count; i++) {
+        if ((uint32_t)updates[i].id >= SCHED_NUM_TUNABLES) {
+            restore(mask);
+            return SYSERR;
+        }
+    
+        tunable = &tunables[updates[i].id];
+        if (updates[i].value < tunable->min || updates[i].value > tunable->max) {
+            restore(mask);
+            return SYSERR;
+        }
+    
+        staged[updates[i].id] = updates[i].value;
+        dirty[updates[i].id] = true;
+    }
+    
+    if (!tunables_consistent(staged)) {
+        restore(mask);
+        return SYSERR;
+    }
+    
+    tunables_write_begin();
+    for (i = 0; i < SCHED_NUM_TUNABLES; i++) {
+        if (dirty[i] && staged[i] != tunable_values[i]) {
+            __atomic_store_n(&tunable_values[i], staged[i], __ATOMIC_RELAXED);
+            tunables[i].apply(staged[i]);
+        }
+    }
+    tunables_write_end();
+    
+    restore(mask);
+    
+    return OK;
+}
+
+uint32_t sched_tunables_snapshot(uint32_t *values) {
+    uint32_t seq, i;
+    
+    if (values == NULL) {
+        return 0;
+    }
+    
+    sched_tunables_init();
+    
+    do {
+        while ((seq = __atomic_load_n(&tunable_seq, __ATOMIC_ACQUIRE)) & 1) {
+        }
+        for (i = 0; i < SCHED_NUM_TUNABLES; i++) {
+            values[i] = __atomic_load_n(&tunable_values[i], __ATOMIC_RELAXED);
+        }
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while (__atomic_load_n(&tunable_seq, __ATOMIC_RELAXED) != seq);
+    
+    return seq >> 1;
+}
+
+void sched_tunables_reset(void) {
+    intmask mask;
+    uint32_t i;
+    
+    mask = disable();
+    
+    tunables_write_begin();
+    for (i = 0; i < SCHED_NUM_TUNABLES; i++) {
+        tunable_values[i] = tunables[i].def;
+        tunables[i].apply(tunables[i].def);
+    }
+    tunables_ready = true;
+    tunables_write_end();
+    
+    restore(mask);
+}
+
+void sched_tunables_print(void) {
+    uint32_t values[SCHED_NUM_TUNABLES];
+    uint32_t i, generation;
+    
+    generation = sched_tunables_snapshot(values);
+    
+    kprintf("\n=== Scheduler Tunables (generation %u) ===\n", generation);
+    kprintf("Name                     Type   Value       Default     Range\n");
+    kprintf("-----------------------  -----  ----------  ----------  ---------------------\n");
+    
+    for (i = 0; i < SCHED_NUM_TUNABLES; i++) {
+        kprintf("%-23s  %-5s  %10u  %10u  %u..%u\n",
+                tunables[i].name, tunable_types[tunables[i].type], values[i],
+                tunables[i].def, tunables[i].min, tunables[i].max);
+    }
+}
@@ -0,0 +1,65 @@
+#ifndef _SCHED_TUNABLES_H_
+#define _SCHED_TUNABLES_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "scheduler.h"
+
+#define SCHED_TUNABLES_MAX_BATCH    16
+
+typedef enum {
+    SCHED_TUNABLE_TICKS,
+    SCHED_TUNABLE_COUNT,
+    SCHED_TUNABLE_BOOL
+} sched_tunable_type_t;
+
+typedef enum {
+    SCHED_TUN_RR_MAX_QUANTUM,
+    SCHED_TUN_QUANTUM,
+    SCHED_TUN_MLFQ_BOOST_INTERVAL,
+    SCHED_TUN_CFS_TARGET_LATENCY,
+    SCHED_TUN_CFS_MIN_GRANULARITY,
+    SCHED_TUN_PRIO_AGING,
+    SCHED_TUN_PRIO_AGING_INTERVAL,
+    SCHED_TUN_LOTTERY_TICKETS,
+    SCHED_TUN_LOTTERY_COMPENSATION,
+    SCHED_NUM_TUNABLES
+} sched_tunable_id_t;
+
+typedef struct sched_tunable {
+    const char           *name;
+    sched_tunable_type_t  type;
+    uint32_t              def;
+    uint32_t              min;
+    uint32_t              max;
+    void                (*apply)(uint32_t value);
+} sched_tunable_t;
+
+typedef struct sched_tunable_update {
+    sched_tunable_id_t    id;
+    uint32_t              value;
+} sched_tunable_update_t;
+
+void sched_tunables_init(void);
+
+void sched_tunables_sync(void);
+
+int32_t sched_tunable_lookup(const char *name);
+
+const sched_tunable_t *sched_tunable_info(sched_tunable_id_t id);
+
+uint32_t sched_tunable_get(sched_tunable_id_t id);
+
+syscall sched_tunable_set(sched_tunable_id_t id, uint32_t value);
+
+syscall sched_tunable_set_name(const char *name, uint32_t value);
+
+syscall sched_tunables_apply(const sched_tunable_update_t *updates, uint32_t count);
+
+uint32_t sched_tunables_snapshot(uint32_t *values);
+
+void sched_tunables_reset(void);
+
+void sched_tunables_print(void);
+
+#endif
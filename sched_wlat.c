@@ -0,0 +1,279 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include "sched_wlat.h"
+#include "scheduler.h"
+#include "../include/kernel.h"
+
+static sched_wlat_event_t wlat_ring[SCHED_WLAT_HISTORY];
+static uint64_t wlat_head;
+
+static bool wlat_enabled = true;
+
+static uint64_t wake_ns[NPROC];
+static bool wake_pending[NPROC];
+static uint64_t proc_max[NPROC];
+
+static sched_wlat_policy_t wlat_policies[SCHED_WLAT_POLICIES];
+
+static sched_wlat_worst_t wlat_worst;
+static uint64_t worst_ns;
+static bool worst_lock;
+
+static const char *wlat_names[WLAT_NUM_EVENTS] = {
+    "wakeup", "dispatch"
+};
+
+static void wlat_log(sched_wlat_type_t type, pid32 pid, uint32_t arg, uint64_t now) {
+    sched_wlat_event_t *event;
+    uint64_t slot;
+    
+    slot = __atomic_fetch_add(&wlat_head, 1, __ATOMIC_RELAXED);
+    event = &wlat_ring[slot & SCHED_WLAT_MASK];
+    
+    __atomic_store_n(&event->seq, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    
+    event->timestamp = now;
+    event->arg = arg;
+    event->pid = (int16_t)pid;
+    event->type = (uint8_t)type;
+    event->cpu = (uint8_t)sched_this_cpu()->id;
+    
+    __atomic_store_n(&event->seq, (uint32_t)(slot + 1), __ATOMIC_RELEASE);
+}
+
+static sched_wlat_policy_t *wlat_policy(const char *name) {
+    const char *expected;
+    uint32_t i;
+    
+    for (i = 0; i < SCHED_WLAT_POLICIES; i++) {
+        expected = __atomic_load_n(&wlat_policies[i].name, __ATOMIC_ACQUIRE);
+        if (expected == name) {
+            return &wlat_policies[i];
+        }
+        if (expected == NULL) {
+            if (__atomic_compare_exchange_n(&wlat_policies[i].name, &expected, name, false,
+                                            __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE) ||
+                expected == name) {
+                return &wlat_policies[i];
+            }
+        }
+    }
+    
+    return NULL;
+}
+
+static void wlat_capture(pid32 pid, const char *policy, uint64_t woken, uint64_t now) {
+    sched_wlat_event_t *event;
+    uint64_t head, next;
+    uint32_t seq, count;
+    
+    if (__atomic_test_and_set(&worst_lock, __ATOMIC_ACQUIRE)) {
+        return;
+    }
+    
+    if (now - woken <= worst_ns && wlat_worst.nevents > 0) {
+        __atomic_clear(&worst_lock, __ATOMIC_RELEASE);
+        return;
+    }
+    
+    head = __atomic_load_n(&wlat_head, __ATOMIC_ACQUIRE);
+    next = (head > SCHED_WLAT_HISTORY) ? head - SCHED_WLAT_HISTORY : 0;
+    
+    count = 0;
+    for (; next < head; next++) {
+        event = &wlat_ring[next & SCHED_WLAT_MASK];
+        seq = __atomic_load_n(&event->seq, __ATOMIC_ACQUIRE);
+        wlat_worst.events[count] = *event;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    
+        if (seq != (uint32_t)(next + 1) ||
+            __atomic_load_n(&event->seq, __ATOMIC_RELAXED) != seq) {
+            continue;
+        }
+        count++;
+    }
+    
+    wlat_worst.policy = policy;
+    wlat_worst.latency_ns = now - woken;
+    wlat_worst.woken_at = woken;
+    wlat_worst.dispatched_at = now;
+    wlat_worst.pid = pid;
+    wlat_worst.cpu = sched_this_cpu()->id;
+    wlat_worst.nevents = count;
+    __atomic_store_n(&worst_ns, now - woken, __ATOMIC_RELEASE);
+    
+    __atomic_clear(&worst_lock, __ATOMIC_RELEASE);
+}
+
+void sched_wlat_init(void) {
+    sched_wlat_reset();
+    __atomic_store_n(&wlat_enabled, true, __ATOMIC_RELEASE);
+}
+
+void sched_wlat_enable(bool enable) {
+    __atomic_store_n(&wlat_enabled, enable, __ATOMIC_RELEASE);
+}
+
+bool sched_wlat_enabled(void) {
+    return __atomic_load_n(&wlat_enabled, __ATOMIC_RELAXED);
+}
+
+void sched_wlat_wakeup(pid32 pid) {
+    uint64_t now;
+    
+    if (pid < 0 || pid >= NPROC || !__atomic_load_n(&wlat_enabled, __ATOMIC_RELAXED)) {
+        return;
+    }
+    
+    now = sched_clock();
+    wake_ns[pid] = now;
+    __atomic_store_n(&wake_pending[pid], true, __ATOMIC_RELEASE);
+    
+    wlat_log(WLAT_WAKEUP, pid, 0, now);
+}
+
+void sched_wlat_dispatch(pid32 pid, pid32 prev, const char *policy) {
+    sched_wlat_policy_t *slot;
+    uint64_t now, latency, max;
+    
+    if (pid < 0 || pid >= NPROC || !__atomic_load_n(&wlat_enabled, __ATOMIC_RELAXED)) {
+        return;
+    }
+    
+    now = sched_clock();
+    wlat_log(WLAT_DISPATCH, pid, (uint32_t)prev, now);
+    
+    if (!__atomic_exchange_n(&wake_pending[pid], false, __ATOMIC_ACQ_REL)) {
+        return;
+    }
+    
+    latency = now - wake_ns[pid];
+    if (latency > proc_max[pid]) {
+        proc_max[pid] = latency;
+    }
+    
+    slot = wlat_policy(policy != NULL ? policy : "none");
+    if (slot != NULL) {
+        __atomic_add_fetch(&slot->samples, 1, __ATOMIC_RELAXED);
+        __atomic_add_fetch(&slot->total_ns, latency, __ATOMIC_RELAXED);
+        max = __atomic_load_n(&slot->max_ns, __ATOMIC_RELAXED);
+        while (latency > max) {
+            if (__atomic_compare_exchange_n(&slot->max_ns, &max, latency, true,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                slot->max_pid = pid;
+                break;
+            }
+        }
+    }
+    
+    if (latency > __atomic_load_n(&worst_ns, __ATOMIC_ACQUIRE) || wlat_worst.nevents == 0) {
+        wlat_capture(pid, slot != NULL ? slot->name : policy, wake_ns[pid], now);
+    }
+}
+
+uint64_t sched_wlat_max(pid32 pid) {
+    if (pid < 0 || pid >= NPROC) {
+        return 0;
+    }
+    
+    return proc_max[pid];
+}
+
+uint32_t sched_wlat_policies(sched_wlat_policy_t *out, uint32_t max) {
+    uint32_t i, count;
+    
+    if (out == NULL) {
+        return 0;
+    }
+    
+    count = 0;
+    for (i = 0; i < SCHED_WLAT_POLICIES && count < max; i++) {
+        if (__atomic_load_n(&wlat_policies[i].name, __ATOMIC_ACQUIRE) == NULL) {
+            break;
+        }
+        out[count++] = wlat_policies[i];
+    }
+    
+    return count;
+}
+
+bool sched_wlat_worst(sched_wlat_worst_t *out) {
+    bool valid;
+    
+    if (out == NULL) {
+        return false;
+    }
+    
+    while (__atomic_test_and_set(&worst_lock, __ATOMIC_ACQUIRE)) {
+    }
+    
+    valid = wlat_worst.nevents > 0;
+    if (valid) {
+        *out = wlat_worst;
+    }
+    
+    __atomic_clear(&worst_lock, __ATOMIC_RELEASE);
+    
+    return valid;
+}
+
+void sched_wlat_reset(void) {
+    uint32_t i;
+    
+    while (__atomic_test_and_set(&worst_lock, __ATOMIC_ACQUIRE)) {
+    }
+    
+    for (i = 0; i < NPROC; i++) {
+        wake_pending[i] = false;
+        proc_max[i] = 0;
+    }
+    for (i = 0; i < SCHED_WLAT_HISTORY; i++) {
+        wlat_ring[i].seq = 0;
+    }
+    memset(wlat_policies, 0, sizeof(wlat_policies));
+    memset(&wlat_worst, 0, sizeof(wlat_worst));
+    wlat_head = 0;
+    worst_ns = 0;
+    
+    __atomic_clear(&worst_lock, __ATOMIC_RELEASE);
+}
+
+void sched_wlat_print(void) {
+    static sched_wlat_worst_t worst;
+    sched_wlat_policy_t policies[SCHED_WLAT_POLICIES];
+    sched_wlat_event_t *event;
+    uint32_t count, i;
+    
+    kprintf("\n=== Wakeup Latency ===\n");
+    kprintf("%-20s %10s %14s %14s %6s\n", "Policy", "Samples", "Avg(ns)", "Max(ns)", "PID");
+    
+    count = sched_wlat_policies(policies, SCHED_WLAT_POLICIES);
+    for (i = 0; i < count; i++) {
+        kprintf("%-20s %10llu %14llu %14llu %6d\n", policies[i].name, policies[i].samples,
+                policies[i].samples ? policies[i].total_ns / policies[i].samples : 0,
+                policies[i].max_ns, policies[i].max_pid);
+    }
+    
+    if (!sched_wlat_worst(&worst)) {
+        return;
+    }
+    
+    kprintf("Worst: pid %d  %s  cpu%u  %llu ns (woken %llu, ran %llu)\n",
+            worst.pid, worst.policy ? worst.policy : "none", worst.cpu,
+            worst.latency_ns, worst.woken_at, worst.dispatched_at);
+    
+    for (i = 0; i < worst.nevents; i++) {
+        event = &worst.events[i];
+        if (event->type == WLAT_DISPATCH) {
+            kprintf("%14llu  cpu%u  %-8s  %d -> %d\n", event->timestamp, event->cpu,
+                    wlat_names[WLAT_DISPATCH], (int32_t)event->arg, event->pid);
+        } else {
+            kprintf("%14llu  cpu%u  %-8s  pid %d\n", event->timestamp, event->cpu,
+                    event->type < WLAT_NUM_EVENTS ? wlat_names[event->type] : "unknown",
+                    event->pid);
+        }
+    }
+}
@@ -0,0 +1,66 @@
+#ifndef _SCHED_WLAT_H_
+#define _SCHED_WLAT_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "scheduler.h"
+
+#define SCHED_WLAT_HISTORY      64
+#define SCHED_WLAT_MASK         (SCHED_WLAT_HISTORY - 1)
+#define SCHED_WLAT_POLICIES     8
+
+typedef enum {
+    WLAT_WAKEUP,
+    WLAT_DISPATCH,
+    WLAT_NUM_EVENTS
+} sched_wlat_type_t;
+
+typedef struct sched_wlat_event {
+    uint64_t timestamp;
+    uint32_t seq;
+    uint32_t arg;
+    int16_t  pid;
+    uint8_t  type;
+    uint8_t  cpu;
+} sched_wlat_event_t;
+
+typedef struct sched_wlat_policy {
+    const char *name;
+    uint64_t samples;
+    uint64_t total_ns;
+    uint64_t max_ns;
+    pid32    max_pid;
+} sched_wlat_policy_t;
+
+typedef struct sched_wlat_worst {
+    const char *policy;
+    uint64_t latency_ns;
+    uint64_t woken_at;
+    uint64_t dispatched_at;
+    pid32    pid;
+    uint32_t cpu;
+    uint32_t nevents;
+    sched_wlat_event_t events[SCHED_WLAT_HISTORY];
+} sched_wlat_worst_t;
+
+void sched_wlat_init(void);
+
+void sched_wlat_enable(bool enable);
+
+bool sched_wlat_enabled(void);
+
+void sched_wlat_wakeup(pid32 pid);
+
+void sched_wlat_dispatch(pid32 pid, pid32 prev, const char *policy);
+
+uint64_t sched_wlat_max(pid32 pid);
+
+uint32_t sched_wlat_policies(sched_wlat_policy_t *out, uint32_t max);
+
+bool sched_wlat_worst(sched_wlat_worst_t *out);
+
+void sched_wlat_reset(void);
+
+void sched_wlat_print(void);
+
+#endif
@@ -8,6 +8,13 @@
 #include "lottery.h"
 #include "cfs.h"
 #include "realtime.h"
+#include "sched_trace.h"
+#include "sched_topology.h"
+#include "sched_idle.h"
+#include "sched_tunables.h"
+#include "sched_timer.h"
+#include "sched_prof.h"
+#include "sched_wlat.h"
 #include "../include/kernel.h"
 #include "../include/process.h"
 #include "../include/interrupts.h"
@@ -18,16 +25,15 @@ uint32_t sched_policy = DEFAULT_SCHED_POLICY;
 
 sched_stats_t sched_stats;
 
-ready_queue_t ready_queue;
+sched_cpu_t sched_cpus[SCHED_NCPUS];
 
 static ready_node_t node_pool[NPROC];
-static ready_node_t *free_nodes = NULL;
 
 static uint32_t current_quantum = DEFAULT_QUANTUM;
 
-static uint32_t quantum_remaining = DEFAULT_QUANTUM;
+static sched_proc_hot_t proc_hot[NPROC];
 
-static sched_proc_stats_t proc_stats[NPROC];
+static sched_proc_cold_t proc_cold[NPROC];
 
 static sid32 sched_lock;
 
@@ -35,336 +41,2689 @@ volatile bool need_resched = false;
 
 static uint64_t system_ticks = 0;
 
+static sched_clock_source_t clock_source = NULL;
+
+static uint64_t clock_stamp = 0;
+
+static uint64_t clock_last = 0;
+
 static bool sched_initialized = false;
 
+static bool tickless_mode = false;
+
+static pid32 wakeup_head = -1;
+
+static pid32 wakeup_next[NPROC];
+
+static bool wakeup_pending[NPROC];
+
+static uint32_t stats_seq = 0;
+
+static bool classes_enabled = false;
+
+static scheduler_ops_t *class_ops[SCHED_CLASS_NUM];
+
+static uint8_t proc_class[NPROC];
+
+static bool class_runnable[NPROC];
+
+static uint32_t class_nr[SCHED_CLASS_NUM];
+
+static uint32_t class_mask = 0;
+
+static sched_cpumask_t proc_affinity[NPROC];
+
+static int32_t proc_last_cpu[NPROC];
+
+static uint64_t proc_last_ran[NPROC];
+
+static bool balance_enabled = true;
+
+static const uint32_t balance_pct[SCHED_DOMAIN_NUM] = { 110, 125, 150 };
+
+static sched_gang_t gangs[SCHED_MAX_GANGS];
+
+static int32_t proc_gang[NPROC];
+
+static uint32_t proc_gang_idx[NPROC];
+
+static bool gang_runnable[NPROC];
+
+static uint32_t gang_count = 0;
+
+static int32_t gang_slot = -1;
+
+static uint64_t gang_slot_end = 0;
+
+static sched_bw_group_t bw_groups[SCHED_BW_MAX_GROUPS];
+
+static int32_t proc_bw[NPROC];
+
+static int32_t bw_children[SCHED_BW_MAX_GROUPS];
+
+static int32_t bw_sibling_next[SCHED_BW_MAX_GROUPS];
+
+static pid32 bw_runnable[SCHED_BW_MAX_GROUPS];
+
+static pid32 bw_run_next[NPROC];
+
+static pid32 bw_run_prev[NPROC];
+
+static pid32 bw_parked[SCHED_BW_MAX_GROUPS];
+
+static pid32 bw_parked_next[NPROC];
+
+static pid32 bw_parked_prev[NPROC];
+
+static int32_t bw_parked_on[NPROC];
+
+static sched_timer_t bw_timers[SCHED_BW_MAX_GROUPS];
+
+static uint32_t bw_nthrottled = 0;
+
+static sched_timer_t sleep_timers[NPROC];
+
+static bool proc_active[NPROC];
+
+static uint32_t nr_active = 0;
+
+static uint32_t loadavg[3];
+
+static uint64_t loadavg_next = 0;
+
+static const uint32_t loadavg_exp[3] = {
+    SCHED_LOAD_EXP_1, SCHED_LOAD_EXP_5, SCHED_LOAD_EXP_15
+};
+
+static const uint32_t util_decay_table[SCHED_UTIL_HALFLIFE] = {
+    0xffffffff, 0xfa83b2db, 0xf5257d15, 0xefe4b99b, 0xeac0c6e7, 0xe5b906e7, 0xe0ccdeec, 0xdbfbb797,
+    0xd744fcca, 0xd2a81d91, 0xce248c15, 0xc9b9bd86, 0xc5672a11, 0xc12c4cca, 0xbd08a39f, 0xb8fbaf47,
+    0xb504f333, 0xb123f581, 0xad583eea, 0xa9a15ab4, 0xa5fed6a9, 0xa2704303, 0x9ef53260, 0x9b8d39b9,
+    0x9837f051, 0x94f4efa8, 0x91c3d373, 0x8ea4398b, 0x8b95c1e3, 0x88980e80, 0x85aac367, 0x82cd8698
+};
+
+#if SCHED_NCPUS > 1
+static volatile uint32_t stats_lock = 0;
+#endif
+
 extern proc_t proctab[];
 extern pid32 currpid;
 
+static void cpu_lock(sched_cpu_t *cpu) {
+    while (__atomic_exchange_n(&cpu->lock, 1, __ATOMIC_ACQUIRE) != 0) {
+        while (__atomic_load_n(&cpu->lock, __ATOMIC_RELAXED) != 0) {
+        }
+    }
+}
+
+static void cpu_unlock(sched_cpu_t *cpu) {
+    __atomic_store_n(&cpu->lock, 0, __ATOMIC_RELEASE);
+}
+
+static void stats_write_begin(pid32 pid, bool global) {
+#if SCHED_NCPUS > 1
+    while (__atomic_exchange_n(&stats_lock, 1, __ATOMIC_ACQUIRE) != 0) {
+        while (__atomic_load_n(&stats_lock, __ATOMIC_RELAXED) != 0) {
+        }
+    }
+#endif
+    
+    if (global) {
+        __atomic_store_n(&stats_seq, stats_seq + 1, __ATOMIC_RELAXED);
+    }
+    if (pid >= 0 && pid < NPROC) {
+        __atomic_store_n(&proc_hot[pid].seq, proc_hot[pid].seq + 1, __ATOMIC_RELAXED);
+    }
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static void stats_write_end(pid32 pid, bool global) {
+    if (pid >= 0 && pid < NPROC) {
+        __atomic_store_n(&proc_hot[pid].seq, proc_hot[pid].seq + 1, __ATOMIC_RELEASE);
+    }
+    if (global) {
+        __atomic_store_n(&stats_seq, stats_seq + 1, __ATOMIC_RELEASE);
+    }
+    
+#if SCHED_NCPUS > 1
+    __atomic_store_n(&stats_lock, 0, __ATOMIC_RELEASE);
+#endif
+}
+
+static void proc_mark_queued(pid32 pid, uint64_t now) {
+    if (pid < 0 || pid >= NPROC) {
+        return;
+    }
+    
+    stats_write_begin(pid, false);
+    proc_hot[pid].ready_since = now;
+    proc_hot[pid].queued = true;
+    stats_write_end(pid, false);
+}
+
+static void proc_stats_clear(pid32 pid) {
+    uint32_t seq, util, util_stamp;
+    
+    seq = proc_hot[pid].seq;
+    util = proc_hot[pid].util;
+    util_stamp = proc_hot[pid].util_stamp;
+    memset(&proc_hot[pid], 0, sizeof(sched_proc_hot_t));
+    proc_hot[pid].seq = seq;
+    proc_hot[pid].util = util;
+    proc_hot[pid].util_stamp = util_stamp;
+    memset(&proc_cold[pid], 0, sizeof(sched_proc_cold_t));
+}
+
+static uint32_t util_decay(uint32_t value, uint32_t ticks) {
+    if (ticks / SCHED_UTIL_HALFLIFE >= 32) {
+        return 0;
+    }
+    
+    value >>= ticks / SCHED_UTIL_HALFLIFE;
+    if (ticks % SCHED_UTIL_HALFLIFE != 0) {
+        value = (uint32_t)(((uint64_t)value * util_decay_table[ticks % SCHED_UTIL_HALFLIFE]) >> 32);
+    }
+    
+    return value;
+}
+
+static uint32_t util_project(uint32_t util, uint32_t ticks, bool running) {
+    if (ticks == 0) {
+        return util;
+    }
+    
+    util = util_decay(util, ticks);
+    if (running) {
+        util += SCHED_UTIL_SCALE - util_decay(SCHED_UTIL_SCALE, ticks);
+    }
+    
+    return util;
+}
+
+static void util_update(pid32 pid, bool running) {
+    uint32_t now;
+    
+    now = (uint32_t)system_ticks;
+    proc_hot[pid].util = util_project(proc_hot[pid].util, now - proc_hot[pid].util_stamp,
+                                      running);
+    proc_hot[pid].util_stamp = now;
+}
+
+static bool proc_running(pid32 pid) {
+    int32_t cpu;
+    
+    cpu = proc_last_cpu[pid];
+    
+    return cpu >= 0 && cpu < SCHED_NCPUS && sched_cpus[cpu].curr == pid;
+}
+
+static uint32_t stats_read_begin(const uint32_t *seq) {
+    uint32_t value;
+    
+    while ((value = __atomic_load_n(seq, __ATOMIC_ACQUIRE)) & 1) {
+    }
+    
+    return value;
+}
+
+static bool stats_read_retry(const uint32_t *seq, uint32_t value) {
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return __atomic_load_n(seq, __ATOMIC_RELAXED) != value;
+}
+
 static void node_pool_init(void) {
     int i;
     
-    free_nodes = &node_pool[0];
-    for (i = 0; i < NPROC - 1; i++) {
-        node_pool[i].next = &node_pool[i + 1];
+    for (i = 0; i < NPROC; i++) {
+        node_pool[i].next = NULL;
         node_pool[i].prev = NULL;
         node_pool[i].pid = -1;
+        node_pool[i].cpu = 0;
     }
-    node_pool[NPROC - 1].next = NULL;
 }
 
-static ready_node_t *node_alloc(void) {
-    ready_node_t *node;
+static bool node_claim(ready_node_t *node, pid32 pid) {
+    pid32 expected = -1;
+    
+    return __atomic_compare_exchange_n(&node->pid, &expected, pid, false,
+                                       __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+}
+
+static void node_release(ready_node_t *node) {
+    node->next = NULL;
+    node->prev = NULL;
+    __atomic_store_n(&node->pid, -1, __ATOMIC_RELEASE);
+}
+
+static void rq_link_tail(ready_queue_t *rq, ready_node_t *node) {
+    node->next = NULL;
+    node->prev = rq->tail;
     
-    if (free_nodes == NULL) {
-        return NULL;
+    if (rq->tail != NULL) {
+        rq->tail->next = node;
+    } else {
+        rq->head = node;
     }
     
-    node = free_nodes;
-    free_nodes = free_nodes->next;
+    rq->tail = node;
+    rq->count++;
+    rq->load += node->weight;
+}
+
+static bool rq_linked(ready_queue_t *rq, ready_node_t *node) {
+    return node->prev != NULL || rq->head == node;
+}
+
+static void rq_unlink(ready_queue_t *rq, ready_node_t *node) {
+    if (node->prev != NULL) {
+        node->prev->next = node->next;
+    } else {
+        rq->head = node->next;
+    }
     
-    node->next = NULL;
-    node->prev = NULL;
-    node->pid = -1;
-    node->priority = 0;
-    node->time_slice = current_quantum;
-    node->enqueue_time = 0;
+    if (node->next != NULL) {
+        node->next->prev = node->prev;
+    } else {
+        rq->tail = node->prev;
+    }
     
-    return node;
+    rq->count--;
+    rq->load -= node->weight;
 }
 
-static void node_free(ready_node_t *node) {
-    if (node == NULL) {
+static void runnable_inc(void) {
+    uint32_t runnable;
+    
+    runnable = __atomic_add_fetch(&sched_stats.runnable_count, 1,
+                                  __ATOMIC_RELAXED);
+    if (runnable > sched_stats.max_runnable) {
+        sched_stats.max_runnable = runnable;
+    }
+}
+
+static void runnable_dec(void) {
+    __atomic_sub_fetch(&sched_stats.runnable_count, 1, __ATOMIC_RELAXED);
+}
+
+static void bw_link(pid32 *head, pid32 *next, pid32 *prev, pid32 pid) {
+    next[pid] = *head;
+    prev[pid] = -1;
+    if (*head >= 0) {
+        prev[*head] = pid;
+    }
+    *head = pid;
+}
+
+static void bw_unlink(pid32 *head, pid32 *next, pid32 *prev, pid32 pid) {
+    if (prev[pid] >= 0) {
+        next[prev[pid]] = next[pid];
+    } else {
+        *head = next[pid];
+    }
+    if (next[pid] >= 0) {
+        prev[next[pid]] = prev[pid];
+    }
+    next[pid] = -1;
+    prev[pid] = -1;
+}
+
+static void active_set(pid32 pid, bool active) {
+    if (proc_active[pid] == active) {
         return;
     }
     
-    node->next = free_nodes;
-    free_nodes = node;
+    proc_active[pid] = active;
+    if (proc_bw[pid] >= 0) {
+        if (active) {
+            bw_link(&bw_runnable[proc_bw[pid]], bw_run_next, bw_run_prev, pid);
+        } else {
+            bw_unlink(&bw_runnable[proc_bw[pid]], bw_run_next, bw_run_prev, pid);
+        }
+    }
+    if (active) {
+        __atomic_add_fetch(&nr_active, 1, __ATOMIC_RELAXED);
+    } else {
+        __atomic_sub_fetch(&nr_active, 1, __ATOMIC_RELAXED);
+    }
 }
 
-void ready_queue_init(void) {
-    ready_queue.head = NULL;
-    ready_queue.tail = NULL;
-    ready_queue.count = 0;
-    ready_queue.priority = 0;
+static uint32_t loadavg_power(uint32_t x, uint64_t n) {
+    uint32_t result;
     
-    node_pool_init();
+    result = SCHED_LOAD_FIXED_1;
+    while (n > 0) {
+        if (n & 1) {
+            result = (result * x + SCHED_LOAD_FIXED_1 / 2) >> SCHED_LOAD_SHIFT;
+        }
+        x = (x * x + SCHED_LOAD_FIXED_1 / 2) >> SCHED_LOAD_SHIFT;
+        n >>= 1;
+    }
+    
+    return result;
 }
 
-void ready_enqueue(pid32 pid) {
-    ready_node_t *node;
-    intmask mask;
+static void loadavg_fold(uint64_t samples) {
+    uint64_t load;
+    uint32_t active, exp, i;
+    
+    active = __atomic_load_n(&nr_active, __ATOMIC_RELAXED) << SCHED_LOAD_SHIFT;
+    
+    stats_write_begin(-1, true);
+    for (i = 0; i < 3; i++) {
+        exp = (samples == 1) ? loadavg_exp[i] : loadavg_power(loadavg_exp[i], samples);
+        load = (uint64_t)loadavg[i] * exp + (uint64_t)active * (SCHED_LOAD_FIXED_1 - exp);
+        if (active >= loadavg[i]) {
+            load += SCHED_LOAD_FIXED_1 - 1;
+        }
+        loadavg[i] = (uint32_t)(load >> SCHED_LOAD_SHIFT);
+    }
+    stats_write_end(-1, true);
+}
+
+static void loadavg_sample(void) {
+    uint64_t samples;
     
-    if (pid < 0 || pid >= NPROC) {
+    if (system_ticks < loadavg_next) {
         return;
     }
     
-    mask = disable();
+    samples = (system_ticks - loadavg_next) / SCHED_LOAD_FREQ + 1;
+    loadavg_next += samples * SCHED_LOAD_FREQ;
+    loadavg_fold(samples);
+}
+
+static uint32_t task_weight(pid32 pid) {
+    return cfs_nice_to_weight(sched_prio_to_nice(proctab[pid].pprio));
+}
+
+static bool cpu_allowed(pid32 pid, uint32_t cpuid) {
+    return (proc_affinity[pid] & (1u << cpuid)) != 0;
+}
+
+static bool task_cache_hot(pid32 pid) {
+    return proc_last_cpu[pid] >= 0 &&
+           system_ticks - proc_last_ran[pid] < SCHED_MIGRATION_COST;
+}
+
+static uint32_t select_cpu(pid32 pid, uint32_t cpuid) {
+    sched_domain_t dist, best_dist;
+    uint64_t load, best_load;
+    uint32_t best, i;
     
-    node = node_alloc();
-    if (node == NULL) {
-        restore(mask);
+    if (cpu_allowed(pid, cpuid)) {
+        return cpuid;
+    }
+    
+    if (proc_last_cpu[pid] >= 0 && cpu_allowed(pid, (uint32_t)proc_last_cpu[pid])) {
+        return (uint32_t)proc_last_cpu[pid];
+    }
+    
+    best = cpuid;
+    best_dist = SCHED_DOMAIN_NUM;
+    best_load = UINT64_MAX;
+    
+    for (i = 0; i < SCHED_NCPUS; i++) {
+        if (!cpu_allowed(pid, i)) {
+            continue;
+        }
+        
+        dist = sched_cpu_distance(cpuid, i);
+        load = sched_cpu_load(i);
+        if (dist < best_dist || (dist == best_dist && load < best_load)) {
+            best = i;
+            best_dist = dist;
+            best_load = load;
+        }
+    }
+    
+    return best;
+}
+
+static sched_cpu_t *busiest_cpu(uint32_t cpuid, sched_cpumask_t span) {
+    sched_cpu_t *busiest = NULL;
+    uint64_t load, max_load = 0;
+    uint32_t i;
+    
+    for (i = 0; i < SCHED_NCPUS; i++) {
+        if (i == cpuid || (span & (1u << i)) == 0 || sched_cpus[i].rq.count == 0) {
+            continue;
+        }
+        
+        load = sched_cpu_load(i);
+        if (busiest == NULL || load > max_load) {
+            busiest = &sched_cpus[i];
+            max_load = load;
+        }
+    }
+    
+    return busiest;
+}
+
+static ready_node_t *migrate_candidate(ready_node_t *node, uint32_t dst,
+                                       bool allow_hot, uint64_t max_weight) {
+    for (; node != NULL; node = node->prev) {
+        if (cpu_allowed(node->pid, dst) && node->weight <= max_weight &&
+            (allow_hot || !task_cache_hot(node->pid))) {
+            return node;
+        }
+    }
+    
+    return NULL;
+}
+
+static void cpu_resched(uint32_t cpuid) {
+    sched_cpus[cpuid].need_resched = true;
+    if (cpuid == sched_this_cpu()->id) {
+        need_resched = true;
+    }
+}
+
+static void gang_enqueue(pid32 pid) {
+    if (gang_runnable[pid]) {
         return;
     }
     
-    node->pid = pid;
-    node->priority = proctab[pid].pprio;
-    node->time_slice = current_quantum;
-    node->enqueue_time = system_ticks;
+    gang_runnable[pid] = true;
+    runnable_inc();
     
-    node->next = NULL;
-    node->prev = ready_queue.tail;
+    if (proc_gang[pid] == gang_slot) {
+        cpu_resched(proc_gang_idx[pid]);
+    }
+}
+
+static bool gang_dequeue(pid32 pid) {
+    if (!gang_runnable[pid]) {
+        return false;
+    }
+    
+    gang_runnable[pid] = false;
+    runnable_dec();
+    
+    return true;
+}
+
+#ifndef SCHED_STATIC_POLICY
+static pid32 gang_pick(sched_cpu_t *cpu) {
+    pid32 pid;
+    
+    if (gang_slot < 0) {
+        return -1;
+    }
+    
+    pid = gangs[gang_slot].members[cpu->id];
+    if (pid < 0 || !gang_dequeue(pid)) {
+        return -1;
+    }
+    
+    return pid;
+}
+#endif
+
+static bool gang_ready(int32_t gid) {
+    uint32_t k;
+    pid32 pid;
+    
+    if (!gangs[gid].used) {
+        return false;
+    }
+    
+    for (k = 0; k < SCHED_NCPUS; k++) {
+        pid = gangs[gid].members[k];
+        if (pid >= 0 && (gang_runnable[pid] || proctab[pid].pstate == PR_CURR)) {
+            return true;
+        }
+    }
+    
+    return false;
+}
+
+static void gang_rotate(void) {
+    int32_t gid, next = -1;
+    uint32_t i;
+    
+    for (gid = gang_slot + 1; gid < SCHED_MAX_GANGS && next < 0; gid++) {
+        if (gang_ready(gid)) {
+            next = gid;
+        }
+    }
+    
+    if (next < 0 && gang_slot >= 0 && ready_queue_count() == 0) {
+        for (gid = 0; gid <= gang_slot && next < 0; gid++) {
+            if (gang_ready(gid)) {
+                next = gid;
+            }
+        }
+    }
+    
+    gang_slot_end = system_ticks + current_quantum;
+    
+    if (next == gang_slot) {
+        return;
+    }
+    
+    gang_slot = next;
+    if (next >= 0) {
+        gangs[next].slots++;
+    }
+    
+    for (i = 0; i < SCHED_NCPUS; i++) {
+        cpu_resched(i);
+    }
+}
+
+static void gang_remove(pid32 pid) {
+    int32_t gid;
+    
+    gid = proc_gang[pid];
+    if (gid < 0) {
+        return;
+    }
+    
+    gangs[gid].members[proc_gang_idx[pid]] = -1;
+    gangs[gid].nmembers--;
+    proc_gang[pid] = -1;
+}
+
+static int32_t bw_throttled_group(pid32 pid) {
+    int32_t gid;
+    
+    for (gid = proc_bw[pid]; gid >= 0; gid = bw_groups[gid].parent) {
+        if (bw_groups[gid].throttled) {
+            return gid;
+        }
+    }
+    
+    return -1;
+}
+
+static bool bw_park(pid32 pid) {
+    int32_t gid;
+    
+    if (bw_nthrottled == 0 || proc_bw[pid] < 0) {
+        return false;
+    }
+    
+    gid = bw_throttled_group(pid);
+    if (gid < 0) {
+        return false;
+    }
+    
+    if (bw_parked_on[pid] < 0) {
+        bw_link(&bw_parked[gid], bw_parked_next, bw_parked_prev, pid);
+        bw_parked_on[pid] = gid;
+    }
+    
+    return true;
+}
+
+static bool bw_unpark(pid32 pid) {
+    if (bw_parked_on[pid] < 0) {
+        return false;
+    }
+    
+    bw_unlink(&bw_parked[bw_parked_on[pid]], bw_parked_next, bw_parked_prev, pid);
+    bw_parked_on[pid] = -1;
+    
+    return true;
+}
+
+static void cpu_lock_pair(sched_cpu_t *a, sched_cpu_t *b) {
+    if (a->id < b->id) {
+        cpu_lock(a);
+        cpu_lock(b);
+    } else {
+        cpu_lock(b);
+        cpu_lock(a);
+    }
+}
+
+static uint32_t hist_bucket(uint64_t value) {
+    uint32_t msb;
+    
+    if (value < SCHED_HIST_SUB) {
+        return (uint32_t)value;
+    }
+    
+    msb = 63 - (uint32_t)__builtin_clzll(value);
+    if (msb >= SCHED_HIST_MAX_BITS) {
+        return SCHED_HIST_BUCKETS - 1;
+    }
+    
+    return (msb - SCHED_HIST_SUB_BITS + 1) * SCHED_HIST_SUB +
+           (uint32_t)((value >> (msb - SCHED_HIST_SUB_BITS)) & (SCHED_HIST_SUB - 1));
+}
+
+static uint64_t hist_bucket_high(uint32_t bucket) {
+    uint32_t shift, sub;
+    
+    if (bucket < SCHED_HIST_SUB) {
+        return bucket;
+    }
+    
+    shift = bucket / SCHED_HIST_SUB - 1;
+    sub = bucket % SCHED_HIST_SUB;
+    
+    return ((uint64_t)(SCHED_HIST_SUB + sub + 1) << shift) - 1;
+}
+
+static void latency_record(pid32 pid, sched_lat_t which, uint64_t value) {
+    sched_hist_record(&sched_stats.latency[which], value);
+    sched_hist_record(&proc_cold[pid].latency[which], value);
+    
+    switch (which) {
+        case SCHED_LAT_WAIT:
+            proc_cold[pid].total_waittime += value;
+            sched_stats.avg_wait_time = sched_hist_mean(&sched_stats.latency[which]);
+            break;
+            
+        case SCHED_LAT_SLICE:
+            proc_cold[pid].time_slices++;
+            break;
+            
+        case SCHED_LAT_TURNAROUND:
+            sched_stats.avg_turnaround = sched_hist_mean(&sched_stats.latency[which]);
+            break;
+            
+        default:
+            break;
+    }
+}
+
+sched_cpu_t *sched_this_cpu(void) {
+#if SCHED_NCPUS > 1
+    return &sched_cpus[getcpuid()];
+#else
+    return &sched_cpus[0];
+#endif
+}
+
+void sched_set_resched(void) {
+    sched_this_cpu()->need_resched = true;
+    need_resched = true;
+}
+
+void ready_queue_init(void) {
+    uint32_t i;
+    
+    for (i = 0; i < SCHED_NCPUS; i++) {
+        sched_cpus[i].id = i;
+        sched_cpus[i].rq.head = NULL;
+        sched_cpus[i].rq.tail = NULL;
+        sched_cpus[i].rq.count = 0;
+        sched_cpus[i].rq.priority = 0;
+        sched_cpus[i].curr = (i == 0) ? currpid : -1;
+        sched_cpus[i].need_resched = false;
+        sched_cpus[i].quantum_remaining = current_quantum;
+        sched_cpus[i].dispatches = 0;
+        sched_cpus[i].rq.load = 0;
+        sched_cpus[i].steals = 0;
+        sched_cpus[i].migrations = 0;
+        sched_cpus[i].next_balance = SCHED_BALANCE_INTERVAL;
+        sched_cpus[i].lock = 0;
+    }
+    
+    node_pool_init();
+}
+
+void ready_enqueue_cpu(uint32_t cpuid, pid32 pid) {
+    ready_node_t *node;
+    sched_cpu_t *cpu;
+    intmask mask;
+    
+    if (pid < 0 || pid >= NPROC || cpuid >= SCHED_NCPUS) {
+        return;
+    }
+    
+    if (proc_gang[pid] >= 0) {
+        mask = disable();
+        gang_enqueue(pid);
+        restore(mask);
+        return;
+    }
+    
+    node = &node_pool[pid];
+    
+    cpuid = select_cpu(pid, cpuid);
+    cpu = &sched_cpus[cpuid];
+    
+    mask = disable();
+    cpu_lock(cpu);
+    
+    if (!node_claim(node, pid)) {
+        cpu_unlock(cpu);
+        restore(mask);
+        return;
+    }
+    
+    node->priority = proctab[pid].pprio;
+    node->time_slice = current_quantum;
+    node->weight = task_weight(pid);
+    node->enqueue_time = system_ticks;
+    node->cpu = cpuid;
+    
+    rq_link_tail(&cpu->rq, node);
+    
+    cpu_unlock(cpu);
+    
+    runnable_inc();
+    
+    restore(mask);
+}
+
+void ready_enqueue(pid32 pid) {
+    uint32_t cpuid;
+    
+    cpuid = sched_this_cpu()->id;
+    
+    if (pid >= 0 && pid < NPROC && task_cache_hot(pid)) {
+        cpuid = (uint32_t)proc_last_cpu[pid];
+    }
+    
+    ready_enqueue_cpu(cpuid, pid);
+}
+
+void ready_dequeue(pid32 pid) {
+    ready_node_t *node;
+    sched_cpu_t *cpu;
+    intmask mask;
+    
+    if (pid < 0 || pid >= NPROC) {
+        return;
+    }
+    
+    node = &node_pool[pid];
+    
+    mask = disable();
+    
+    if (gang_dequeue(pid)) {
+        restore(mask);
+        return;
+    }
+    
+    while (__atomic_load_n(&node->pid, __ATOMIC_ACQUIRE) == pid) {
+        cpu = &sched_cpus[node->cpu];
+        cpu_lock(cpu);
+        
+        if (node->pid == pid && node->cpu == cpu->id && rq_linked(&cpu->rq, node)) {
+            rq_unlink(&cpu->rq, node);
+            node_release(node);
+            cpu_unlock(cpu);
+            runnable_dec();
+            break;
+        }
+        
+        cpu_unlock(cpu);
+    }
+    
+    restore(mask);
+}
+
+pid32 ready_peek(void) {
+    ready_node_t *head;
+    
+    head = sched_this_cpu()->rq.head;
+    if (head == NULL) {
+        return -1;
+    }
+    return head->pid;
+}
+
+pid32 ready_pop_cpu(uint32_t cpuid) {
+    ready_node_t *node;
+    sched_cpu_t *cpu;
+    pid32 pid;
+    intmask mask;
+    
+    if (cpuid >= SCHED_NCPUS) {
+        return -1;
+    }
+    
+    cpu = &sched_cpus[cpuid];
+    
+    mask = disable();
+    cpu_lock(cpu);
+    
+    node = cpu->rq.head;
+    if (node == NULL) {
+        cpu_unlock(cpu);
+        restore(mask);
+        return -1;
+    }
+    
+    pid = node->pid;
+    rq_unlink(&cpu->rq, node);
+    node_release(node);
+    
+    cpu_unlock(cpu);
+    
+    runnable_dec();
+    
+    restore(mask);
+    
+    return pid;
+}
+
+pid32 ready_pop(void) {
+    return ready_pop_cpu(sched_this_cpu()->id);
+}
+
+pid32 sched_steal(uint32_t cpuid) {
+    sched_cpu_t *victim;
+    ready_node_t *node;
+    uint32_t level;
+    pid32 pid = -1;
+    intmask mask;
+    
+    if (cpuid >= SCHED_NCPUS) {
+        return -1;
+    }
+    
+    mask = disable();
+    
+    for (level = 0; level < SCHED_DOMAIN_NUM && pid < 0; level++) {
+        victim = busiest_cpu(cpuid, sched_domain_span(cpuid, (sched_domain_t)level));
+        if (victim == NULL || victim->rq.count < SCHED_STEAL_THRESHOLD) {
+            continue;
+        }
+        
+        cpu_lock(victim);
+        
+        node = NULL;
+        if (victim->rq.count >= SCHED_STEAL_THRESHOLD) {
+            node = migrate_candidate(victim->rq.tail, cpuid, false, UINT64_MAX);
+            if (node == NULL) {
+                node = migrate_candidate(victim->rq.tail, cpuid, true, UINT64_MAX);
+            }
+        }
+        
+        if (node != NULL) {
+            pid = node->pid;
+            rq_unlink(&victim->rq, node);
+            node_release(node);
+        }
+        
+        cpu_unlock(victim);
+    }
+    
+    if (pid >= 0) {
+        runnable_dec();
+        sched_cpus[cpuid].steals++;
+    }
+    
+    restore(mask);
+    
+    return pid;
+}
+
+uint64_t sched_cpu_load(uint32_t cpuid) {
+    sched_cpu_t *cpu;
+    uint64_t load;
+    pid32 curr;
+    
+    if (cpuid >= SCHED_NCPUS) {
+        return 0;
+    }
+    
+    cpu = &sched_cpus[cpuid];
+    load = cpu->rq.load;
+    
+    curr = cpu->curr;
+    if (curr > NULLPROC && curr < NPROC && proctab[curr].pstate == PR_CURR) {
+        load += task_weight(curr);
+    }
+    
+    return load;
+}
+
+static uint32_t balance_pull(sched_cpu_t *src, sched_cpu_t *dst, uint64_t imbalance) {
+    ready_node_t *node, *prev;
+    uint32_t moved = 0;
+    
+    cpu_lock_pair(src, dst);
+    
+    node = migrate_candidate(src->rq.tail, dst->id, false, imbalance);
+    while (node != NULL) {
+        prev = node->prev;
+        
+        rq_unlink(&src->rq, node);
+        node->cpu = dst->id;
+        rq_link_tail(&dst->rq, node);
+        
+        imbalance -= node->weight;
+        moved++;
+        
+        node = migrate_candidate(prev, dst->id, false, imbalance);
+    }
+    
+    dst->migrations += moved;
+    
+    cpu_unlock(src);
+    cpu_unlock(dst);
+    
+    return moved;
+}
+
+uint32_t sched_balance(uint32_t cpuid) {
+    sched_cpu_t *cpu, *busiest;
+    uint64_t load, busiest_load;
+    uint32_t level, moved = 0;
+    intmask mask;
+    
+    if (cpuid >= SCHED_NCPUS) {
+        return 0;
+    }
+    
+    cpu = &sched_cpus[cpuid];
+    
+    mask = disable();
+    
+    for (level = 0; level < SCHED_DOMAIN_NUM && moved == 0; level++) {
+        busiest = busiest_cpu(cpuid, sched_domain_span(cpuid, (sched_domain_t)level));
+        if (busiest == NULL) {
+            continue;
+        }
+        
+        load = sched_cpu_load(cpuid);
+        busiest_load = sched_cpu_load(busiest->id);
+        if (busiest_load * 100 <= load * balance_pct[level]) {
+            continue;
+        }
+        
+        moved = balance_pull(busiest, cpu, (busiest_load - load) / 2);
+    }
+    
+    if (moved > 0 && (cpu->curr < 0 || proctab[cpu->curr].pstate != PR_CURR)) {
+        cpu->need_resched = true;
+    }
+    
+    restore(mask);
+    
+    return moved;
+}
+
+void sched_balance_enable(bool enable) {
+    __atomic_store_n(&balance_enabled, enable, __ATOMIC_RELAXED);
+}
+
+bool sched_balance_enabled(void) {
+    return __atomic_load_n(&balance_enabled, __ATOMIC_RELAXED);
+}
+
+syscall sched_set_affinity(pid32 pid, sched_cpumask_t cpus) {
+    uint32_t cpuid, i;
+    intmask mask;
+    
+    cpus &= SCHED_CPUMASK_ALL;
+    if (pid < 0 || pid >= NPROC || cpus == 0) {
+        return SYSERR;
+    }
+    
+    mask = disable();
+    
+    proc_affinity[pid] = cpus;
+    
+    cpuid = node_pool[pid].cpu;
+    if (ready_queue_contains(pid) && !cpu_allowed(pid, cpuid)) {
+        ready_dequeue(pid);
+        ready_enqueue_cpu(cpuid, pid);
+    }
+    
+    for (i = 0; i < SCHED_NCPUS; i++) {
+        if (sched_cpus[i].curr == pid && !cpu_allowed(pid, i)) {
+            cpu_resched(i);
+        }
+    }
+    
+    restore(mask);
+    
+    return OK;
+}
+
+sched_cpumask_t sched_get_affinity(pid32 pid) {
+    if (pid < 0 || pid >= NPROC) {
+        return 0;
+    }
+    
+    return proc_affinity[pid];
+}
+
+syscall sched_gang_create(void) {
+    int32_t gid;
+    intmask mask;
+    
+    mask = disable();
+    
+    for (gid = 0; gid < SCHED_MAX_GANGS; gid++) {
+        if (!gangs[gid].used) {
+            gangs[gid].used = true;
+            gangs[gid].nmembers = 0;
+            gangs[gid].slots = 0;
+            memset(gangs[gid].members, 0xFF, sizeof(gangs[gid].members));
+            gang_count++;
+            restore(mask);
+            return gid;
+        }
+    }
+    
+    restore(mask);
+    
+    return SYSERR;
+}
+
+syscall sched_gang_destroy(int32_t gid) {
+    uint32_t k;
+    intmask mask;
+    
+    if (gid < 0 || gid >= SCHED_MAX_GANGS) {
+        return SYSERR;
+    }
+    
+    mask = disable();
+    
+    if (!gangs[gid].used) {
+        restore(mask);
+        return SYSERR;
+    }
+    
+    for (k = 0; k < SCHED_NCPUS; k++) {
+        if (gangs[gid].members[k] >= 0) {
+            sched_gang_leave(gangs[gid].members[k]);
+        }
+    }
+    
+    gangs[gid].used = false;
+    gang_count--;
+    
+    if (gang_slot == gid) {
+        gang_slot = -1;
+        gang_slot_end = system_ticks;
+    }
+    
+    restore(mask);
+    
+    return OK;
+}
+
+syscall sched_gang_join(int32_t gid, pid32 pid) {
+    uint32_t k;
+    bool queued;
+    intmask mask;
+    
+    if (gid < 0 || gid >= SCHED_MAX_GANGS || pid < 0 || pid >= NPROC) {
+        return SYSERR;
+    }
+    
+    mask = disable();
+    
+    if (!gangs[gid].used || proc_gang[pid] >= 0) {
+        restore(mask);
+        return SYSERR;
+    }
+    
+    for (k = 0; k < SCHED_NCPUS && gangs[gid].members[k] >= 0; k++) {
+    }
+    
+    if (k == SCHED_NCPUS) {
+        restore(mask);
+        return SYSERR;
+    }
+    
+    queued = ready_queue_contains(pid);
+    if (queued) {
+        ready_dequeue(pid);
+    }
+    
+    gangs[gid].members[k] = pid;
+    gangs[gid].nmembers++;
+    proc_gang[pid] = gid;
+    proc_gang_idx[pid] = k;
+    
+    if (queued) {
+        gang_enqueue(pid);
+    }
+    
+    restore(mask);
+    
+    return OK;
+}
+
+syscall sched_gang_leave(pid32 pid) {
+    bool queued;
+    intmask mask;
+    
+    if (pid < 0 || pid >= NPROC) {
+        return SYSERR;
+    }
+    
+    mask = disable();
+    
+    if (proc_gang[pid] < 0) {
+        restore(mask);
+        return SYSERR;
+    }
+    
+    queued = gang_dequeue(pid);
+    gang_remove(pid);
+    
+    if (queued) {
+        ready_enqueue(pid);
+    }
+    
+    restore(mask);
+    
+    return OK;
+}
+
+int32_t sched_get_gang(pid32 pid) {
+    if (pid < 0 || pid >= NPROC) {
+        return -1;
+    }
+    
+    return proc_gang[pid];
+}
+
+bool ready_queue_empty(void) {
+    return sched_this_cpu()->rq.head == NULL;
+}
+
+uint32_t ready_queue_count(void) {
+    uint32_t count = 0;
+    uint32_t i;
+    
+    for (i = 0; i < SCHED_NCPUS; i++) {
+        count += sched_cpus[i].rq.count;
+    }
+    return count;
+}
+
+bool ready_queue_contains(pid32 pid) {
+    if (pid < 0 || pid >= NPROC) {
+        return false;
+    }
+    return __atomic_load_n(&node_pool[pid].pid, __ATOMIC_ACQUIRE) == pid;
+}
+
+static scheduler_ops_t *policy_ops(pid32 pid);
+
+void sched_switch(pid32 oldpid, pid32 newpid) {
+    sched_cpu_t *cpu = sched_this_cpu();
+    uint64_t now;
+    
+    if (classes_enabled) {
+        oldpid = cpu->curr;
+    }
+    
+    cpu->curr = newpid;
+    cpu->dispatches++;
+    currpid = newpid;
+    
+    __atomic_add_fetch(&sched_stats.context_switches, 1, __ATOMIC_RELAXED);
+    
+    sched_trace_emit(TRACE_SWITCH, newpid, (uint32_t)oldpid);
+    
+    now = sched_clock();
+    
+    if (oldpid >= 0 && oldpid < NPROC) {
+        proc_last_ran[oldpid] = system_ticks;
+        if (oldpid != newpid && proctab[oldpid].pstate == PR_CURR) {
+            proctab[oldpid].pstate = PR_READY;
+        }
+    }
+    
+    if (newpid >= 0 && newpid < NPROC) {
+        proctab[newpid].pstate = PR_CURR;
+        proc_last_cpu[newpid] = (int32_t)cpu->id;
+        proc_last_ran[newpid] = system_ticks;
+    }
+    
+    if (oldpid >= 0 && oldpid < NPROC && oldpid != newpid) {
+        stats_write_begin(oldpid, true);
+        
+        util_update(oldpid, true);
+        
+        if (proc_hot[oldpid].times_scheduled > 0) {
+            latency_record(oldpid, SCHED_LAT_SLICE, now - proc_hot[oldpid].last_scheduled);
+        }
+        
+        if (proctab[oldpid].pstate == PR_READY || proctab[oldpid].pstate == PR_CURR) {
+            proc_hot[oldpid].ready_since = now;
+            proc_hot[oldpid].queued = true;
+        }
+        
+        stats_write_end(oldpid, true);
+    }
+    
+    if (newpid >= 0 && newpid < NPROC) {
+        sched_wlat_dispatch(newpid, oldpid, policy_ops(newpid) ? policy_ops(newpid)->name : NULL);
+        
+        stats_write_begin(newpid, true);
+        
+        if (proc_hot[newpid].queued) {
+            latency_record(newpid, SCHED_LAT_WAIT, now - proc_hot[newpid].ready_since);
+            proc_hot[newpid].queued = false;
+        }
+        
+        if (proc_hot[newpid].woken) {
+            latency_record(newpid, SCHED_LAT_WAKEUP, now - proc_hot[newpid].woken_at);
+            proc_hot[newpid].woken = false;
+        }
+        
+        if (newpid != oldpid) {
+            util_update(newpid, false);
+        }
+        
+        proc_hot[newpid].context_switches++;
+        proc_hot[newpid].times_scheduled++;
+        proc_hot[newpid].last_scheduled = now;
+        
+        stats_write_end(newpid, true);
+    }
+    
+    context_switch(oldpid, newpid);
+}
+
+#ifndef SCHED_STATIC_POLICY
+static void cpu_schedule(sched_cpu_t *cpu) {
+    pid32 next_pid;
+    pid32 old_pid;
+    
+    next_pid = gang_pick(cpu);
+    if (next_pid < 0) {
+        next_pid = ready_pop_cpu(cpu->id);
+    }
+    if (next_pid < 0) {
+        next_pid = sched_steal(cpu->id);
+    }
+    
+    old_pid = cpu->curr;
+    
+    if (next_pid < 0) {
+        if (old_pid >= 0 && old_pid < NPROC && proctab[old_pid].pstate != PR_CURR) {
+            cpu->curr = -1;
+        }
+        return;
+    }
+    
+    if (old_pid >= 0 && old_pid < NPROC && proctab[old_pid].pstate == PR_CURR &&
+        (!classes_enabled || proc_class[old_pid] == SCHED_CLASS_IDLE)) {
+        proctab[old_pid].pstate = PR_READY;
+        ready_enqueue_cpu(cpu->id, old_pid);
+    }
+    
+    proctab[next_pid].pstate = PR_CURR;
+    cpu->quantum_remaining = current_quantum;
+    
+    sched_switch(old_pid, next_pid);
+}
+#endif
+
+static scheduler_ops_t *policy_ops(pid32 pid) {
+    if (!classes_enabled) {
+        return current_scheduler;
+    }
+    
+    if (pid < 0 || pid >= NPROC) {
+        return class_ops[SCHED_CLASS_FAIR];
+    }
+    
+    return class_ops[proc_class[pid]];
+}
+
+static void class_enqueue(pid32 pid) {
+    scheduler_ops_t *ops;
+    uint32_t cls;
+    pid32 curr;
+    
+    cls = proc_class[pid];
+    ops = class_ops[cls];
+    
+    if (ops != NULL && ops->enqueue != NULL) {
+        SCHED_PROF_VOID(SCHED_PROF_ENQUEUE, ops->enqueue(pid));
+    } else {
+        ready_enqueue(pid);
+    }
+    
+    if (!class_runnable[pid]) {
+        class_runnable[pid] = true;
+        __atomic_add_fetch(&class_nr[cls], 1, __ATOMIC_RELAXED);
+        __atomic_or_fetch(&class_mask, 1u << cls, __ATOMIC_RELAXED);
+    }
+    
+    curr = sched_this_cpu()->curr;
+    if (curr < 0 || curr >= NPROC || !class_runnable[curr] || cls < proc_class[curr]) {
+        sched_set_resched();
+    }
+}
+
+static void class_dequeue(pid32 pid) {
+    scheduler_ops_t *ops;
+    uint32_t cls;
+    
+    cls = proc_class[pid];
+    ops = class_ops[cls];
+    
+    if (ops != NULL && ops->dequeue != NULL) {
+        SCHED_PROF_VOID(SCHED_PROF_DEQUEUE, ops->dequeue(pid));
+    } else {
+        ready_dequeue(pid);
+    }
+    
+    if (class_runnable[pid]) {
+        class_runnable[pid] = false;
+        if (__atomic_sub_fetch(&class_nr[cls], 1, __ATOMIC_RELAXED) == 0) {
+            __atomic_and_fetch(&class_mask, ~(1u << cls), __ATOMIC_RELAXED);
+            if (__atomic_load_n(&class_nr[cls], __ATOMIC_RELAXED) != 0) {
+                __atomic_or_fetch(&class_mask, 1u << cls, __ATOMIC_RELAXED);
+            }
+        }
+    }
+}
+
+static uint32_t class_of_curr(sched_cpu_t *cpu) {
+    if (cpu->curr < 0 || cpu->curr >= NPROC || !class_runnable[cpu->curr]) {
+        return SCHED_CLASS_IDLE;
+    }
+    
+    return proc_class[cpu->curr];
+}
+
+static void class_check_rt(sched_cpu_t *cpu, uint32_t cls) {
+    pid32 pick;
+    
+    pick = SCHED_PROF_CALL(SCHED_PROF_PICK_NEXT, class_ops[SCHED_CLASS_RT]->pick_next());
+    if (pick != cpu->curr && (pick >= 0 || cls == SCHED_CLASS_RT)) {
+        sched_set_resched();
+    }
+}
+
+#ifndef SCHED_STATIC_POLICY
+static bool class_check_preempt_wakeup(sched_cpu_t *cpu, pid32 pid) {
+    scheduler_ops_t *ops;
+    uint32_t cls, curr_cls;
+    
+    if (!class_runnable[pid]) {
+        return false;
+    }
+    
+    cls = proc_class[pid];
+    curr_cls = class_of_curr(cpu);
+    if (cls != curr_cls) {
+        return cls < curr_cls;
+    }
+    
+    ops = class_ops[cls];
+    if (ops == NULL) {
+        return proctab[pid].pprio > proctab[cpu->curr].pprio;
+    }
+    
+    return ops->check_preempt_wakeup == NULL || ops->check_preempt_wakeup(pid);
+}
+
+static void class_schedule(sched_cpu_t *cpu) {
+    scheduler_ops_t *ops;
+    uint32_t mask, cls;
+    
+    mask = __atomic_load_n(&class_mask, __ATOMIC_RELAXED);
+    while (mask != 0) {
+        cls = (uint32_t)__builtin_ctz(mask);
+        mask &= mask - 1;
+        ops = class_ops[cls];
+        
+        if (ops == NULL) {
+            cpu_schedule(cpu);
+        } else if (ops->pick_next != NULL &&
+                   SCHED_PROF_CALL(SCHED_PROF_PICK_NEXT, ops->pick_next()) < 0) {
+            continue;
+        } else {
+            SCHED_PROF_VOID(SCHED_PROF_SCHEDULE, ops->schedule());
+        }
+        
+        if (cpu->curr >= 0 && cpu->curr < NPROC && class_runnable[cpu->curr] &&
+            proc_class[cpu->curr] == cls) {
+            return;
+        }
+    }
+}
+
+static bool class_tick(sched_cpu_t *cpu) {
+    scheduler_ops_t *ops;
+    uint32_t cls;
+    
+    cls = class_of_curr(cpu);
+    
+    SCHED_PROF_VOID(SCHED_PROF_TICK, class_ops[SCHED_CLASS_RT]->tick());
+    
+    ops = class_ops[cls];
+    if (cls != SCHED_CLASS_RT && ops != NULL && ops->tick != NULL) {
+        SCHED_PROF_VOID(SCHED_PROF_TICK, ops->tick());
+    }
+    
+    class_check_rt(cpu, cls);
+    
+    return ops != NULL;
+}
+#endif
+
+static bool class_catchup(sched_cpu_t *cpu, uint64_t ticks) {
+    scheduler_ops_t *ops;
+    uint32_t cls;
+    
+    cls = class_of_curr(cpu);
+    
+    class_ops[SCHED_CLASS_RT]->catchup(ticks);
+    
+    ops = class_ops[cls];
+    if (cls != SCHED_CLASS_RT && ops != NULL && ops->catchup != NULL) {
+        ops->catchup(ticks);
+    }
+    
+    return ops != NULL;
+}
+
+static uint64_t class_next_event(sched_cpu_t *cpu) {
+    scheduler_ops_t *ops;
+    uint64_t next, other;
+    uint32_t cls;
+    
+    cls = class_of_curr(cpu);
+    
+    next = class_ops[SCHED_CLASS_RT]->next_event();
+    
+    ops = class_ops[cls];
+    if (cls == SCHED_CLASS_RT) {
+        other = next;
+    } else if (ops == NULL) {
+        other = (cpu->rq.count > 0) ? cpu->quantum_remaining : SCHED_NO_EVENT;
+    } else if (ops->next_event == NULL) {
+        other = 1;
+    } else {
+        other = ops->next_event();
+    }
+    
+    return (other < next) ? other : next;
+}
+
+static const uint32_t prio_ticket_map[][2] = {
+    { PRIORITY_IDLE,     LOTTERY_MIN_TICKETS      },
+    { PRIORITY_LOW,      LOTTERY_LOW_TICKETS      },
+    { PRIORITY_NORMAL,   LOTTERY_NORMAL_TICKETS   },
+    { PRIORITY_HIGH,     LOTTERY_HIGH_TICKETS     },
+    { PRIORITY_REALTIME, LOTTERY_REALTIME_TICKETS },
+};
+
+#define PRIO_TICKET_POINTS  (sizeof(prio_ticket_map) / sizeof(prio_ticket_map[0]))
+
+static sched_hint_t migrate_hints[NPROC];
+
+static bool policy_known(scheduler_type_t type) {
+#ifdef SCHED_STATIC_POLICY
+    return type == SCHED_STATIC_TYPE;
+#else
+    switch (type) {
+        case SCHEDULER_ROUND_ROBIN:
+        case SCHEDULER_PRIORITY:
+        case SCHEDULER_MLFQ:
+        case SCHEDULER_LOTTERY:
+        case SCHEDULER_CFS:
+        case SCHEDULER_EDF:
+            return true;
+            
+        default:
+            return false;
+    }
+#endif
+}
+
+static scheduler_ops_t *policy_start(scheduler_type_t type) {
+    switch (type) {
+        case SCHEDULER_ROUND_ROBIN:
+            round_robin_init();
+            return round_robin_get_ops();
+            
+        case SCHEDULER_PRIORITY:
+            priority_init();
+            return priority_get_ops();
+            
+        case SCHEDULER_MLFQ:
+            mlfq_init();
+            return mlfq_get_ops();
+            
+        case SCHEDULER_LOTTERY:
+            lottery_init();
+            return lottery_get_ops();
+            
+        case SCHEDULER_CFS:
+            cfs_init();
+            return cfs_get_ops();
+            
+        case SCHEDULER_EDF:
+            realtime_init();
+            return realtime_get_ops();
+            
+        default:
+            return NULL;
+    }
+}
+
+static uint32_t policy_collect(sched_hint_t *hints, uint32_t max) {
+    uint32_t count = 0;
+    int i;
+    
+    if (current_scheduler != NULL && current_scheduler->export_runnable != NULL) {
+        return current_scheduler->export_runnable(hints, max);
+    }
+    
+    for (i = 0; i < NPROC && count < max; i++) {
+        if (proctab[i].pstate == PR_READY || proctab[i].pstate == PR_CURR) {
+            hints[count].pid = i;
+            hints[count].priority = proctab[i].pprio;
+            count++;
+        }
+    }
+    
+    return count;
+}
+
+static void policy_adopt(const sched_hint_t *hints, uint32_t count) {
+    uint32_t i;
+    
+    for (i = 0; i < count; i++) {
+        if (hints[i].priority != SCHED_HINT_NONE) {
+            proctab[hints[i].pid].pprio = (hints[i].priority > PRIORITY_MAX) ?
+                                          PRIORITY_MAX : hints[i].priority;
+        }
+    }
+    
+    if (classes_enabled) {
+        for (i = 0; i < count; i++) {
+            class_enqueue(hints[i].pid);
+        }
+    } else if (current_scheduler != NULL && current_scheduler->enqueue_batch != NULL) {
+        current_scheduler->enqueue_batch(hints, count);
+    } else if (current_scheduler != NULL && current_scheduler->enqueue != NULL) {
+        for (i = 0; i < count; i++) {
+            SCHED_PROF_VOID(SCHED_PROF_ENQUEUE, current_scheduler->enqueue(hints[i].pid));
+        }
+    } else {
+        for (i = 0; i < count; i++) {
+            if (proctab[hints[i].pid].pstate == PR_READY) {
+                ready_enqueue(hints[i].pid);
+            }
+        }
+    }
+}
+
+static bool cpu_busy(sched_cpu_t *cpu) {
+    return cpu->curr > NULLPROC && cpu->curr < NPROC && proctab[cpu->curr].pstate == PR_CURR;
+}
+
+static bool preempt_wakeup(sched_cpu_t *cpu, pid32 pid) {
+    if (!cpu_busy(cpu) || proc_gang[pid] >= 0) {
+        return true;
+    }
+    
+#ifdef SCHED_STATIC_POLICY
+    return SCHED_STATIC_OP(check_preempt_wakeup)(pid);
+#else
+    if (classes_enabled) {
+        return class_check_preempt_wakeup(cpu, pid);
+    }
+    
+    if (current_scheduler != NULL && current_scheduler->schedule != NULL) {
+        return current_scheduler->check_preempt_wakeup == NULL ||
+               current_scheduler->check_preempt_wakeup(pid);
+    }
+    
+    return proctab[pid].pprio > proctab[cpu->curr].pprio;
+#endif
+}
+
+static bool batch_preempts(sched_cpu_t *cpu, const sched_hint_t *hints, uint32_t count) {
+    uint32_t i;
+    
+    for (i = 0; i < count; i++) {
+        if (preempt_wakeup(cpu, hints[i].pid)) {
+            return true;
+        }
+    }
+    
+    return false;
+}
+
+static void wakeup_push(pid32 pid) {
+    pid32 head;
+    
+    if (__atomic_exchange_n(&wakeup_pending[pid], true, __ATOMIC_ACQUIRE)) {
+        return;
+    }
+    
+    head = __atomic_load_n(&wakeup_head, __ATOMIC_RELAXED);
+    do {
+        wakeup_next[pid] = head;
+    } while (!__atomic_compare_exchange_n(&wakeup_head, &head, pid, true,
+                                          __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
+
+static bool wakeup_drain(sched_cpu_t *cpu) {
+    sched_hint_t batch[SCHED_WAKEUP_BATCH];
+    pid32 list, fifo, next;
+    uint32_t count;
+    bool preempt;
+    
+    preempt = false;
+    list = __atomic_exchange_n(&wakeup_head, -1, __ATOMIC_ACQUIRE);
+    
+    fifo = -1;
+    while (list >= 0) {
+        next = wakeup_next[list];
+        wakeup_next[list] = fifo;
+        fifo = list;
+        list = next;
+    }
+    
+    count = 0;
+    while (fifo >= 0) {
+        next = wakeup_next[fifo];
+        __atomic_store_n(&wakeup_pending[fifo], false, __ATOMIC_RELEASE);
+        
+        if (proctab[fifo].pstate == PR_READY && !bw_park(fifo)) {
+            sched_trace_emit(TRACE_ENQUEUE, fifo, proctab[fifo].pprio);
+            batch[count].pid = fifo;
+            batch[count].priority = SCHED_HINT_NONE;
+            count++;
+        }
+        
+        if (count == SCHED_WAKEUP_BATCH) {
+            policy_adopt(batch, count);
+            preempt = preempt || batch_preempts(cpu, batch, count);
+            count = 0;
+        }
+        
+        fifo = next;
+    }
+    
+    if (count > 0) {
+        policy_adopt(batch, count);
+        preempt = preempt || batch_preempts(cpu, batch, count);
+    }
+    
+    return preempt;
+}
+
+static void clock_stamp_tick(void) {
+    if (clock_source != NULL) {
+        __atomic_store_n(&clock_stamp, clock_source(), __ATOMIC_RELAXED);
+    }
+}
+
+static void timer_expire(sched_cpu_t *cpu) {
+    if (sched_timer_advance(system_ticks) > 0 && classes_enabled) {
+        class_check_rt(cpu, class_of_curr(cpu));
+    }
+}
+
+static void sleep_account(pid32 pid) {
+    stats_write_begin(pid, false);
+    proc_cold[pid].total_sleeptime += system_ticks - proc_cold[pid].sleep_since;
+    stats_write_end(pid, false);
+}
+
+static void sleep_expire(void *arg) {
+    pid32 pid;
+    
+    pid = (pid32)(intptr_t)arg;
+    
+    if (proctab[pid].pstate != PR_SLEEP) {
+        return;
+    }
+    
+    sleep_account(pid);
+    sched_wakeup(pid);
+}
+
+void scheduler_init(scheduler_type_t type) {
+    int i;
+    intmask mask;
+    
+    mask = disable();
+    
+    ready_queue_init();
+    
+    memset(&sched_stats, 0, sizeof(sched_stats));
+    for (i = 0; i < NPROC; i++) {
+        memset(&proc_hot[i], 0, sizeof(sched_proc_hot_t));
+        memset(&proc_cold[i], 0, sizeof(sched_proc_cold_t));
+        proc_hot[i].util_stamp = (uint32_t)system_ticks;
+        proc_active[i] = false;
+        wakeup_pending[i] = false;
+        wakeup_next[i] = -1;
+        proc_class[i] = SCHED_CLASS_FAIR;
+        class_runnable[i] = false;
+        proc_affinity[i] = SCHED_CPUMASK_ALL;
+        proc_last_cpu[i] = -1;
+        proc_last_ran[i] = 0;
+        proc_gang[i] = -1;
+        gang_runnable[i] = false;
+        proc_bw[i] = -1;
+        bw_run_next[i] = -1;
+        bw_run_prev[i] = -1;
+        bw_parked_next[i] = -1;
+        bw_parked_prev[i] = -1;
+        bw_parked_on[i] = -1;
+    }
+    wakeup_head = -1;
+    
+    for (i = 0; i < SCHED_BW_MAX_GROUPS; i++) {
+        bw_groups[i].used = false;
+        bw_children[i] = -1;
+        bw_sibling_next[i] = -1;
+        bw_runnable[i] = -1;
+        bw_parked[i] = -1;
+    }
+    bw_nthrottled = 0;
+    
+    for (i = 0; i < SCHED_MAX_GANGS; i++) {
+        memset(&gangs[i], 0, sizeof(sched_gang_t));
+        memset(gangs[i].members, 0xFF, sizeof(gangs[i].members));
+    }
+    gang_count = 0;
+    gang_slot = -1;
+    gang_slot_end = 0;
+    
+    nr_active = 0;
+    memset(loadavg, 0, sizeof(loadavg));
+    loadavg_next = system_ticks + SCHED_LOAD_FREQ;
+    
+    sched_lock = semcreate(1);
+    
+    sched_trace_init();
+    
+    sched_wlat_init();
+    
+    sched_topology_init(SCHED_CORES_PER_CACHE, SCHED_CACHES_PER_PACKAGE);
+    
+    sched_idle_init();
+    
+    sched_timer_init(system_ticks);
+    for (i = 0; i < NPROC; i++) {
+        sched_timer_setup(&sleep_timers[i], sleep_expire, (void *)(intptr_t)i);
+    }
+    
+#ifdef SCHED_STATIC_POLICY
+    type = SCHED_STATIC_TYPE;
+#endif
+    
+    sched_policy = type;
+    
+    classes_enabled = false;
+    memset(class_ops, 0, sizeof(class_ops));
+    memset(class_nr, 0, sizeof(class_nr));
+    class_mask = 0;
+    
+    current_scheduler = policy_start(type);
+    if (current_scheduler == NULL) {
+        current_scheduler = policy_start(SCHEDULER_PRIORITY);
+        sched_policy = SCHEDULER_PRIORITY;
+    }
+    
+    sched_tunables_sync();
+    
+    sched_initialized = true;
+    
+    restore(mask);
+    
+    kprintf("Scheduler initialized: %s\n", current_scheduler->name);
+}
+
+void scheduler_shutdown(void) {
+    int i;
+    intmask mask;
+    
+    mask = disable();
+    
+    if (classes_enabled) {
+        for (i = 0; i < SCHED_CLASS_NUM; i++) {
+            if (class_ops[i] != NULL && class_ops[i]->shutdown != NULL) {
+                class_ops[i]->shutdown();
+            }
+            class_ops[i] = NULL;
+        }
+        classes_enabled = false;
+    } else if (current_scheduler != NULL && current_scheduler->shutdown != NULL) {
+        current_scheduler->shutdown();
+    }
+    
+    sched_initialized = false;
+    
+    restore(mask);
+}
+
+syscall scheduler_switch(scheduler_type_t type) {
+    uint32_t count;
+    intmask mask;
+    
+    if (!policy_known(type) || classes_enabled) {
+        return SYSERR;
+    }
+    
+    mask = disable();
+    
+    wakeup_drain(sched_this_cpu());
+    
+    count = policy_collect(migrate_hints, NPROC);
+    
+    if (current_scheduler != NULL && current_scheduler->shutdown != NULL) {
+        current_scheduler->shutdown();
+    }
+    
+    current_scheduler = policy_start(type);
+    sched_policy = type;
+    
+    policy_adopt(migrate_hints, count);
+    
+    sched_set_resched();
+    
+    restore(mask);
+    
+    kprintf("Scheduler switched to: %s (%u tasks migrated)\n",
+            current_scheduler->name, count);
+    
+    return OK;
+}
+
+syscall sched_classes_enable(scheduler_type_t fair) {
+    uint32_t count;
+    intmask mask;
+    
+#ifdef SCHED_STATIC_POLICY
+    (void)fair;
+    (void)count;
+    (void)mask;
+    return SYSERR;
+#else
+    if (fair != SCHEDULER_CFS && fair != SCHEDULER_MLFQ) {
+        return SYSERR;
+    }
+    
+    mask = disable();
+    
+    if (classes_enabled) {
+        restore(mask);
+        return SYSERR;
+    }
+    
+    wakeup_drain(sched_this_cpu());
+    
+    count = policy_collect(migrate_hints, NPROC);
+    
+    if (current_scheduler != NULL && current_scheduler->shutdown != NULL) {
+        current_scheduler->shutdown();
+    }
+    
+    class_ops[SCHED_CLASS_RT] = policy_start(SCHEDULER_EDF);
+    class_ops[SCHED_CLASS_FAIR] = policy_start(fair);
+    class_ops[SCHED_CLASS_IDLE] = NULL;
+    
+    current_scheduler = class_ops[SCHED_CLASS_FAIR];
+    sched_policy = fair;
+    
+    memset(class_runnable, 0, sizeof(class_runnable));
+    memset(class_nr, 0, sizeof(class_nr));
+    class_mask = 0;
+    classes_enabled = true;
+    
+    policy_adopt(migrate_hints, count);
+    
+    sched_set_resched();
+    
+    restore(mask);
+    
+    kprintf("Scheduling classes enabled: realtime > %s > idle (%u tasks)\n",
+            current_scheduler->name, count);
+    
+    return OK;
+#endif
+}
+
+syscall sched_classes_disable(void) {
+    scheduler_ops_t *ops;
+    uint32_t count, cls, cpu;
+    pid32 pid;
+    intmask mask;
+    
+    mask = disable();
+    
+    if (!classes_enabled) {
+        restore(mask);
+        return SYSERR;
+    }
+    
+    wakeup_drain(sched_this_cpu());
+    
+    count = 0;
+    for (cls = 0; cls < SCHED_CLASS_NUM; cls++) {
+        ops = class_ops[cls];
+        if (ops != NULL && ops->export_runnable != NULL) {
+            count += ops->export_runnable(migrate_hints + count, NPROC - count);
+        }
+    }
+    
+    for (cpu = 0; cpu < SCHED_NCPUS; cpu++) {
+        while (count < NPROC && (pid = ready_pop_cpu(cpu)) >= 0) {
+            migrate_hints[count].pid = pid;
+            migrate_hints[count].priority = SCHED_HINT_NONE;
+            count++;
+        }
+    }
+    
+    for (cls = 0; cls < SCHED_CLASS_NUM; cls++) {
+        ops = class_ops[cls];
+        if (ops != NULL && ops->shutdown != NULL) {
+            ops->shutdown();
+        }
+        class_ops[cls] = NULL;
+    }
+    
+    classes_enabled = false;
+    class_mask = 0;
+    
+    current_scheduler = policy_start((scheduler_type_t)sched_policy);
+    
+    policy_adopt(migrate_hints, count);
+    
+    sched_set_resched();
+    
+    restore(mask);
+    
+    return OK;
+}
+
+bool sched_classes_enabled(void) {
+    return classes_enabled;
+}
+
+syscall sched_set_class(pid32 pid, sched_class_t cls) {
+    intmask mask;
+    
+    if (pid < 0 || pid >= NPROC || cls >= SCHED_CLASS_NUM) {
+        return SYSERR;
+    }
+    
+    mask = disable();
+    
+    if (classes_enabled && class_runnable[pid] && proc_class[pid] != cls) {
+        class_dequeue(pid);
+        proc_class[pid] = cls;
+        class_enqueue(pid);
+        sched_set_resched();
+    } else {
+        proc_class[pid] = cls;
+    }
+    
+    restore(mask);
+    
+    return OK;
+}
+
+sched_class_t sched_get_class(pid32 pid) {
+    if (pid < 0 || pid >= NPROC) {
+        return SCHED_CLASS_IDLE;
+    }
+    
+    return (sched_class_t)proc_class[pid];
+}
+
+int32_t sched_prio_to_nice(uint32_t priority) {
+    if (priority > PRIORITY_MAX) {
+        priority = PRIORITY_MAX;
+    }
+    
+    if (priority >= PRIORITY_NORMAL) {
+        return -(int32_t)(((priority - PRIORITY_NORMAL) * -CFS_NICE_MIN +
+                           (PRIORITY_MAX - PRIORITY_NORMAL) / 2) /
+                          (PRIORITY_MAX - PRIORITY_NORMAL));
+    }
+    
+    return (int32_t)(((PRIORITY_NORMAL - priority) * CFS_NICE_MAX +
+                      PRIORITY_NORMAL / 2) / PRIORITY_NORMAL);
+}
+
+uint32_t sched_nice_to_prio(int32_t nice) {
+    if (nice < CFS_NICE_MIN) {
+        nice = CFS_NICE_MIN;
+    }
+    if (nice > CFS_NICE_MAX) {
+        nice = CFS_NICE_MAX;
+    }
+    
+    if (nice <= 0) {
+        return PRIORITY_NORMAL +
+               ((uint32_t)-nice * (PRIORITY_MAX - PRIORITY_NORMAL) +
+                -CFS_NICE_MIN / 2) / -CFS_NICE_MIN;
+    }
+    
+    return PRIORITY_NORMAL -
+           ((uint32_t)nice * PRIORITY_NORMAL + CFS_NICE_MAX / 2) / CFS_NICE_MAX;
+}
+
+uint32_t sched_prio_to_tickets(uint32_t priority) {
+    uint32_t i;
+    
+    if (priority >= PRIORITY_MAX) {
+        return prio_ticket_map[PRIO_TICKET_POINTS - 1][1];
+    }
+    
+    for (i = 1; i < PRIO_TICKET_POINTS; i++) {
+        if (priority <= prio_ticket_map[i][0]) {
+            uint32_t p0 = prio_ticket_map[i - 1][0];
+            uint32_t p1 = prio_ticket_map[i][0];
+            uint32_t t0 = prio_ticket_map[i - 1][1];
+            uint32_t t1 = prio_ticket_map[i][1];
+            
+            return t0 + ((priority - p0) * (t1 - t0)) / (p1 - p0);
+        }
+    }
+    
+    return LOTTERY_DEFAULT_TICKETS;
+}
+
+uint32_t sched_tickets_to_prio(uint32_t tickets) {
+    uint32_t i;
+    
+    if (tickets <= prio_ticket_map[0][1]) {
+        return prio_ticket_map[0][0];
+    }
+    
+    for (i = 1; i < PRIO_TICKET_POINTS; i++) {
+        if (tickets <= prio_ticket_map[i][1]) {
+            uint32_t p0 = prio_ticket_map[i - 1][0];
+            uint32_t p1 = prio_ticket_map[i][0];
+            uint32_t t0 = prio_ticket_map[i - 1][1];
+            uint32_t t1 = prio_ticket_map[i][1];
+            
+            return p0 + ((tickets - t0) * (p1 - p0)) / (t1 - t0);
+        }
+    }
+    
+    return PRIORITY_MAX;
+}
+
+static inline void dispatch_schedule(sched_cpu_t *cpu) {
+#ifdef SCHED_STATIC_POLICY
+    (void)cpu;
+    SCHED_PROF_VOID(SCHED_PROF_SCHEDULE, SCHED_STATIC_OP(schedule)());
+#else
+    if (classes_enabled) {
+        class_schedule(cpu);
+    } else if (current_scheduler != NULL && current_scheduler->schedule != NULL) {
+        SCHED_PROF_VOID(SCHED_PROF_SCHEDULE, current_scheduler->schedule());
+    } else {
+        cpu_schedule(cpu);
+    }
+#endif
+}
+
+static inline bool dispatch_tick(sched_cpu_t *cpu) {
+#ifdef SCHED_STATIC_POLICY
+    (void)cpu;
+    if (sched_initialized) {
+        SCHED_PROF_VOID(SCHED_PROF_TICK, SCHED_STATIC_OP(tick)());
+        return true;
+    }
+#else
+    if (classes_enabled) {
+        return class_tick(cpu);
+    }
+    
+    if (current_scheduler != NULL && current_scheduler->tick != NULL) {
+        SCHED_PROF_VOID(SCHED_PROF_TICK, current_scheduler->tick());
+        return true;
+    }
+#endif
+    
+    return false;
+}
+
+static inline void dispatch_enqueue(pid32 pid) {
+#ifdef SCHED_STATIC_POLICY
+    if (sched_initialized) {
+        SCHED_PROF_VOID(SCHED_PROF_ENQUEUE, SCHED_STATIC_OP(enqueue)(pid));
+        return;
+    }
+#else
+    if (classes_enabled) {
+        class_enqueue(pid);
+        return;
+    }
+    
+    if (current_scheduler != NULL && current_scheduler->enqueue != NULL) {
+        SCHED_PROF_VOID(SCHED_PROF_ENQUEUE, current_scheduler->enqueue(pid));
+        return;
+    }
+#endif
+    
+    ready_enqueue(pid);
+}
+
+static inline void dispatch_dequeue(pid32 pid) {
+#ifdef SCHED_STATIC_POLICY
+    if (sched_initialized) {
+        SCHED_PROF_VOID(SCHED_PROF_DEQUEUE, SCHED_STATIC_OP(dequeue)(pid));
+        return;
+    }
+#else
+    if (classes_enabled) {
+        class_dequeue(pid);
+        return;
+    }
+    
+    if (current_scheduler != NULL && current_scheduler->dequeue != NULL) {
+        SCHED_PROF_VOID(SCHED_PROF_DEQUEUE, current_scheduler->dequeue(pid));
+        return;
+    }
+#endif
+    
+    ready_dequeue(pid);
+}
+
+static void bw_evict(pid32 pid) {
+    uint32_t i;
+    
+    if (pid < 0 || pid >= NPROC) {
+        return;
+    }
+    
+    dispatch_dequeue(pid);
+    
+    if (proctab[pid].pstate == PR_CURR) {
+        proctab[pid].pstate = PR_READY;
+        
+        proc_mark_queued(pid, sched_clock());
+        
+        for (i = 0; i < SCHED_NCPUS; i++) {
+            if (sched_cpus[i].curr == pid) {
+                cpu_resched(i);
+            }
+        }
+    }
+    
+    bw_park(pid);
+}
+
+static void bw_throttle(int32_t gid) {
+    sched_bw_group_t *group;
+    int32_t stack[SCHED_BW_MAX_GROUPS];
+    int32_t g, child;
+    uint32_t depth;
+    pid32 pid;
+    
+    group = &bw_groups[gid];
+    group->throttled = true;
+    group->throttled_at = system_ticks;
+    group->throttle_count++;
+    bw_nthrottled++;
+    
+    depth = 0;
+    stack[depth++] = gid;
+    while (depth > 0) {
+        g = stack[--depth];
+        
+        for (pid = bw_runnable[g]; pid >= 0; pid = bw_run_next[pid]) {
+            if (bw_parked_on[pid] < 0 &&
+                (proctab[pid].pstate == PR_CURR || proctab[pid].pstate == PR_READY)) {
+                bw_evict(pid);
+            }
+        }
+        
+        for (child = bw_children[g]; child >= 0; child = bw_sibling_next[child]) {
+            stack[depth++] = child;
+        }
+    }
+}
+
+static void bw_refill(int32_t gid) {
+    sched_bw_group_t *group;
+    pid32 pid, next;
+    
+    group = &bw_groups[gid];
+    group->runtime = group->quota;
+    
+    if (group->quota == SCHED_BW_UNLIMITED) {
+        group->next_refill = UINT64_MAX;
+        sched_timer_cancel(&bw_timers[gid]);
+    } else {
+        group->next_refill += group->period;
+        if (group->next_refill <= system_ticks) {
+            group->next_refill = system_ticks + group->period;
+        }
+        sched_timer_arm(&bw_timers[gid], group->next_refill);
+    }
+    
+    if (!group->throttled) {
+        return;
+    }
+    
+    group->throttled = false;
+    group->throttled_ticks += system_ticks - group->throttled_at;
+    bw_nthrottled--;
+    
+    pid = bw_parked[gid];
+    bw_parked[gid] = -1;
+    
+    for (; pid >= 0; pid = next) {
+        next = bw_parked_next[pid];
+        bw_parked_next[pid] = -1;
+        bw_parked_prev[pid] = -1;
+        bw_parked_on[pid] = -1;
+        
+        if (!bw_park(pid)) {
+            wakeup_push(pid);
+        }
+    }
+    
+    sched_set_resched();
+}
+
+static void bw_refill_expire(void *arg) {
+    bw_refill((int32_t)(intptr_t)arg);
+}
+
+static void bw_charge(sched_cpu_t *cpu, uint64_t ticks) {
+    sched_bw_group_t *group;
+    int32_t gid;
+    pid32 pid;
+    
+    pid = cpu->curr;
+    if (pid < 0 || pid >= NPROC || proc_bw[pid] < 0 || proctab[pid].pstate != PR_CURR) {
+        return;
+    }
+    
+    for (gid = proc_bw[pid]; gid >= 0; gid = group->parent) {
+        group = &bw_groups[gid];
+        group->usage += ticks;
+        
+        if (group->quota == SCHED_BW_UNLIMITED) {
+            continue;
+        }
+        
+        group->runtime = (group->runtime > ticks) ? group->runtime - ticks : 0;
+        if (group->runtime == 0 && !group->throttled) {
+            bw_throttle(gid);
+        }
+    }
+}
+
+static uint64_t bw_next_event(sched_cpu_t *cpu) {
+    uint64_t next = SCHED_NO_EVENT;
+    int32_t gid;
+    pid32 pid;
+    
+    pid = cpu->curr;
+    if (pid < 0 || pid >= NPROC || proctab[pid].pstate != PR_CURR) {
+        return next;
+    }
+    
+    for (gid = proc_bw[pid]; gid >= 0; gid = bw_groups[gid].parent) {
+        if (bw_groups[gid].quota != SCHED_BW_UNLIMITED && bw_groups[gid].runtime < next) {
+            next = bw_groups[gid].runtime;
+        }
+    }
+    
+    return next;
+}
+
+static void bw_detach(pid32 pid) {
+    int32_t gid;
+    
+    bw_unpark(pid);
+    
+    gid = proc_bw[pid];
+    if (gid < 0) {
+        return;
+    }
+    
+    if (proc_active[pid]) {
+        bw_unlink(&bw_runnable[gid], bw_run_next, bw_run_prev, pid);
+    }
+    bw_groups[gid].nmembers--;
+    proc_bw[pid] = -1;
+}
+
+syscall sched_bw_create(int32_t parent, uint64_t quota, uint64_t period) {
+    sched_bw_group_t *group;
+    int32_t gid;
+    intmask mask;
+    
+    if (parent < -1 || parent >= SCHED_BW_MAX_GROUPS ||
+        (quota != SCHED_BW_UNLIMITED && (quota == 0 || period == 0))) {
+        return SYSERR;
+    }
+    
+    mask = disable();
+    
+    if (parent >= 0 && !bw_groups[parent].used) {
+        restore(mask);
+        return SYSERR;
+    }
+    
+    for (gid = 0; gid < SCHED_BW_MAX_GROUPS && bw_groups[gid].used; gid++) {
+    }
+    
+    if (gid == SCHED_BW_MAX_GROUPS) {
+        restore(mask);
+        return SYSERR;
+    }
+    
+    group = &bw_groups[gid];
+    memset(group, 0, sizeof(sched_bw_group_t));
+    group->used = true;
+    group->parent = parent;
+    group->quota = quota;
+    group->period = period;
+    group->runtime = quota;
+    group->next_refill = (quota == SCHED_BW_UNLIMITED) ? UINT64_MAX : system_ticks + period;
+    bw_children[gid] = -1;
+    bw_runnable[gid] = -1;
+    bw_parked[gid] = -1;
+    
+    if (parent >= 0) {
+        bw_groups[parent].nchildren++;
+        bw_sibling_next[gid] = bw_children[parent];
+        bw_children[parent] = gid;
+    }
+    
+    sched_timer_setup(&bw_timers[gid], bw_refill_expire, (void *)(intptr_t)gid);
+    if (quota != SCHED_BW_UNLIMITED) {
+        sched_timer_arm(&bw_timers[gid], group->next_refill);
+    }
+    
+    restore(mask);
+    
+    return gid;
+}
+
+syscall sched_bw_destroy(int32_t gid) {
+    sched_bw_group_t *group;
+    int32_t *link;
+    intmask mask;
+    
+    if (gid < 0 || gid >= SCHED_BW_MAX_GROUPS) {
+        return SYSERR;
+    }
+    
+    mask = disable();
+    
+    group = &bw_groups[gid];
+    if (!group->used || group->nmembers > 0 || group->nchildren > 0) {
+        restore(mask);
+        return SYSERR;
+    }
+    
+    if (group->throttled) {
+        bw_nthrottled--;
+    }
+    
+    if (group->parent >= 0) {
+        bw_groups[group->parent].nchildren--;
+        for (link = &bw_children[group->parent]; *link != gid; link = &bw_sibling_next[*link]) {
+        }
+        *link = bw_sibling_next[gid];
+    }
+    
+    sched_timer_cancel(&bw_timers[gid]);
+    group->used = false;
+    
+    restore(mask);
+    
+    return OK;
+}
+
+syscall sched_bw_set(int32_t gid, uint64_t quota, uint64_t period) {
+    sched_bw_group_t *group;
+    intmask mask;
     
-    if (ready_queue.tail != NULL) {
-        ready_queue.tail->next = node;
-    } else {
-        ready_queue.head = node;
+    if (gid < 0 || gid >= SCHED_BW_MAX_GROUPS ||
+        (quota != SCHED_BW_UNLIMITED && (quota == 0 || period == 0))) {
+        return SYSERR;
     }
     
-    ready_queue.tail = node;
-    ready_queue.count++;
+    mask = disable();
     
-    sched_stats.runnable_count++;
-    if (sched_stats.runnable_count > sched_stats.max_runnable) {
-        sched_stats.max_runnable = sched_stats.runnable_count;
+    group = &bw_groups[gid];
+    if (!group->used) {
+        restore(mask);
+        return SYSERR;
     }
     
+    group->quota = quota;
+    group->period = period;
+    group->next_refill = system_ticks;
+    bw_refill(gid);
+    
     restore(mask);
+    
+    return OK;
 }
 
-void ready_dequeue(pid32 pid) {
-    ready_node_t *node;
+syscall sched_bw_attach(pid32 pid, int32_t gid) {
+    bool parked;
     intmask mask;
     
-    if (pid < 0 || pid >= NPROC) {
-        return;
+    if (pid < 0 || pid >= NPROC || gid < -1 || gid >= SCHED_BW_MAX_GROUPS) {
+        return SYSERR;
     }
     
     mask = disable();
     
-    node = ready_queue.head;
-    while (node != NULL && node->pid != pid) {
-        node = node->next;
+    if (gid >= 0 && !bw_groups[gid].used) {
+        restore(mask);
+        return SYSERR;
     }
     
-    if (node == NULL) {
+    if (proc_bw[pid] == gid) {
         restore(mask);
-        return;
+        return OK;
     }
     
-    if (node->prev != NULL) {
-        node->prev->next = node->next;
-    } else {
-        ready_queue.head = node->next;
-    }
+    parked = bw_parked_on[pid] >= 0;
+    bw_detach(pid);
     
-    if (node->next != NULL) {
-        node->next->prev = node->prev;
-    } else {
-        ready_queue.tail = node->prev;
+    if (gid >= 0) {
+        proc_bw[pid] = gid;
+        if (proc_active[pid]) {
+            bw_link(&bw_runnable[gid], bw_run_next, bw_run_prev, pid);
+        }
+        bw_groups[gid].nmembers++;
     }
     
-    ready_queue.count--;
-    sched_stats.runnable_count--;
-    
-    node_free(node);
+    if (parked) {
+        if (!bw_park(pid)) {
+            wakeup_push(pid);
+            sched_set_resched();
+        }
+    } else if ((proctab[pid].pstate == PR_CURR || proctab[pid].pstate == PR_READY) &&
+               bw_throttled_group(pid) >= 0) {
+        bw_evict(pid);
+    }
     
     restore(mask);
+    
+    return OK;
 }
 
-pid32 ready_peek(void) {
-    if (ready_queue.head == NULL) {
+int32_t sched_bw_group_of(pid32 pid) {
+    if (pid < 0 || pid >= NPROC) {
         return -1;
     }
-    return ready_queue.head->pid;
+    
+    return proc_bw[pid];
 }
 
-pid32 ready_pop(void) {
-    ready_node_t *node;
-    pid32 pid;
+syscall sched_bw_get(int32_t gid, sched_bw_group_t *group) {
     intmask mask;
     
-    mask = disable();
-    
-    if (ready_queue.head == NULL) {
-        restore(mask);
-        return -1;
+    if (gid < 0 || gid >= SCHED_BW_MAX_GROUPS || group == NULL) {
+        return SYSERR;
     }
     
-    node = ready_queue.head;
-    pid = node->pid;
+    mask = disable();
     
-    ready_queue.head = node->next;
-    if (ready_queue.head != NULL) {
-        ready_queue.head->prev = NULL;
-    } else {
-        ready_queue.tail = NULL;
+    if (!bw_groups[gid].used) {
+        restore(mask);
+        return SYSERR;
     }
     
-    ready_queue.count--;
-    sched_stats.runnable_count--;
-    
-    node_free(node);
+    memcpy(group, &bw_groups[gid], sizeof(sched_bw_group_t));
     
     restore(mask);
     
-    return pid;
-}
-
-bool ready_queue_empty(void) {
-    return ready_queue.head == NULL;
-}
-
-uint32_t ready_queue_count(void) {
-    return ready_queue.count;
+    return OK;
 }
 
-void scheduler_init(scheduler_type_t type) {
-    int i;
+void sched_bw_print(void) {
+    sched_bw_group_t *group;
+    int32_t gid;
     intmask mask;
     
     mask = disable();
     
-    ready_queue_init();
+    kprintf("\n=== Bandwidth Groups ===\n");
+    kprintf("Group  Parent  Quota/Period  Members  Usage      Throttles  Throttled\n");
+    kprintf("-----  ------  ------------  -------  ---------  ---------  ---------\n");
     
-    memset(&sched_stats, 0, sizeof(sched_stats));
-    for (i = 0; i < NPROC; i++) {
-        memset(&proc_stats[i], 0, sizeof(sched_proc_stats_t));
+    for (gid = 0; gid < SCHED_BW_MAX_GROUPS; gid++) {
+        group = &bw_groups[gid];
+        if (!group->used) {
+            continue;
+        }
+        
+        if (group->quota == SCHED_BW_UNLIMITED) {
+            kprintf("%5d  %6d  %12s", gid, group->parent, "unlimited");
+        } else {
+            kprintf("%5d  %6d  %5llu/%-6llu", gid, group->parent,
+                    group->quota, group->period);
+        }
+        kprintf("  %7u  %9llu  %9llu  %9llu%s\n", group->nmembers, group->usage,
+                group->throttle_count, group->throttled_ticks,
+                group->throttled ? " *" : "");
     }
     
-    sched_lock = semcreate(1);
-    
-    sched_policy = type;
-    
-    switch (type) {
-        case SCHEDULER_ROUND_ROBIN:
-            round_robin_init();
-            current_scheduler = round_robin_get_ops();
-            break;
-            
-        case SCHEDULER_PRIORITY:
-            priority_init();
-            current_scheduler = priority_get_ops();
-            break;
-            
-        case SCHEDULER_MLFQ:
-            mlfq_init();
-            current_scheduler = mlfq_get_ops();
-            break;
-            
-        case SCHEDULER_LOTTERY:
-            lottery_init();
-            current_scheduler = lottery_get_ops();
-            break;
-            
-        case SCHEDULER_CFS:
-            cfs_init();
-            current_scheduler = cfs_get_ops();
-            break;
-            
-        case SCHEDULER_EDF:
-            realtime_init();
-            current_scheduler = realtime_get_ops();
-            break;
-            
-        default:
+    restore(mask);
+}
 
-            priority_init();
-            current_scheduler = priority_get_ops();
-            sched_policy = SCHEDULER_PRIORITY;
-            break;
+static void tickless_catchup(sched_cpu_t *cpu, uint64_t ticks) {
+    if (classes_enabled && class_catchup(cpu, ticks)) {
+        return;
     }
     
-    sched_initialized = true;
-    
-    restore(mask);
-    
-    kprintf("Scheduler initialized: %s\n", current_scheduler->name);
+    if (!classes_enabled && current_scheduler != NULL && current_scheduler->tick != NULL) {
+        if (current_scheduler->catchup != NULL) {
+            current_scheduler->catchup(ticks);
+        }
+    } else if (cpu->quantum_remaining > ticks) {
+        cpu->quantum_remaining -= ticks;
+    } else if (cpu->quantum_remaining > 0) {
+        cpu->quantum_remaining = 1;
+    }
 }
 
-void scheduler_shutdown(void) {
-    intmask mask;
+static void tickless_account(uint64_t ticks) {
+    sched_cpu_t *cpu;
     
-    mask = disable();
+    if (ticks == 0) {
+        return;
+    }
     
-    if (current_scheduler != NULL && current_scheduler->shutdown != NULL) {
-        current_scheduler->shutdown();
+    cpu = sched_this_cpu();
+    
+    if (cpu->id == 0) {
+        system_ticks += ticks;
+        clock_stamp_tick();
+        loadavg_sample();
     }
     
-    sched_initialized = false;
+    if (cpu->curr >= 0 && cpu->curr < NPROC) {
+        stats_write_begin(cpu->curr, false);
+        proc_hot[cpu->curr].total_runtime += ticks;
+        proc_hot[cpu->curr].last_runtime += ticks;
+        stats_write_end(cpu->curr, false);
+    }
     
-    restore(mask);
-}
-
-syscall scheduler_switch(scheduler_type_t type) {
-    intmask mask;
+    bw_charge(cpu, ticks);
     
-    mask = disable();
+    tickless_catchup(cpu, ticks);
     
-    if (current_scheduler != NULL && current_scheduler->shutdown != NULL) {
-        current_scheduler->shutdown();
+    if (cpu->id == 0) {
+        timer_expire(cpu);
     }
+}
+
+static void tickless_program(void) {
+    uint64_t next;
     
-    switch (type) {
-        case SCHEDULER_ROUND_ROBIN:
-            round_robin_init();
-            current_scheduler = round_robin_get_ops();
-            break;
-            
-        case SCHEDULER_PRIORITY:
-            priority_init();
-            current_scheduler = priority_get_ops();
-            break;
-            
-        case SCHEDULER_MLFQ:
-            mlfq_init();
-            current_scheduler = mlfq_get_ops();
-            break;
-            
-        case SCHEDULER_LOTTERY:
-            lottery_init();
-            current_scheduler = lottery_get_ops();
-            break;
-            
-        case SCHEDULER_CFS:
-            cfs_init();
-            current_scheduler = cfs_get_ops();
-            break;
-            
-        case SCHEDULER_EDF:
-            realtime_init();
-            current_scheduler = realtime_get_ops();
-            break;
-            
-        default:
-            restore(mask);
-            return SYSERR;
+    next = sched_next_event();
+    if (next > SCHED_TICKLESS_MAX) {
+        next = SCHED_TICKLESS_MAX;
     }
     
-    sched_policy = type;
-    
-    restore(mask);
+    tickless_account(clkoneshot(next));
+}
+
+static void tickless_sync(void) {
+    if (tickless_mode) {
+        tickless_account(clkoneshot(1));
+    }
+}
+
+static void cpu_idle_update(sched_cpu_t *cpu) {
+    uint64_t idle;
     
-    kprintf("Scheduler switched to: %s\n", current_scheduler->name);
+    if (!cpu_busy(cpu)) {
+        sched_idle_enter(cpu->id, system_ticks, sched_next_event());
+        return;
+    }
     
-    return OK;
+    idle = sched_idle_exit(cpu->id, system_ticks);
+    if (idle > 0) {
+        stats_write_begin(-1, true);
+        sched_stats.idle_time += idle;
+        stats_write_end(-1, true);
+    }
 }
 
 void schedule(void) {
+    sched_cpu_t *cpu;
     intmask mask;
+    bool forced;
     
-    if (!sched_initialized || current_scheduler == NULL) {
+    if (!sched_initialized) {
         return;
     }
     
     mask = disable();
     
+    cpu = sched_this_cpu();
+    
+    stats_write_begin(-1, true);
     sched_stats.total_schedules++;
+    stats_write_end(-1, true);
+    forced = cpu->need_resched;
+    cpu->need_resched = false;
     need_resched = false;
     
-    if (current_scheduler->schedule != NULL) {
-        current_scheduler->schedule();
+    tickless_sync();
+    
+    if (wakeup_drain(cpu) || forced || !cpu_busy(cpu)) {
+        dispatch_schedule(cpu);
+    }
+    
+    if (cpu->curr >= 0 && cpu->curr < NPROC && proctab[cpu->curr].pstate == PR_READY &&
+        bw_parked_on[cpu->curr] < 0) {
+        proctab[cpu->curr].pstate = PR_CURR;
     }
     
+    cpu_idle_update(cpu);
+    
     restore(mask);
 }
 
@@ -373,7 +2732,7 @@ void resched(void) {
     
     mask = disable();
     
-    need_resched = true;
+    sched_set_resched();
     
     schedule();
     
@@ -381,20 +2740,29 @@ void resched(void) {
 }
 
 void yield(void) {
+    scheduler_ops_t *ops;
+    pid32 pid;
     intmask mask;
     
     mask = disable();
     
+    pid = sched_this_cpu()->curr;
+    
+    stats_write_begin(pid, true);
     sched_stats.voluntary_yields++;
-    proc_stats[currpid].voluntary_switches++;
+    if (pid >= 0 && pid < NPROC) {
+        proc_cold[pid].voluntary_switches++;
+    }
+    stats_write_end(pid, true);
     
-    if (current_scheduler != NULL && current_scheduler->yield != NULL) {
-        current_scheduler->yield();
+    ops = policy_ops(pid);
+    if (ops != NULL && ops->yield != NULL) {
+        ops->yield();
     } else {
 
-        if (proctab[currpid].pstate == PR_CURR) {
-            proctab[currpid].pstate = PR_READY;
-            ready_enqueue(currpid);
+        if (pid >= 0 && pid < NPROC && proctab[pid].pstate == PR_CURR) {
+            proctab[pid].pstate = PR_READY;
+            ready_enqueue(pid);
         }
         resched();
     }
@@ -403,20 +2771,29 @@ void yield(void) {
 }
 
 void preempt(void) {
+    scheduler_ops_t *ops;
+    pid32 pid;
     intmask mask;
     
     mask = disable();
     
+    pid = sched_this_cpu()->curr;
+    
+    stats_write_begin(pid, true);
     sched_stats.preemptions++;
-    proc_stats[currpid].involuntary_switches++;
+    if (pid >= 0 && pid < NPROC) {
+        proc_cold[pid].involuntary_switches++;
+    }
+    stats_write_end(pid, true);
     
-    if (current_scheduler != NULL && current_scheduler->preempt != NULL) {
-        current_scheduler->preempt();
+    ops = policy_ops(pid);
+    if (ops != NULL && ops->preempt != NULL) {
+        ops->preempt();
     } else {
 
-        if (proctab[currpid].pstate == PR_CURR) {
-            proctab[currpid].pstate = PR_READY;
-            ready_enqueue(currpid);
+        if (pid >= 0 && pid < NPROC && proctab[pid].pstate == PR_CURR) {
+            proctab[pid].pstate = PR_READY;
+            ready_enqueue(pid);
         }
         resched();
     }
@@ -425,6 +2802,7 @@ void preempt(void) {
 }
 
 syscall setpriority(pid32 pid, uint32_t priority) {
+    scheduler_ops_t *ops;
     uint32_t old_priority;
     intmask mask;
     
@@ -445,8 +2823,11 @@ syscall setpriority(pid32 pid, uint32_t priority) {
     
     old_priority = proctab[pid].pprio;
     
-    if (current_scheduler != NULL && current_scheduler->set_priority != NULL) {
-        current_scheduler->set_priority(pid, priority);
+    sched_trace_emit(TRACE_PRIORITY, pid, (old_priority << 16) | priority);
+    
+    ops = policy_ops(pid);
+    if (ops != NULL && ops->set_priority != NULL) {
+        SCHED_PROF_VOID(SCHED_PROF_SET_PRIORITY, ops->set_priority(pid, priority));
     } else {
         proctab[pid].pprio = priority;
     }
@@ -461,6 +2842,7 @@ syscall setpriority(pid32 pid, uint32_t priority) {
 }
 
 syscall getpriority(pid32 pid) {
+    scheduler_ops_t *ops;
     intmask mask;
     uint32_t priority;
     
@@ -475,8 +2857,9 @@ syscall getpriority(pid32 pid) {
         return SYSERR;
     }
     
-    if (current_scheduler != NULL && current_scheduler->get_priority != NULL) {
-        priority = current_scheduler->get_priority(pid);
+    ops = policy_ops(pid);
+    if (ops != NULL && ops->get_priority != NULL) {
+        priority = ops->get_priority(pid);
     } else {
         priority = proctab[pid].pprio;
     }
@@ -488,11 +2871,14 @@ syscall getpriority(pid32 pid) {
 
 syscall nice(int32_t increment) {
     int32_t new_priority;
+    pid32 pid;
     intmask mask;
     
     mask = disable();
     
-    new_priority = (int32_t)proctab[currpid].pprio - increment;
+    pid = sched_this_cpu()->curr;
+    
+    new_priority = (int32_t)proctab[pid].pprio - increment;
     
     if (new_priority < PRIORITY_MIN) {
         new_priority = PRIORITY_MIN;
@@ -501,7 +2887,7 @@ syscall nice(int32_t increment) {
         new_priority = PRIORITY_MAX;
     }
     
-    proctab[currpid].pprio = new_priority;
+    proctab[pid].pprio = new_priority;
     
     restore(mask);
     
@@ -516,90 +2902,302 @@ void sched_set_quantum(uint32_t quantum) {
         quantum = MAX_QUANTUM;
     }
     
-    current_quantum = quantum;
+    current_quantum = quantum;
+    
+    if (current_scheduler != NULL && current_scheduler->set_quantum != NULL) {
+        current_scheduler->set_quantum(quantum);
+    }
+}
+
+uint32_t sched_get_quantum(void) {
+    if (current_scheduler != NULL && current_scheduler->get_quantum != NULL) {
+        return current_scheduler->get_quantum();
+    }
+    return current_quantum;
+}
+
+void sched_tick(void) {
+    sched_cpu_t *cpu;
+    intmask mask;
+    
+    mask = disable();
+    
+    cpu = sched_this_cpu();
+    
+    if (cpu->id == 0) {
+        system_ticks++;
+        clock_stamp_tick();
+        loadavg_sample();
+        
+        if (gang_count > 0 && system_ticks >= gang_slot_end) {
+            gang_rotate();
+        }
+    }
+    
+    if (cpu->curr >= 0 && cpu->curr < NPROC) {
+        stats_write_begin(cpu->curr, false);
+        proc_hot[cpu->curr].total_runtime++;
+        proc_hot[cpu->curr].last_runtime++;
+        stats_write_end(cpu->curr, false);
+    }
+    
+    bw_charge(cpu, 1);
+    
+#if SCHED_NCPUS > 1
+    if (balance_enabled && system_ticks >= cpu->next_balance) {
+        cpu->next_balance = system_ticks + SCHED_BALANCE_INTERVAL;
+        sched_balance(cpu->id);
+    }
+#endif
+    
+    if (!dispatch_tick(cpu)) {
+
+        if (cpu->quantum_remaining > 0) {
+            cpu->quantum_remaining--;
+        }
+        
+        if (cpu->quantum_remaining == 0) {
+            stats_write_begin(-1, true);
+            sched_stats.quantum_expirations++;
+            stats_write_end(-1, true);
+            sched_trace_emit(TRACE_QUANTUM, cpu->curr, current_quantum);
+            cpu->quantum_remaining = current_quantum;
+            sched_set_resched();
+        }
+    }
+    
+    if (cpu->id == 0) {
+        timer_expire(cpu);
+    }
+    
+    if (tickless_mode) {
+        tickless_program();
+    }
+    
+    restore(mask);
+}
+
+uint64_t sched_get_time(void) {
+    return system_ticks;
+}
+
+uint64_t sched_clock(void) {
+    uint64_t now, delta, last;
+    
+    now = system_ticks * SCHED_TICK_NS;
+    
+    if (clock_source != NULL) {
+        delta = clock_source() - __atomic_load_n(&clock_stamp, __ATOMIC_RELAXED);
+        now += (delta < SCHED_TICK_NS) ? delta : SCHED_TICK_NS - 1;
+    }
+    
+    last = __atomic_load_n(&clock_last, __ATOMIC_RELAXED);
+    do {
+        if (now <= last) {
+            return last;
+        }
+    } while (!__atomic_compare_exchange_n(&clock_last, &last, now, true,
+                                          __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+    
+    return now;
+}
+
+void sched_clock_set_source(sched_clock_source_t source) {
+    intmask mask;
+    
+    mask = disable();
+    clock_source = source;
+    clock_stamp_tick();
+    restore(mask);
+}
+
+void sched_tickless_enable(bool enable) {
+    intmask mask;
+    
+    mask = disable();
+    
+    tickless_mode = enable;
+    
+    if (tickless_mode) {
+        tickless_program();
+    }
+    
+    restore(mask);
+}
+
+bool sched_tickless_enabled(void) {
+    return tickless_mode;
+}
+
+uint64_t sched_next_event(void) {
+    sched_cpu_t *cpu;
+    uint64_t next, bw, timer;
+    
+    cpu = sched_this_cpu();
+    
+    if (classes_enabled) {
+        next = class_next_event(cpu);
+    } else if (current_scheduler != NULL && current_scheduler->tick != NULL) {
+        if (current_scheduler->next_event == NULL) {
+            return 1;
+        }
+        next = current_scheduler->next_event();
+    } else if (cpu->rq.count > 0) {
+        next = cpu->quantum_remaining;
+    } else {
+        next = SCHED_NO_EVENT;
+    }
+    
+    bw = bw_next_event(cpu);
+    if (bw < next) {
+        next = bw;
+    }
     
-    if (current_scheduler != NULL && current_scheduler->set_quantum != NULL) {
-        current_scheduler->set_quantum(quantum);
+    if (cpu->id == 0) {
+        timer = sched_timer_next();
+        if (timer != SCHED_NO_EVENT) {
+            timer = (timer > system_ticks) ? timer - system_ticks : 1;
+            if (timer < next) {
+                next = timer;
+            }
+        }
     }
+    
+    return (next == 0) ? 1 : next;
 }
 
-uint32_t sched_get_quantum(void) {
-    if (current_scheduler != NULL && current_scheduler->get_quantum != NULL) {
-        return current_scheduler->get_quantum();
+void sched_tick_catchup(uint64_t elapsed) {
+    intmask mask;
+    
+    if (elapsed == 0) {
+        return;
     }
-    return current_quantum;
+    
+    mask = disable();
+    
+    tickless_account(elapsed - 1);
+    
+    restore(mask);
+    
+    sched_tick();
 }
 
-void sched_tick(void) {
+void sched_ready(pid32 pid) {
     intmask mask;
     
+    if (pid < 0 || pid >= NPROC) {
+        return;
+    }
+    
     mask = disable();
     
-    system_ticks++;
+    sched_trace_emit(TRACE_ENQUEUE, pid, proctab[pid].pprio);
     
-    if (currpid >= 0 && currpid < NPROC) {
-        proc_stats[currpid].total_runtime++;
-        proc_stats[currpid].last_runtime++;
-    }
+    stats_write_begin(pid, false);
+    proc_hot[pid].ready_since = sched_clock();
+    proc_hot[pid].queued = true;
+    stats_write_end(pid, false);
     
-    if (current_scheduler != NULL && current_scheduler->tick != NULL) {
-        current_scheduler->tick();
-    } else {
-
-        if (quantum_remaining > 0) {
-            quantum_remaining--;
-        }
-        
-        if (quantum_remaining == 0) {
-            sched_stats.quantum_expirations++;
-            quantum_remaining = current_quantum;
-            need_resched = true;
+    active_set(pid, true);
+    
+    if (!bw_park(pid)) {
+        dispatch_enqueue(pid);
+        if (preempt_wakeup(sched_this_cpu(), pid)) {
+            sched_set_resched();
         }
     }
     
+    tickless_sync();
+    
     restore(mask);
 }
 
-uint64_t sched_get_time(void) {
-    return system_ticks;
-}
-
-void sched_ready(pid32 pid) {
+void sched_ready_batch(const pid32 *pids, uint32_t n) {
+    sched_hint_t batch[SCHED_READY_BATCH];
+    uint32_t i, count;
+    uint64_t now;
+    pid32 pid;
     intmask mask;
+    bool preempt;
     
-    if (pid < 0 || pid >= NPROC) {
+    if (pids == NULL || n == 0) {
         return;
     }
     
     mask = disable();
     
-    if (current_scheduler != NULL && current_scheduler->enqueue != NULL) {
-        current_scheduler->enqueue(pid);
-    } else {
-        ready_enqueue(pid);
+    now = sched_clock();
+    
+    preempt = false;
+    count = 0;
+    for (i = 0; i < n; i++) {
+        pid = pids[i];
+        if (pid < 0 || pid >= NPROC) {
+            continue;
+        }
+        
+        sched_trace_emit(TRACE_ENQUEUE, pid, proctab[pid].pprio);
+        
+        stats_write_begin(pid, false);
+        proc_hot[pid].ready_since = now;
+        proc_hot[pid].queued = true;
+        stats_write_end(pid, false);
+        
+        active_set(pid, true);
+        
+        if (bw_park(pid)) {
+            continue;
+        }
+        
+        batch[count].pid = pid;
+        batch[count].priority = SCHED_HINT_NONE;
+        count++;
+        
+        if (count == SCHED_READY_BATCH) {
+            policy_adopt(batch, count);
+            preempt = preempt || batch_preempts(sched_this_cpu(), batch, count);
+            count = 0;
+        }
+    }
+    
+    if (count > 0) {
+        policy_adopt(batch, count);
+        preempt = preempt || batch_preempts(sched_this_cpu(), batch, count);
+    }
+    
+    if (preempt) {
+        sched_set_resched();
     }
     
+    tickless_sync();
+    
     restore(mask);
 }
 
 void sched_block(pid32 pid) {
     intmask mask;
     
+    mask = disable();
+    
     if (pid < 0 || pid >= NPROC) {
+        restore(mask);
         return;
     }
     
-    mask = disable();
+    sched_trace_emit(TRACE_DEQUEUE, pid, proctab[pid].pstate);
     
+    stats_write_begin(pid, true);
     sched_stats.blocked_count++;
+    proc_hot[pid].queued = false;
+    stats_write_end(pid, true);
     
-    if (current_scheduler != NULL && current_scheduler->dequeue != NULL) {
-        current_scheduler->dequeue(pid);
-    } else {
-        ready_dequeue(pid);
-    }
+    active_set(pid, false);
     
-    if (pid == currpid) {
+    dispatch_dequeue(pid);
+    
+    bw_unpark(pid);
+    
+    if (pid == sched_this_cpu()->curr) {
         resched();
     }
     
@@ -613,23 +3211,76 @@ void sched_wakeup(pid32 pid) {
         return;
     }
     
-    mask = disable();
+    proctab[pid].pstate = PR_READY;
     
+    sched_trace_emit(TRACE_WAKEUP, pid, 0);
+    sched_wlat_wakeup(pid);
+    
+    mask = disable();
+    stats_write_begin(pid, true);
     sched_stats.blocked_count--;
+    proc_hot[pid].woken_at = sched_clock();
+    proc_hot[pid].ready_since = proc_hot[pid].woken_at;
+    proc_hot[pid].woken = true;
+    proc_hot[pid].queued = true;
+    stats_write_end(pid, true);
+    active_set(pid, true);
+    restore(mask);
     
-    proctab[pid].pstate = PR_READY;
+    wakeup_push(pid);
     
-    if (current_scheduler != NULL && current_scheduler->enqueue != NULL) {
-        current_scheduler->enqueue(pid);
-    } else {
-        ready_enqueue(pid);
+    need_resched = true;
+}
+
+syscall sched_sleep(pid32 pid, uint64_t ticks) {
+    intmask mask;
+    
+    if (pid <= NULLPROC || pid >= NPROC || ticks == 0) {
+        return SYSERR;
     }
     
-    if (proctab[pid].pprio > proctab[currpid].pprio) {
-        need_resched = true;
+    mask = disable();
+    
+    if (proctab[pid].pstate == PR_FREE || proctab[pid].pstate == PR_SLEEP) {
+        restore(mask);
+        return SYSERR;
+    }
+    
+    proctab[pid].pstate = PR_SLEEP;
+    
+    stats_write_begin(pid, false);
+    proc_cold[pid].sleep_since = system_ticks;
+    stats_write_end(pid, false);
+    
+    sched_timer_arm(&sleep_timers[pid], system_ticks + ticks);
+    
+    sched_block(pid);
+    
+    restore(mask);
+    
+    return OK;
+}
+
+syscall sched_unsleep(pid32 pid) {
+    intmask mask;
+    
+    if (pid < 0 || pid >= NPROC) {
+        return SYSERR;
+    }
+    
+    mask = disable();
+    
+    if (!sched_timer_cancel(&sleep_timers[pid])) {
+        restore(mask);
+        return SYSERR;
     }
     
+    sleep_account(pid);
+    sched_wakeup(pid);
+    
     restore(mask);
+    
+    return OK;
 }
 
 void sched_new_process(pid32 pid) {
@@ -641,7 +3292,19 @@ void sched_new_process(pid32 pid) {
     
     mask = disable();
     
-    memset(&proc_stats[pid], 0, sizeof(sched_proc_stats_t));
+    stats_write_begin(pid, false);
+    proc_stats_clear(pid);
+    proc_hot[pid].util = 0;
+    proc_hot[pid].util_stamp = (uint32_t)system_ticks;
+    proc_cold[pid].start_time = sched_clock();
+    stats_write_end(pid, false);
+    
+    if (!class_runnable[pid]) {
+        proc_class[pid] = SCHED_CLASS_FAIR;
+    }
+    
+    proc_affinity[pid] = SCHED_CPUMASK_ALL;
+    proc_last_cpu[pid] = -1;
     
     restore(mask);
 }
@@ -655,13 +3318,25 @@ void sched_exit(pid32 pid) {
     
     mask = disable();
     
-    if (current_scheduler != NULL && current_scheduler->dequeue != NULL) {
-        current_scheduler->dequeue(pid);
-    } else {
-        ready_dequeue(pid);
-    }
+    sched_trace_emit(TRACE_DEQUEUE, pid, proctab[pid].pstate);
+    
+    stats_write_begin(pid, true);
+    latency_record(pid, SCHED_LAT_TURNAROUND, sched_clock() - proc_cold[pid].start_time);
+    proc_hot[pid].queued = false;
+    proc_hot[pid].woken = false;
+    stats_write_end(pid, true);
+    
+    active_set(pid, false);
+    
+    dispatch_dequeue(pid);
     
-    if (pid == currpid) {
+    sched_timer_cancel(&sleep_timers[pid]);
+    
+    gang_remove(pid);
+    
+    bw_detach(pid);
+    
+    if (pid == sched_this_cpu()->curr) {
         resched();
     }
     
@@ -669,33 +3344,107 @@ void sched_exit(pid32 pid) {
 }
 
 void sched_get_stats(sched_stats_t *stats) {
-    intmask mask;
+    uint32_t seq;
     
     if (stats == NULL) {
         return;
     }
     
-    mask = disable();
-    
-    if (current_scheduler != NULL && current_scheduler->get_stats != NULL) {
-        current_scheduler->get_stats(stats);
-    } else {
+    do {
+        seq = stats_read_begin(&stats_seq);
         memcpy(stats, &sched_stats, sizeof(sched_stats_t));
+    } while (stats_read_retry(&stats_seq, seq));
+}
+
+static void proc_stats_snapshot(pid32 pid, sched_proc_stats_t *stats) {
+    uint32_t seq, util, util_stamp;
+    
+    do {
+        seq = stats_read_begin(&proc_hot[pid].seq);
+    
+        stats->total_runtime = proc_hot[pid].total_runtime;
+        stats->last_runtime = proc_hot[pid].last_runtime;
+        stats->last_scheduled = proc_hot[pid].last_scheduled;
+        stats->ready_since = proc_hot[pid].ready_since;
+        stats->woken_at = proc_hot[pid].woken_at;
+        stats->context_switches = proc_hot[pid].context_switches;
+        stats->times_scheduled = proc_hot[pid].times_scheduled;
+        stats->queued = proc_hot[pid].queued;
+        stats->woken = proc_hot[pid].woken;
+        util = proc_hot[pid].util;
+        util_stamp = proc_hot[pid].util_stamp;
+    
+        stats->total_waittime = proc_cold[pid].total_waittime;
+        stats->total_sleeptime = proc_cold[pid].total_sleeptime;
+        stats->voluntary_switches = proc_cold[pid].voluntary_switches;
+        stats->involuntary_switches = proc_cold[pid].involuntary_switches;
+        stats->time_slices = proc_cold[pid].time_slices;
+        stats->start_time = proc_cold[pid].start_time;
+        memcpy(stats->latency, proc_cold[pid].latency, sizeof(stats->latency));
+    } while (stats_read_retry(&proc_hot[pid].seq, seq));
+    
+    stats->cpu_util = util_project(util, (uint32_t)system_ticks - util_stamp, proc_running(pid));
+}
+
+void sched_get_proc_stats(pid32 pid, sched_proc_stats_t *stats) {
+    if (pid < 0 || pid >= NPROC || stats == NULL) {
+        return;
     }
     
-    restore(mask);
+    proc_stats_snapshot(pid, stats);
 }
 
-void sched_get_proc_stats(pid32 pid, sched_proc_stats_t *stats) {
-    intmask mask;
+uint32_t sched_get_all_proc_stats(sched_proc_snapshot_t *out, uint32_t max) {
+    uint32_t count;
+    pid32 pid;
     
-    if (pid < 0 || pid >= NPROC || stats == NULL) {
+    if (out == NULL) {
+        return 0;
+    }
+    
+    count = 0;
+    for (pid = 0; pid < NPROC && count < max; pid++) {
+        if (__atomic_load_n(&proctab[pid].pstate, __ATOMIC_RELAXED) == PR_FREE) {
+            continue;
+        }
+    
+        out[count].pid = pid;
+        proc_stats_snapshot(pid, &out[count].stats);
+        count++;
+    }
+    
+    return count;
+}
+
+void sched_get_loadavg(uint32_t avg[3]) {
+    uint32_t seq;
+    
+    if (avg == NULL) {
         return;
     }
     
-    mask = disable();
-    memcpy(stats, &proc_stats[pid], sizeof(sched_proc_stats_t));
-    restore(mask);
+    do {
+        seq = stats_read_begin(&stats_seq);
+        avg[0] = loadavg[0];
+        avg[1] = loadavg[1];
+        avg[2] = loadavg[2];
+    } while (stats_read_retry(&stats_seq, seq));
+}
+
+uint32_t sched_get_util(pid32 pid) {
+    uint32_t seq, util, util_stamp;
+    
+    if (pid < 0 || pid >= NPROC) {
+        return 0;
+    }
+    
+    do {
+        seq = stats_read_begin(&proc_hot[pid].seq);
+        util = proc_hot[pid].util;
+        util_stamp = proc_hot[pid].util_stamp;
+    } while (stats_read_retry(&proc_hot[pid].seq, seq));
+    
+    return util_project(util, (uint32_t)system_ticks - util_stamp, proc_running(pid));
 }
 
 void sched_reset_stats(void) {
@@ -708,11 +3457,22 @@ void sched_reset_stats(void) {
         current_scheduler->reset_stats();
     }
     
+    stats_write_begin(-1, true);
     memset(&sched_stats, 0, sizeof(sched_stats));
+    stats_write_end(-1, true);
+    
     for (i = 0; i < NPROC; i++) {
-        memset(&proc_stats[i], 0, sizeof(sched_proc_stats_t));
+        stats_write_begin(i, false);
+        proc_stats_clear(i);
+        stats_write_end(i, false);
     }
     
+    sched_wlat_reset();
+    
+#ifdef SCHED_PROFILE
+    sched_prof_reset();
+#endif
+    
     restore(mask);
 }
 
@@ -731,6 +3491,28 @@ void sched_print_stats(void) {
     kprintf("Runnable: %u\n", sched_stats.runnable_count);
     kprintf("Blocked: %u\n", sched_stats.blocked_count);
     kprintf("Max Runnable: %u\n", sched_stats.max_runnable);
+    kprintf("Load Average: %u.%02u %u.%02u %u.%02u\n",
+            SCHED_LOAD_INT(loadavg[0]), SCHED_LOAD_FRAC(loadavg[0]),
+            SCHED_LOAD_INT(loadavg[1]), SCHED_LOAD_FRAC(loadavg[1]),
+            SCHED_LOAD_INT(loadavg[2]), SCHED_LOAD_FRAC(loadavg[2]));
+    
+    kprintf("Avg Wait Time: %llu ns\n", sched_stats.avg_wait_time);
+    kprintf("Avg Turnaround: %llu ns\n", sched_stats.avg_turnaround);
+    kprintf("Idle Time: %llu ticks\n", sched_stats.idle_time);
+    
+    if (classes_enabled) {
+        kprintf("Classes: realtime %u, fair %u, idle %u runnable\n",
+                class_nr[SCHED_CLASS_RT], class_nr[SCHED_CLASS_FAIR],
+                class_nr[SCHED_CLASS_IDLE]);
+    }
+    
+    sched_print_latency(-1);
+    
+    sched_wlat_print();
+    
+#ifdef SCHED_PROFILE
+    sched_prof_print();
+#endif
     
     if (current_scheduler != NULL && current_scheduler->print_stats != NULL) {
         current_scheduler->print_stats();
@@ -741,22 +3523,133 @@ void sched_print_stats(void) {
     restore(mask);
 }
 
+void sched_hist_reset(sched_hist_t *hist) {
+    if (hist != NULL) {
+        memset(hist, 0, sizeof(sched_hist_t));
+    }
+}
+
+void sched_hist_record(sched_hist_t *hist, uint64_t value) {
+    uint64_t max;
+    
+    if (hist == NULL) {
+        return;
+    }
+    
+    __atomic_add_fetch(&hist->buckets[hist_bucket(value)], 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&hist->count, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&hist->sum, value, __ATOMIC_RELAXED);
+    
+    max = __atomic_load_n(&hist->max, __ATOMIC_RELAXED);
+    while (value > max &&
+           !__atomic_compare_exchange_n(&hist->max, &max, value, true,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+uint64_t sched_hist_percentile(const sched_hist_t *hist, uint32_t permille) {
+    uint64_t target, seen, high;
+    uint32_t i;
+    
+    if (hist == NULL || hist->count == 0) {
+        return 0;
+    }
+    
+    if (permille > 1000) {
+        permille = 1000;
+    }
+    
+    target = (hist->count * permille + 999) / 1000;
+    if (target == 0) {
+        target = 1;
+    }
+    
+    seen = 0;
+    for (i = 0; i < SCHED_HIST_BUCKETS; i++) {
+        seen += hist->buckets[i];
+        if (seen >= target) {
+            high = hist_bucket_high(i);
+            return (high < hist->max) ? high : hist->max;
+        }
+    }
+    
+    return hist->max;
+}
+
+uint64_t sched_hist_mean(const sched_hist_t *hist) {
+    if (hist == NULL || hist->count == 0) {
+        return 0;
+    }
+    
+    return hist->sum / hist->count;
+}
+
+uint64_t sched_latency_percentile(pid32 pid, sched_lat_t which, uint32_t permille) {
+    if (which >= SCHED_LAT_NUM) {
+        return 0;
+    }
+    
+    if (pid < 0) {
+        return sched_hist_percentile(&sched_stats.latency[which], permille);
+    }
+    
+    if (pid >= NPROC) {
+        return 0;
+    }
+    
+    return sched_hist_percentile(&proc_cold[pid].latency[which], permille);
+}
+
+void sched_print_latency(pid32 pid) {
+    static const char *names[SCHED_LAT_NUM] = {
+        "Wait", "Wakeup", "Slice", "Turnaround"
+    };
+    const sched_hist_t *hist;
+    int i;
+    
+    if (pid >= NPROC) {
+        return;
+    }
+    
+    if (pid < 0) {
+        kprintf("\n=== Latency (ns) ===\n");
+    } else {
+        kprintf("\n=== Latency (ns), PID %d ===\n", pid);
+    }
+    kprintf("Metric      Count              p50           p99          p999           Max\n");
+    kprintf("----------  --------  ------------  ------------  ------------  ------------\n");
+    
+    for (i = 0; i < SCHED_LAT_NUM; i++) {
+        hist = (pid < 0) ? &sched_stats.latency[i] : &proc_cold[pid].latency[i];
+        kprintf("%-10s  %8llu  %12llu  %12llu  %12llu  %12llu\n", names[i], hist->count,
+                sched_hist_percentile(hist, 500), sched_hist_percentile(hist, 990),
+                sched_hist_percentile(hist, 999), hist->max);
+    }
+}
+
 void sched_print_ready_queue(void) {
     ready_node_t *node;
+    uint32_t i;
     intmask mask;
     
     mask = disable();
     
     kprintf("\n=== Ready Queue ===\n");
-    kprintf("Count: %u\n", ready_queue.count);
-    kprintf("PID   Priority  TimeSlice  EnqueueTime\n");
-    kprintf("----  --------  ---------  -----------\n");
+    kprintf("Count: %u\n", ready_queue_count());
     
-    node = ready_queue.head;
-    while (node != NULL) {
-        kprintf("%4d  %8u  %9u  %11llu\n",
-                node->pid, node->priority, node->time_slice, node->enqueue_time);
-        node = node->next;
+    for (i = 0; i < SCHED_NCPUS; i++) {
+        kprintf("\nCPU %u (count=%u, curr=%d):\n",
+                i, sched_cpus[i].rq.count, sched_cpus[i].curr);
+        kprintf("PID   Priority  TimeSlice  EnqueueTime\n");
+        kprintf("----  --------  ---------  -----------\n");
+        
+        node = sched_cpus[i].rq.head;
+        while (node != NULL) {
+            kprintf("%4d  %8u  %9u  %11llu\n",
+                    node->pid, node->priority, node->time_slice,
+                    node->enqueue_time);
+            node = node->next;
+        }
     }
     
     kprintf("\n");
@@ -766,42 +3659,99 @@ void sched_print_ready_queue(void) {
 
 bool sched_validate(void) {
     ready_node_t *node;
-    uint32_t count = 0;
+    uint32_t count;
+    uint32_t total = 0;
+    uint32_t queued = 0;
+    uint32_t cpu;
+    int i;
     intmask mask;
     bool valid = true;
     
     mask = disable();
     
-    node = ready_queue.head;
-    while (node != NULL) {
-        count++;
-        
-        if (node->pid < 0 || node->pid >= NPROC) {
-            kprintf("Invalid PID in ready queue: %d\n", node->pid);
-            valid = false;
+    for (cpu = 0; cpu < SCHED_NCPUS; cpu++) {
+        count = 0;
+        node = sched_cpus[cpu].rq.head;
+        while (node != NULL) {
+            count++;
+            
+            if (node->pid < 0 || node->pid >= NPROC) {
+                kprintf("Invalid PID in ready queue: %d\n", node->pid);
+                valid = false;
+                break;
+            }
+            
+            if (node != &node_pool[node->pid]) {
+                kprintf("Process %d queued on a foreign node\n", node->pid);
+                valid = false;
+            }
+            
+            if (node->cpu != cpu) {
+                kprintf("Process %d on CPU %u queue but tagged CPU %u\n",
+                        node->pid, cpu, node->cpu);
+                valid = false;
+            }
+            
+            if (!cpu_allowed(node->pid, cpu)) {
+                kprintf("Process %d queued on CPU %u outside its affinity 0x%x\n",
+                        node->pid, cpu, proc_affinity[node->pid]);
+                valid = false;
+            }
+            
+            if (proctab[node->pid].pstate != PR_READY) {
+                kprintf("Process %d in ready queue but state is %d\n",
+                        node->pid, proctab[node->pid].pstate);
+                valid = false;
+            }
+            
+            node = node->next;
+            
+            if (count > NPROC) {
+                kprintf("Ready queue appears circular!\n");
+                valid = false;
+                break;
+            }
         }
         
-        if (proctab[node->pid].pstate != PR_READY) {
-            kprintf("Process %d in ready queue but state is %d\n",
-                    node->pid, proctab[node->pid].pstate);
+        if (count != sched_cpus[cpu].rq.count) {
+            kprintf("CPU %u ready queue count mismatch: %u vs %u\n",
+                    cpu, count, sched_cpus[cpu].rq.count);
             valid = false;
         }
         
-        node = node->next;
-        
-        if (count > NPROC) {
-            kprintf("Ready queue appears circular!\n");
+        total += sched_cpus[cpu].rq.count;
+    }
+    
+    for (i = 0; i < NPROC; i++) {
+        if (node_pool[i].pid == i) {
+            queued++;
+        } else if (node_pool[i].pid != -1) {
+            kprintf("Node %d holds stale PID %d\n", i, node_pool[i].pid);
             valid = false;
-            break;
         }
     }
     
-    if (count != ready_queue.count) {
-        kprintf("Ready queue count mismatch: %u vs %u\n", 
-                count, ready_queue.count);
+    if (queued != total) {
+        kprintf("Ready index mismatch: %u indexed vs %u queued\n",
+                queued, total);
         valid = false;
     }
     
+    for (i = 0; i < NPROC; i++) {
+        if (gang_runnable[i] && (proc_gang[i] < 0 || proctab[i].pstate != PR_READY)) {
+            kprintf("Process %d held for gang %d but state is %d\n",
+                    i, proc_gang[i], proctab[i].pstate);
+            valid = false;
+        }
+        
+        if (bw_parked_on[i] >= 0 && (ready_queue_contains(i) || gang_runnable[i] ||
+                                     !proc_active[i] || !bw_groups[bw_parked_on[i]].throttled)) {
+            kprintf("Process %d parked on group %d but runnable\n",
+                    i, bw_parked_on[i]);
+            valid = false;
+        }
+    }
+    
     restore(mask);
     
     return valid;
@@ -817,14 +3767,25 @@ void sched_dump(void) {
     kprintf("Current PID: %d\n", currpid);
     kprintf("Need Resched: %s\n", need_resched ? "Yes" : "No");
     kprintf("Quantum: %u ms\n", current_quantum);
-    kprintf("Quantum Remaining: %u\n", quantum_remaining);
     kprintf("System Ticks: %llu\n", system_ticks);
+    kprintf("Gang Slot: %d (%u gangs)\n", gang_slot, gang_count);
+    
+    kprintf("\nCPU  Curr  Resched  QuantumLeft  Dispatches  Steals  Migrations  Load\n");
+    kprintf("---  ----  -------  -----------  ----------  ------  ----------  ----\n");
+    for (i = 0; i < SCHED_NCPUS; i++) {
+        kprintf("%3d  %4d  %7s  %11u  %10llu  %6llu  %10llu  %4llu\n",
+                i, sched_cpus[i].curr,
+                sched_cpus[i].need_resched ? "Yes" : "No",
+                sched_cpus[i].quantum_remaining,
+                sched_cpus[i].dispatches, sched_cpus[i].steals,
+                sched_cpus[i].migrations, sched_cpu_load(i));
+    }
     
     sched_print_ready_queue();
     
     kprintf("\n=== Per-Process Stats ===\n");
-    kprintf("PID   State   Priority  Runtime    Switches\n");
-    kprintf("----  ------  --------  ---------  --------\n");
+    kprintf("PID   State   Priority  Runtime    Switches  Util\n");
+    kprintf("----  ------  --------  ---------  --------  ----\n");
     
     for (i = 0; i < NPROC; i++) {
         if (proctab[i].pstate != PR_FREE) {
@@ -838,13 +3799,18 @@ void sched_dump(void) {
                 default:       state = "???"; break;
             }
             
-            kprintf("%4d  %6s  %8u  %9llu  %8u\n",
+            kprintf("%4d  %6s  %8u  %9llu  %8u  %3u%%\n",
                     i, state, proctab[i].pprio,
-                    proc_stats[i].total_runtime,
-                    proc_stats[i].context_switches);
+                    proc_hot[i].total_runtime,
+                    proc_hot[i].context_switches,
+                    sched_get_util(i) * 100 / SCHED_UTIL_SCALE);
         }
     }
     
+    if (sched_trace_enabled()) {
+        sched_trace_dump();
+    }
+    
     kprintf("\n");
     
     restore(mask);
@@ -22,6 +22,169 @@
 #define PRIORITY_HIGH           75
 #define PRIORITY_REALTIME       99
 
+#ifndef SCHED_NCPUS
+#define SCHED_NCPUS             1
+#endif
+
+#if SCHED_NCPUS > 32
+#error "SCHED_NCPUS must not exceed 32"
+#elif SCHED_NCPUS == 32
+#define SCHED_CPUMASK_ALL       0xFFFFFFFFu
+#else
+#define SCHED_CPUMASK_ALL       ((1u << SCHED_NCPUS) - 1)
+#endif
+
+#define SCHED_STEAL_THRESHOLD   2
+
+#define SCHED_BALANCE_INTERVAL  8
+#define SCHED_MIGRATION_COST    5
+
+#define SCHED_MAX_GANGS         16
+
+#define SCHED_BW_MAX_GROUPS     16
+#define SCHED_BW_UNLIMITED      UINT64_MAX
+
+#define SCHED_CACHE_LINE        64
+
+#define SCHED_WAKEUP_BATCH      16
+#define SCHED_READY_BATCH       64
+
+#define SCHED_HINT_NONE         0xFFFFFFFFu
+
+#define SCHED_STATIC_RR         1
+#define SCHED_STATIC_PRIORITY   2
+#define SCHED_STATIC_MLFQ       3
+#define SCHED_STATIC_LOTTERY    4
+#define SCHED_STATIC_CFS        5
+#define SCHED_STATIC_EDF        6
+
+#ifdef SCHED_STATIC_POLICY
+#if SCHED_STATIC_POLICY == SCHED_STATIC_RR
+#define SCHED_STATIC_TYPE       SCHEDULER_ROUND_ROBIN
+#define SCHED_STATIC_OP(op)     round_robin_##op
+#elif SCHED_STATIC_POLICY == SCHED_STATIC_PRIORITY
+#define SCHED_STATIC_TYPE       SCHEDULER_PRIORITY
+#define SCHED_STATIC_OP(op)     priority_##op
+#elif SCHED_STATIC_POLICY == SCHED_STATIC_MLFQ
+#define SCHED_STATIC_TYPE       SCHEDULER_MLFQ
+#define SCHED_STATIC_OP(op)     mlfq_##op
+#elif SCHED_STATIC_POLICY == SCHED_STATIC_LOTTERY
+#define SCHED_STATIC_TYPE       SCHEDULER_LOTTERY
+#define SCHED_STATIC_OP(op)     lottery_##op
+#elif SCHED_STATIC_POLICY == SCHED_STATIC_CFS
+#define SCHED_STATIC_TYPE       SCHEDULER_CFS
+#define SCHED_STATIC_OP(op)     cfs_##op
+#elif SCHED_STATIC_POLICY == SCHED_STATIC_EDF
+#define SCHED_STATIC_TYPE       SCHEDULER_EDF
+#define SCHED_STATIC_OP(op)     realtime_##op
+#else
+#error "SCHED_STATIC_POLICY must be one of SCHED_STATIC_RR .. SCHED_STATIC_EDF"
+#endif
+#endif
+
+#ifndef SCHED_TICK_NS
+#define SCHED_TICK_NS           1000000ULL
+#endif
+
+#define SCHED_NO_EVENT          UINT64_MAX
+#define SCHED_TICKLESS_MAX      1000
+
+#ifndef SCHED_LOAD_FREQ
+#define SCHED_LOAD_FREQ         5000
+#endif
+#define SCHED_LOAD_SHIFT        11
+#define SCHED_LOAD_FIXED_1      (1u << SCHED_LOAD_SHIFT)
+#define SCHED_LOAD_EXP_1        1884
+#define SCHED_LOAD_EXP_5        2014
+#define SCHED_LOAD_EXP_15       2037
+#define SCHED_LOAD_INT(x)       ((x) >> SCHED_LOAD_SHIFT)
+#define SCHED_LOAD_FRAC(x)      ((((x) & (SCHED_LOAD_FIXED_1 - 1)) * 100) >> SCHED_LOAD_SHIFT)
+
+#define SCHED_UTIL_SCALE        1024
+#define SCHED_UTIL_HALFLIFE     32
+
+#define SCHED_HIST_SUB_BITS     3
+#define SCHED_HIST_SUB          (1u << SCHED_HIST_SUB_BITS)
+#define SCHED_HIST_MAX_BITS     40
+#define SCHED_HIST_BUCKETS      ((SCHED_HIST_MAX_BITS - SCHED_HIST_SUB_BITS + 1) * SCHED_HIST_SUB)
+
+typedef enum {
+    SCHED_CLASS_RT,
+    SCHED_CLASS_FAIR,
+    SCHED_CLASS_IDLE,
+    SCHED_CLASS_NUM
+} sched_class_t;
+
+typedef uint32_t sched_cpumask_t;
+
+typedef uint64_t (*sched_clock_source_t)(void);
+
+typedef struct sched_gang {
+    bool        used;
+    uint32_t    nmembers;
+    pid32       members[SCHED_NCPUS];
+    uint64_t    slots;
+} sched_gang_t;
+
+typedef struct sched_bw_group {
+    bool        used;
+    bool        throttled;
+    int32_t     parent;
+    uint32_t    nmembers;
+    uint32_t    nchildren;
+    uint64_t    quota;
+    uint64_t    period;
+    uint64_t    runtime;
+    uint64_t    next_refill;
+    uint64_t    throttled_at;
+    uint64_t    usage;
+    uint64_t    throttle_count;
+    uint64_t    throttled_ticks;
+} sched_bw_group_t;
+
+typedef enum {
+    SCHED_LAT_WAIT,
+    SCHED_LAT_WAKEUP,
+    SCHED_LAT_SLICE,
+    SCHED_LAT_TURNAROUND,
+    SCHED_LAT_NUM
+} sched_lat_t;
+
+typedef struct sched_hist {
+    uint64_t    count;
+    uint64_t    sum;
+    uint64_t    max;
+    uint32_t    buckets[SCHED_HIST_BUCKETS];
+} sched_hist_t;
+
+typedef struct sched_proc_hot {
+    uint64_t    total_runtime;
+    uint64_t    last_runtime;
+    uint64_t    last_scheduled;
+    uint64_t    ready_since;
+    uint64_t    woken_at;
+    uint32_t    context_switches;
+    uint32_t    times_scheduled;
+    uint32_t    seq;
+    uint32_t    util;
+    uint32_t    util_stamp;
+    bool        queued;
+    bool        woken;
+} __attribute__((aligned(SCHED_CACHE_LINE))) sched_proc_hot_t;
+
+typedef struct sched_proc_cold {
+    uint64_t    total_waittime;
+    uint64_t    total_sleeptime;
+    uint64_t    sleep_since;
+    uint64_t    start_time;
+    uint32_t    voluntary_switches;
+    uint32_t    involuntary_switches;
+    uint32_t    time_slices;
+    sched_hist_t latency[SCHED_LAT_NUM];
+} sched_proc_cold_t;
+
+typedef struct sched_proc_stats {
+    uint64_t    total_runtime;
     uint64_t    total_waittime;
     uint64_t    total_sleeptime;
     uint32_t    context_switches;
@@ -29,10 +192,22 @@
     uint32_t    involuntary_switches;
     uint32_t    time_slices;
     uint32_t    times_scheduled;
+    uint32_t    cpu_util;
     uint64_t    last_scheduled;
     uint64_t    last_runtime;
+    uint64_t    start_time;
+    uint64_t    ready_since;
+    uint64_t    woken_at;
+    bool        queued;
+    bool        woken;
+    sched_hist_t latency[SCHED_LAT_NUM];
 } sched_proc_stats_t;
 
+typedef struct sched_proc_snapshot {
+    pid32       pid;
+    sched_proc_stats_t stats;
+} sched_proc_snapshot_t;
+
 typedef struct sched_stats {
     uint64_t    total_schedules;
     uint64_t    context_switches;
@@ -46,12 +221,20 @@ typedef struct sched_stats {
     uint64_t    quantum_expirations;
     uint64_t    avg_wait_time;
     uint64_t    avg_turnaround;
+    sched_hist_t latency[SCHED_LAT_NUM];
 } sched_stats_t;
 
+typedef struct sched_hint {
+    pid32       pid;
+    uint32_t    priority;
+} sched_hint_t;
+
 typedef struct ready_node {
     pid32   pid;
+    uint32_t cpu;
     uint32_t priority;
     uint32_t time_slice;
+    uint32_t weight;
     uint64_t enqueue_time;
     struct ready_node *next;
     struct ready_node *prev;
@@ -62,8 +245,22 @@ typedef struct ready_queue {
     ready_node_t *tail;
     uint32_t count;
     uint32_t priority;
+    uint64_t load;
 } ready_queue_t;
 
+typedef struct sched_cpu {
+    uint32_t        id;
+    ready_queue_t   rq;
+    pid32           curr;
+    volatile bool   need_resched;
+    uint32_t        quantum_remaining;
+    uint64_t        dispatches;
+    uint64_t        steals;
+    uint64_t        migrations;
+    uint64_t        next_balance;
+    volatile uint32_t lock;
+} __attribute__((aligned(SCHED_CACHE_LINE))) sched_cpu_t;
+
 typedef struct scheduler_ops {
     const char *name;
     
@@ -77,6 +274,10 @@ typedef struct scheduler_ops {
     void (*enqueue)(pid32 pid);
     void (*dequeue)(pid32 pid);
     pid32 (*pick_next)(void);
+    bool (*check_preempt_wakeup)(pid32 pid);
+    
+    uint32_t (*export_runnable)(sched_hint_t *hints, uint32_t max);
+    void (*enqueue_batch)(const sched_hint_t *hints, uint32_t count);
     
     void (*set_priority)(pid32 pid, uint32_t prio);
     uint32_t (*get_priority)(pid32 pid);
@@ -86,6 +287,8 @@ typedef struct scheduler_ops {
     void (*set_quantum)(uint32_t quantum);
     uint32_t (*get_quantum)(void);
     void (*tick)(void);
+    uint64_t (*next_event)(void);
+    void (*catchup)(uint64_t ticks);
     
     void (*get_stats)(sched_stats_t *stats);
     void (*reset_stats)(void);
@@ -98,7 +301,7 @@ extern uint32_t sched_policy;
 
 extern sched_stats_t sched_stats;
 
-extern ready_queue_t ready_queue;
+extern sched_cpu_t sched_cpus[SCHED_NCPUS];
 
 extern pid32 currpid;
 
@@ -110,6 +313,24 @@ void scheduler_shutdown(void);
 
 syscall scheduler_switch(scheduler_type_t type);
 
+syscall sched_classes_enable(scheduler_type_t fair);
+
+syscall sched_classes_disable(void);
+
+bool sched_classes_enabled(void);
+
+syscall sched_set_class(pid32 pid, sched_class_t cls);
+
+sched_class_t sched_get_class(pid32 pid);
+
+int32_t sched_prio_to_nice(uint32_t priority);
+
+uint32_t sched_nice_to_prio(int32_t nice);
+
+uint32_t sched_prio_to_tickets(uint32_t priority);
+
+uint32_t sched_tickets_to_prio(uint32_t tickets);
+
 void schedule(void);
 
 void resched(void);
@@ -118,20 +339,70 @@ void yield(void);
 
 void preempt(void);
 
+sched_cpu_t *sched_this_cpu(void);
+
+void sched_set_resched(void);
+
+void sched_switch(pid32 oldpid, pid32 newpid);
+
 void ready_queue_init(void);
 
 void ready_enqueue(pid32 pid);
 
+void ready_enqueue_cpu(uint32_t cpuid, pid32 pid);
+
 void ready_dequeue(pid32 pid);
 
 pid32 ready_peek(void);
 
 pid32 ready_pop(void);
 
+pid32 ready_pop_cpu(uint32_t cpuid);
+
+pid32 sched_steal(uint32_t cpuid);
+
 bool ready_queue_empty(void);
 
 uint32_t ready_queue_count(void);
 
+bool ready_queue_contains(pid32 pid);
+
+syscall sched_set_affinity(pid32 pid, sched_cpumask_t mask);
+
+sched_cpumask_t sched_get_affinity(pid32 pid);
+
+uint64_t sched_cpu_load(uint32_t cpuid);
+
+uint32_t sched_balance(uint32_t cpuid);
+
+void sched_balance_enable(bool enable);
+
+bool sched_balance_enabled(void);
+
+syscall sched_gang_create(void);
+
+syscall sched_gang_destroy(int32_t gid);
+
+syscall sched_gang_join(int32_t gid, pid32 pid);
+
+syscall sched_gang_leave(pid32 pid);
+
+int32_t sched_get_gang(pid32 pid);
+
+syscall sched_bw_create(int32_t parent, uint64_t quota, uint64_t period);
+
+syscall sched_bw_destroy(int32_t gid);
+
+syscall sched_bw_set(int32_t gid, uint64_t quota, uint64_t period);
+
+syscall sched_bw_attach(pid32 pid, int32_t gid);
+
+int32_t sched_bw_group_of(pid32 pid);
+
+syscall sched_bw_get(int32_t gid, sched_bw_group_t *group);
+
+void sched_bw_print(void);
+
 syscall setpriority(pid32 pid, uint32_t priority);
 
 syscall getpriority(pid32 pid);
@@ -146,12 +417,30 @@ void sched_tick(void);
 
 uint64_t sched_get_time(void);
 
+uint64_t sched_clock(void);
+
+void sched_clock_set_source(sched_clock_source_t source);
+
+void sched_tickless_enable(bool enable);
+
+bool sched_tickless_enabled(void);
+
+uint64_t sched_next_event(void);
+
+void sched_tick_catchup(uint64_t elapsed);
+
 void sched_ready(pid32 pid);
 
+void sched_ready_batch(const pid32 *pids, uint32_t n);
+
 void sched_block(pid32 pid);
 
 void sched_wakeup(pid32 pid);
 
+syscall sched_sleep(pid32 pid, uint64_t ticks);
+
+syscall sched_unsleep(pid32 pid);
+
 void sched_new_process(pid32 pid);
 
 void sched_exit(pid32 pid);
@@ -160,10 +449,28 @@ void sched_get_stats(sched_stats_t *stats);
 
 void sched_get_proc_stats(pid32 pid, sched_proc_stats_t *stats);
 
+uint32_t sched_get_all_proc_stats(sched_proc_snapshot_t *out, uint32_t max);
+
+void sched_get_loadavg(uint32_t avg[3]);
+
+uint32_t sched_get_util(pid32 pid);
+
 void sched_reset_stats(void);
 
 void sched_print_stats(void);
 
+void sched_hist_reset(sched_hist_t *hist);
+
+void sched_hist_record(sched_hist_t *hist, uint64_t value);
+
+uint64_t sched_hist_percentile(const sched_hist_t *hist, uint32_t permille);
+
+uint64_t sched_hist_mean(const sched_hist_t *hist);
+
+uint64_t sched_latency_percentile(pid32 pid, sched_lat_t which, uint32_t permille);
+
+void sched_print_latency(pid32 pid);
+
 void sched_print_ready_queue(void);
 
 bool sched_validate(void);
@@ -178,4 +485,10 @@ extern void save_context(void);
 
 extern void restore_context(pid32 pid);
 
+extern uint64_t clkoneshot(uint64_t ticks);
+
+#if SCHED_NCPUS > 1
+extern uint32_t getcpuid(void);
+#endif
+
 #endif